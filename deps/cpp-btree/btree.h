@@ -521,6 +521,9 @@ class btree_node {
     // key(i). The keys in children_[i + 1] are all greater than key(i). There
     // are always count + 1 children.
     self_type_ptr children[kNodeValues + 1];
+    // The number of values stored in this node and all of its descendants.
+    // Used to compute the rank of a value and to seek by rank in O(log n).
+    size_type total;
   };
 
   struct root_fields : public internal_fields {
@@ -553,6 +556,26 @@ class btree_node {
     fields_.parent = fields_.parent->parent();
   }
 
+  // Getter for the number of values in the subtree rooted at this node.
+  size_type subtree_size() const {
+    return leaf() ? static_cast<size_type>(count()) : fields_.total;
+  }
+  // Recomputes the subtree size of an internal node from its children.
+  void update_total() {
+    size_type n = count();
+    for (int i = 0; i <= count(); ++i) {
+      n += child(i)->subtree_size();
+    }
+    fields_.total = n;
+  }
+  // Adds delta to the subtree size of every ancestor of this node.
+  void adjust_totals(int delta) {
+    for (btree_node *n = this; !n->is_root();) {
+      n = n->parent();
+      n->fields_.total += delta;
+    }
+  }
+
   // Getter for the rightmost root node field. Only valid on the root node.
   btree_node* rightmost() const { return fields_.rightmost.get(); }
   self_type_ptr* mutable_rightmost() { return &fields_.rightmost; }
@@ -710,6 +733,7 @@ class btree_node {
   static btree_node* init_internal(internal_fields *f, btree_node *parent) {
     btree_node *n = init_leaf(f, parent, kNodeValues);
     f->leaf = 0;
+    f->total = 0;
     if (!NDEBUG) {
       //memset(f->children, 0, sizeof(f->children));
         for(size_t i = 0; i < sizeof(f->children); i++)
@@ -804,6 +828,12 @@ struct btree_iterator {
   void increment_by(int count);
   void increment_slow();
 
+  // Returns the number of values before the iterator position.
+  size_type rank() const;
+  // Positions the iterator at the value with the given rank in the tree
+  // containing node, or at end() if rank is out of range.
+  void seek(size_type rank);
+
   void decrement() {
     if (node->leaf() && --position >= 0) {
       return;
@@ -1525,6 +1555,11 @@ void btree_node<P>::rebalance_right_to_left(btree_node *src, int to_move) {
   // Fixup the counts on the src and dest nodes.
   set_count(count() + to_move);
   src->set_count(src->count() - to_move);
+
+  if (!leaf()) {
+    update_total();
+    src->update_total();
+  }
 }
 
 template <typename P>
@@ -1570,6 +1605,11 @@ void btree_node<P>::rebalance_left_to_right(btree_node *dest, int to_move) {
   // Fixup the counts on the src and dest nodes.
   set_count(count() - to_move);
   dest->set_count(dest->count() + to_move);
+
+  if (!leaf()) {
+    update_total();
+    dest->update_total();
+  }
 }
 
 template <typename P>
@@ -1610,6 +1650,8 @@ void btree_node<P>::split(btree_node *dest, int insert_position) {
       dest->set_child(i, child(count() + i + 1));
       *mutable_child(count() + i + 1) = NULL;
     }
+    update_total();
+    dest->update_total();
   }
 }
 
@@ -1640,6 +1682,9 @@ void btree_node<P>::merge(btree_node *src) {
   // Fixup the counts on the src and dest nodes.
   set_count(1 + count() + src->count());
   src->set_count(0);
+  if (!leaf()) {
+    update_total();
+  }
 
   // Remove the value on the parent node.
   parent()->remove_value(position());
@@ -1678,6 +1723,7 @@ void btree_node<P>::swap(btree_node *x) {
     for (int i = 0; i <= x->count(); ++i) {
       child(i)->fields_.parent = this;
     }
+    btree_swap_helper(fields_.total, x->fields_.total);
   }
 
   // Swap the counts.
@@ -1711,19 +1757,66 @@ void btree_iterator<N, R, P>::increment_slow() {
 
 template <typename N, typename R, typename P>
 void btree_iterator<N, R, P>::increment_by(int count) {
-  while (count > 0) {
-    if (node->leaf()) {
-      int rest = node->count() - position;
-      position += std::min(rest, count);
-      count = count - rest;
-      if (position < node->count()) {
+  if (count <= 0) {
+    return;
+  }
+  if (node->leaf() && position + count < node->count()) {
+    position += count;
+    return;
+  }
+  seek(rank() + count);
+}
+
+template <typename N, typename R, typename P>
+typename btree_iterator<N, R, P>::size_type
+btree_iterator<N, R, P>::rank() const {
+  const N *n = node;
+  size_type r = position;
+  if (!n->leaf()) {
+    for (int i = 0; i <= position; ++i) {
+      r += n->child(i)->subtree_size();
+    }
+  }
+  while (!n->is_root()) {
+    int pos = n->position();
+    n = n->parent();
+    r += pos;
+    for (int i = 0; i < pos; ++i) {
+      r += n->child(i)->subtree_size();
+    }
+  }
+  return r;
+}
+
+template <typename N, typename R, typename P>
+void btree_iterator<N, R, P>::seek(size_type rank) {
+  while (!node->is_root()) {
+    node = node->parent();
+  }
+  if (rank >= node->subtree_size()) {
+    // Past the last value: position at end().
+    while (!node->leaf()) {
+      node = node->child(node->count());
+    }
+    position = node->count();
+    return;
+  }
+  while (!node->leaf()) {
+    int i = 0;
+    for (; i < node->count(); ++i) {
+      size_type n = node->child(i)->subtree_size();
+      if (rank < n) {
+        break;
+      }
+      if (rank == n) {
+        position = i;
         return;
       }
-    } else {
-      --count;
+      rank -= n + 1;
     }
-    increment_slow();
+    node = node->child(i);
   }
+  position = rank;
 }
 
 template <typename N, typename R, typename P>
@@ -1902,6 +1995,7 @@ typename btree<P>::iterator btree<P>::erase(iterator iter) {
 
   // Delete the key from the leaf.
   iter.node->remove_value(iter.position);
+  iter.node->adjust_totals(-1);
 
   // We want to return the next value after the one we just erased. If we
   // erased from an internal node (internal_delete == true), then the next
@@ -2084,6 +2178,7 @@ void btree<P>::rebalance_or_split(iterator *iter) {
       // the current root node as the child of the new root.
       parent = new_internal_root_node();
       parent->set_child(0, root());
+      parent->update_total();
       *mutable_root() = parent;
       assert(mutable_rightmost()->get() == parent->child(0));
     } else {
@@ -2094,6 +2189,7 @@ void btree<P>::rebalance_or_split(iterator *iter) {
       parent = new_internal_node(parent);
       parent->set_child(0, parent);
       parent->swap(root());
+      root()->update_total();
       node = parent;
     }
   }
@@ -2249,6 +2345,7 @@ btree<P>::internal_insert(iterator iter, const value_type &v) {
     ++*mutable_size();
   }
   iter.node->insert_value(iter.position, v);
+  iter.node->adjust_totals(1);
   return iter;
 }
 
@@ -2412,6 +2509,7 @@ int btree<P>::internal_verify(
           (i == 0) ? lo : &node->key(i - 1),
           (i == node->count()) ? hi : &node->key(i));
     }
+    assert(node->subtree_size() == static_cast<size_type>(count));
   }
   return count;
 }
@@ -0,0 +1,394 @@
+/*
+ *Copyright (c) 2015-2015, yinqiwen <yinqiwen@gmail.com>
+ *All rights reserved.
+ *
+ *Redistribution and use in source and binary forms, with or without
+ *modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Redis nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ *THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PTMALLOC_ALLOCATOR_HPP_
+#define PTMALLOC_ALLOCATOR_HPP_
+
+#include <memory>
+#include <new>
+#include <algorithm>
+#include <cstddef>
+#include <string.h>
+#include <stdexcept>
+#include <boost/interprocess/offset_ptr.hpp>
+#include "slab.hpp"
+
+extern "C" {
+    extern void* mspace_malloc(void* msp, size_t bytes);
+    extern void* mspace_realloc(void* msp, void* oldmem, size_t bytes);
+    extern size_t mspace_usable_size(void* mem);
+    extern void mspace_free(void* msp, void* mem);
+}
+
+namespace mmkv
+{
+    /*
+     * serialize mspace access among writers of different dbs in per db lock mode,
+     * no-op for other stores.
+     */
+    void lock_mspace(void* msp);
+    void unlock_mspace(void* msp);
+
+    static const int kMaxMSpaceLockCount = 16;
+    /*
+     * per thread slab block caching of a store opened with per db lock, 'slot' indexes the store among
+     * per db lock stores of the process, 'serial' changes whenever cached blocks must be dropped.
+     * returns false if caching is disabled for the store.
+     */
+    struct MSpaceCacheInfo
+    {
+            void* mspace;
+            char* base;
+            uint32_t blocks;
+            int slot;
+            uint64_t serial;
+    };
+    bool get_mspace_cache(void* msp, MSpaceCacheInfo& info);
+    bool get_mspace_cache_slot(int slot, MSpaceCacheInfo& info);
+
+    /*
+     * per db memory counters of a writer & the one of them charged with usable bytes of blocks the thread
+     * allocates or frees, NULL charges nothing. Set while a writer works on a key, cleared on unlock.
+     */
+    extern __thread int64_t* g_alloc_counters;
+    extern __thread int64_t* g_alloc_account;
+
+    struct Meta
+    {
+            size_t file_size;
+            size_t size;
+            size_t mspace_offset;
+            uint32_t format_version;
+            uint32_t table_layout;
+            uint32_t hash_policy;
+            uint32_t score_precision;
+            uint64_t map_size; //mapping length of every attached process, the file grows in place up to it
+            SlabArena slab;
+            Meta() :
+                    file_size(0), size(0),  mspace_offset(1), format_version(0), table_layout(0), hash_policy(0), score_precision(0), map_size(0)
+            {
+                memset(&slab, 0, sizeof(slab));
+            }
+    };
+    struct MemorySpaceInfo
+    {
+            boost::interprocess::offset_ptr<void> space;
+            MemorySpaceInfo()
+            {
+            }
+    };
+
+    template<typename T>
+    class Allocator
+    {
+        private:
+
+            //Self type
+            typedef Allocator<T> self_t;
+
+            //typedef boost::interprocess::offset_ptr<void> VoidPtr;
+            //Not assignable from related allocator
+            template<class T2>
+            Allocator& operator=(const Allocator<T2>&);
+
+            //Not assignable from other allocator
+
+            //Pointer to the allocator
+            MemorySpaceInfo m_space;
+
+        public:
+            typedef T value_type;
+            //typedef VoidPtr pointer;
+            //typedef const VoidPtr const_pointer;
+            //typedef T* pointer;
+            //typedef const T* const_pointer;
+            typedef boost::interprocess::offset_ptr<T> pointer;
+            typedef const pointer const_pointer;
+            typedef T& reference;
+            typedef const T& const_reference;
+            typedef size_t size_type;
+            typedef ptrdiff_t difference_type;
+
+            //!Obtains an allocator that allocates
+            //!objects of type T2
+            template<class T2>
+            struct rebind
+            {
+                    typedef Allocator<T2> other;
+            };
+            Allocator()
+            {
+            }
+            //!Constructor from the segment manager.
+            //!Never throws
+            Allocator(const MemorySpaceInfo& space) :
+                    m_space(space)
+            {
+            }
+
+            //!Constructor from other allocator.
+            //!Never throws
+            Allocator(const Allocator &other) :
+                    m_space(other.m_space)
+            {
+            }
+
+            //!Constructor from related allocator.
+            //!Never throws
+            template<class T2>
+            Allocator(const Allocator<T2> &other) :
+                    m_space(other.get_space())
+            {
+            }
+            Allocator& operator=(const Allocator& other)
+            {
+                m_space = other.get_space();
+                return *this;
+            }
+
+            //!Allocates memory for an array of count elements.
+            //!Throws boost::interprocess::bad_alloc if there is no enough memory
+            T* allocate(size_type count, const_pointer hint = 0)
+            {
+                (void) hint;
+                void* p = NULL;
+                Meta* meta = (Meta*) (m_space.space.get());
+                void* msp = (char*) (meta) + meta->mspace_offset;
+                p = slab_cache_malloc(&meta->slab, (char*) meta, msp, count * sizeof(T));
+                if (NULL == p)
+                {
+                    lock_mspace(msp);
+                    p = slab_malloc(&meta->slab, (char*) meta, msp, count * sizeof(T));
+                    if (NULL == p)
+                    {
+                        p = mspace_malloc(msp, count * sizeof(T));
+                    }
+                    unlock_mspace(msp);
+                }
+                //allocate from other space
+                if (NULL == p)
+                {
+                    throw std::bad_alloc();
+                }
+                if (NULL != g_alloc_account)
+                {
+                    *g_alloc_account += usable_size(p);
+                }
+                return (T*) p;
+            }
+
+            void* realloc(void* oldmem, size_t bytes)
+            {
+                void* p = NULL;
+                Meta* meta = (Meta*) (m_space.space.get());
+                void* msp = (char*) (meta) + meta->mspace_offset;
+                if (NULL != g_alloc_account && NULL != oldmem)
+                {
+                    *g_alloc_account -= usable_size(oldmem);
+                }
+                lock_mspace(msp);
+                size_t slab_size = NULL == oldmem ? 0 : slab_usable_size(&meta->slab, (char*) meta, oldmem);
+                if (slab_size >= bytes)
+                {
+                    p = oldmem;
+                }
+                else if (slab_size > 0)
+                {
+                    //blocks move between slab classes & the mspace by copy
+                    p = slab_malloc(&meta->slab, (char*) meta, msp, bytes);
+                    if (NULL == p)
+                    {
+                        p = mspace_malloc(msp, bytes);
+                    }
+                    if (NULL != p)
+                    {
+                        memcpy(p, oldmem, slab_size);
+                        slab_free(&meta->slab, (char*) meta, msp, oldmem);
+                    }
+                }
+                else
+                {
+                    p = mspace_realloc(msp, oldmem, bytes);
+                }
+                unlock_mspace(msp);
+                if (NULL == p)
+                {
+                    throw std::bad_alloc();
+                }
+                if (NULL != g_alloc_account)
+                {
+                    *g_alloc_account += usable_size(p);
+                }
+                return p;
+            }
+
+            //!Deallocates memory previously allocated.
+            //!Never throws
+
+            inline void deallocate_ptr(const T* ptr, size_type n = 1)
+            {
+                if (NULL == ptr)
+                    return;
+                Meta* meta = (Meta*) (m_space.space.get());
+                T* p = (T*) ptr;
+                void* msp = (char*) (meta) + meta->mspace_offset;
+                if (NULL != g_alloc_account)
+                {
+                    *g_alloc_account -= usable_size(p);
+                }
+                if (slab_cache_free(&meta->slab, (char*) meta, msp, p))
+                {
+                    return;
+                }
+                lock_mspace(msp);
+                if (!slab_free(&meta->slab, (char*) meta, msp, p))
+                {
+                    mspace_free(msp, p);
+                }
+                unlock_mspace(msp);
+            }
+            inline void deallocate(const pointer &ptr, size_type n = 1)
+            {
+                deallocate_ptr(ptr.get(), n);
+            }
+
+            template<typename R>
+            void destroy_ptr(R* p)
+            {
+                if (NULL == p)
+                {
+                    return;
+                }
+                p->~R();
+                deallocate_ptr((T*) p);
+            }
+
+            //!Returns the number of elements that could be allocated.
+            //!Never throws
+            size_type max_size() const
+            {
+                Meta* meta = (Meta*) (m_space.space.get());
+                return meta->size / sizeof(T);
+            }
+
+            //!Swap segment manager. Does not throw. If each allocator is placed in
+            //!different memory segments, the result is undefined.
+            friend void swap(self_t &alloc1, self_t &alloc2)
+            {
+                //ipcdetail::do_swap(alloc1.mp_mngr, alloc2.mp_mngr);
+            }
+
+            //!Returns maximum the number of objects the previously allocated memory
+            //!pointed by p can hold. This size only works for memory allocated with
+            //!allocate, allocation_command and allocate_many.
+            size_type size(const pointer &p) const
+            {
+                return (size_type) usable_size(p.get()) / sizeof(T);
+            }
+            /*
+             * bytes of the slab block or mspace chunk at 'p'
+             */
+            size_t usable_size(const void* p) const
+            {
+                Meta* meta = (Meta*) (m_space.space.get());
+                size_t slab_size = slab_usable_size(&meta->slab, (char*) meta, const_cast<void*>(p));
+                if (slab_size > 0)
+                {
+                    return slab_size;
+                }
+                return mspace_usable_size(const_cast<void*>(p));
+            }
+
+            //!Returns address of mutable object.
+            //!Never throws
+            pointer address(reference value) const
+            {
+                return &value;
+            }
+
+            //!Returns address of non mutable object.
+            //!Never throws
+            const_pointer address(const_reference value) const
+            {
+                return &value;
+            }
+
+            //!Constructs an object
+            //!Throws if T's constructor throws
+            //!For backwards compatibility with libraries using C++03 allocators
+            template<class P>
+            void construct(const pointer &ptr, const P& p)
+            {
+                ::new ((void*) (ptr.get())) P(p);
+            }
+
+            //!Destroys object. Throws if object's
+            //!destructor throws
+            void destroy(const pointer &ptr)
+            {
+                //(*ptr).~value_type();
+                T* p = ptr.get();
+                (*p).~value_type();
+            }
+
+            MemorySpaceInfo get_space() const
+            {
+                return m_space;
+            }
+
+            void* get_mspace()
+            {
+                Meta* meta = (Meta*) (m_space.space.get());
+                return (char*) (meta) + meta->mspace_offset;
+            }
+    };
+
+    //!Equality test for same type
+    //!of allocator
+    template<class T> inline
+    bool operator==(const Allocator<T> &alloc1, const Allocator<T> &alloc2)
+    {
+        return alloc1.get_space().space == alloc2.get_space().space;
+    }
+
+    //!Inequality test for same type
+    //!of allocator
+    template<class T> inline
+    bool operator!=(const Allocator<T> &alloc1, const Allocator<T> &alloc2)
+    {
+        return alloc1.get_space().space != alloc2.get_space().space;
+    }
+    template<class T1, class T2> inline
+    bool operator!=(const Allocator<T1> &alloc1, const Allocator<T2> &alloc2)
+    {
+        return alloc1.get_space().space != alloc2.get_space().space;
+    }
+}
+
+#endif /* PTMALLOC_ALLOCATOR_HPP_ */
@@ -0,0 +1,185 @@
+/*
+ *Copyright (c) 2015-2015, yinqiwen <yinqiwen@gmail.com>
+ *All rights reserved.
+ *
+ *Redistribution and use in source and binary forms, with or without
+ *modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Redis nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ *THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef OPTIONS_HPP_
+#define OPTIONS_HPP_
+
+#include "mmkv_logger.hpp"
+#include <map>
+#include <vector>
+#define GEO_SEARCH_WITH_DISTANCES "WITHDISTANCES"
+#define GEO_SEARCH_WITH_COORDINATES "WITHCOORDINATES"
+namespace mmkv
+{
+    typedef uint32_t DBID;
+    /*
+     * layout of the hash tables of top level keys
+     */
+    enum TableLayout
+    {
+        PROBING_TABLE_LAYOUT = 0, //quadratic probing, one allocation per entry
+        GROUPED_TABLE_LAYOUT = 1, //swiss table like probing over SSE2 control byte groups, inline entries
+        INLINE_TABLE_LAYOUT = 2, //quadratic probing, entries stored inline in the bucket array
+    };
+    /*
+     * width of zset scores and HIncrByFloat results, DOUBLE_SCORE halves the score storage of zset elements
+     * at the cost of precision.
+     */
+    enum ScorePrecision
+    {
+        LONG_DOUBLE_SCORE = 0, DOUBLE_SCORE = 1
+    };
+    /*
+     * keys evicted once 'max_memory' is exceeded, same meaning as the redis policies of the same name
+     */
+    enum MaxMemoryPolicy
+    {
+        ALLKEYS_LRU = 0, VOLATILE_LRU = 1, ALLKEYS_LFU = 2, VOLATILE_TTL = 3
+    };
+
+    struct CreateOptions
+    {
+            int64_t size;
+            bool autoexpand;
+            TableLayout table_layout; //only used when the store is created
+            ScorePrecision score_precision; //only used when the store is created
+            /*
+             * address range every process maps the data file with, expanding within it only grows the file.
+             * only used when the store is created, expanding beyond it remaps the store.
+             */
+            int64_t map_size;
+            CreateOptions() :
+                    size(1024 * 1024 * 1024), autoexpand(false), table_layout(PROBING_TABLE_LAYOUT), score_precision(
+                            LONG_DOUBLE_SCORE), map_size(sizeof(void*) > 4 ? 64LL * 1024 * 1024 * 1024 : 0)
+            {
+            }
+    };
+
+    /*
+     * return -1 means break remove operations
+     */
+    typedef int ExpireCallback(DBID db, const std::string& key);
+    typedef int RoutineCallback();
+    struct OpenOptions
+    {
+            std::string dir;
+            bool readonly;
+            bool verify;
+            bool reserve_space;
+            bool use_lock;
+            bool per_db_lock;  //lock per db instead of whole store, only works with 'use_lock'
+            bool optimistic_read; //Get/HGet/Exists/ZScore read without lock first, only works with 'use_lock'
+            bool create_if_notexist;
+            bool open_ignore_error;
+            uint32_t hll_sparse_max_bytes;
+            /*
+             * hashes/sets with no more entries than 'max_compact_entries' and no entry longer than
+             * 'max_compact_value' are packed in a single allocation, and converted to btree once
+             * grown beyond. 0 entries disables the packed encoding.
+             * Sets of integer members only are packed as sorted integer array up to 'set_max_intset_entries'.
+             */
+            uint32_t hash_max_compact_entries;
+            uint32_t hash_max_compact_value;
+            uint32_t set_max_compact_entries;
+            uint32_t set_max_compact_value;
+            uint32_t set_max_intset_entries;
+            /*
+             * lists are chunked into nodes of packed entries up to 'list_max_node_bytes', nodes more than
+             * 'list_compress_depth' nodes away from both ends are LZ4 compressed, 0 depth disables compression.
+             */
+            uint32_t list_max_node_bytes;
+            uint32_t list_compress_depth;
+            /*
+             * writer threads of a 'per_db_lock' store keep up to 'alloc_cache_blocks' freed small blocks per
+             * size class and reuse them without taking the shared mspace lock, 0 disables the cache.
+             * blocks cached by a process killed before closing the store are not reclaimed.
+             */
+            uint32_t alloc_cache_blocks;
+            /*
+             * back the data mapping with 2MB pages: the mapping is 2MB aligned, sized in 2MB steps & advised
+             * with MADV_HUGEPAGE. takes effect with 'dir' on a tmpfs mounted with huge=advise (or shmem
+             * huge pages enabled), or on hugetlbfs.
+             */
+            bool huge_pages;
+            LogLevel log_level;
+            LoggerFunc* log_func;
+            ExpireCallback* expire_cb;
+            RoutineCallback* routine_cb;
+            uint32_t routine_slice_micros; //max micros to hold write lock in one routine slice
+            /*
+             * Routine moves small blocks out of sparse slabs while 'FragmentationRatio' is above
+             * 'defrag_ratio', 0 disables defragmentation.
+             */
+            double defrag_ratio;
+            bool trim_after_defrag; //Routine calls 'Trim' once a defragmentation pass is done
+            /*
+             * writes evict keys while the bytes used by stored data exceed 'max_memory', 0 means no limit.
+             * LRU/LFU policies evict the best of 'max_memory_samples' keys sampled from random buckets,
+             * VOLATILE_TTL evicts the key expiring first.
+             */
+            int64_t max_memory;
+            MaxMemoryPolicy max_memory_policy;
+            uint32_t max_memory_samples;
+            CreateOptions create_options;
+
+            OpenOptions() :
+                    dir("./mmkv"), readonly(false), verify(true), reserve_space(false), use_lock(false), per_db_lock(false), optimistic_read(false), create_if_notexist(false), open_ignore_error(false), hll_sparse_max_bytes(
+                            3000), hash_max_compact_entries(128), hash_max_compact_value(64), set_max_compact_entries(
+                            128), set_max_compact_value(64), set_max_intset_entries(512), list_max_node_bytes(8192), list_compress_depth(0), alloc_cache_blocks(0), huge_pages(false), log_level(INFO_LOG_LEVEL), log_func(
+                    NULL), expire_cb(NULL), routine_cb(NULL), routine_slice_micros(1000), defrag_ratio(0), trim_after_defrag(false), max_memory(0), max_memory_policy(
+                    ALLKEYS_LRU), max_memory_samples(5)
+            {
+            }
+    };
+
+    struct GeoSearchOptions
+    {
+            std::string coord_type;
+            bool asc;   //sort by asc
+            uint32_t radius;  //range meters
+            int32_t offset;
+            int32_t limit;
+
+            long double by_x;
+            long double by_y;
+            std::string by_member;
+
+            typedef std::map<std::string, std::string> PatternMap;
+            typedef std::vector<std::string> PatternArray;
+            PatternMap includes;
+            PatternMap excludes;
+            PatternArray get_patterns;
+            GeoSearchOptions() :
+                    coord_type("mercator"), asc(true), radius(0), offset(0), limit(0), by_x(0), by_y(0)
+            {
+            }
+    };
+}
+
+#endif /* OPTIONS_HPP_ */
@@ -0,0 +1,93 @@
+/*
+ *Copyright (c) 2015-2015, yinqiwen <yinqiwen@gmail.com>
+ *All rights reserved.
+ *
+ *Redistribution and use in source and binary forms, with or without
+ *modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Redis nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ *THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MMKV_SLAB_HPP_
+#define MMKV_SLAB_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mmkv
+{
+    /*
+     * Segregated size classes in front of the mspace. Blocks up to 'kSlabMaxSize' bytes are carved from
+     * 64KB slabs of one size class without any per block header, a bitmap in the slab header tracks used
+     * blocks. All links are offsets from the store base so the arena works in every attached process.
+     */
+    static const size_t kSlabSize = 64 * 1024;
+    static const size_t kSlabClassGranularity = 8;
+    static const size_t kSlabMaxSize = 128;
+    static const size_t kSlabClassCount = kSlabMaxSize / kSlabClassGranularity;
+    static const size_t kSlabFramesPerMap = 16384;
+    static const size_t kSlabFrameMapCount = 256;
+    static const uint32_t kMaxSlabCacheBlocks = 256;
+
+    struct SlabArena
+    {
+            int64_t partial[kSlabClassCount]; //offset of the first slab with free blocks of each class, 0 if none
+            /*
+             * offsets of uint16_t slab starts of 64KB frames, one map per 1GB of the store. maps never move
+             * once allocated so blocks can be looked up without the mspace lock.
+             */
+            int64_t frame_maps[kSlabFrameMapCount];
+            uint64_t slab_count;
+            uint64_t used_bytes;
+    };
+
+    /*
+     * 'base' is the address all offsets are relative to, 'msp' the mspace slabs are allocated from,
+     * callers hold the mspace lock.
+     * slab_malloc returns NULL when 'bytes' is larger than 'kSlabMaxSize' or no slab could be allocated.
+     * slab_free & slab_usable_size return false/0 for blocks not allocated by slab_malloc.
+     */
+    void* slab_malloc(SlabArena* arena, char* base, void* msp, size_t bytes);
+    bool slab_free(SlabArena* arena, char* base, void* msp, void* ptr);
+    size_t slab_usable_size(SlabArena* arena, char* base, void* ptr);
+
+    /*
+     * Defragmentation drains sparse slabs into the first partial slab of their class, callers hold the
+     * mspace lock. slab_relocate copies 'ptr' into a new block and frees it, returns NULL if the block is
+     * not served by slabs or its slab is dense enough to stay. slab_free_bytes counts the bytes held by
+     * slabs but not by blocks, which the mspace can not hand out to other sizes.
+     */
+    void* slab_relocate(SlabArena* arena, char* base, void* msp, void* ptr);
+    size_t slab_free_bytes(SlabArena* arena);
+
+    /*
+     * Writer threads of stores opened with 'per_db_lock' & 'alloc_cache_blocks' keep magazines of free slab
+     * blocks per size class, and only take the mspace lock to refill or drain them by half.
+     * slab_cache_malloc/slab_cache_free return NULL/false when the block is not served by the cache, and the
+     * caller falls back to the locked path. slab_cache_flush returns the magazines of the calling thread.
+     */
+    void* slab_cache_malloc(SlabArena* arena, char* base, void* msp, size_t bytes);
+    bool slab_cache_free(SlabArena* arena, char* base, void* msp, void* ptr);
+    void slab_cache_flush(void* msp);
+}
+
+#endif /* MMKV_SLAB_HPP_ */
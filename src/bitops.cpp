@@ -201,7 +201,7 @@ namespace mmkv
         long strlen;
         unsigned char *p;
         char llbuf[32];
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -296,7 +296,7 @@ namespace mmkv
         {
             return ERR_ARGS_EXCEED_LIMIT;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
@@ -348,6 +348,7 @@ namespace mmkv
         if (maxlen)
         {
             //res = AllocateStringValueSpace(maxlen, false);
+            ChargeMemory(V_TYPE_STRING);
             m_segment.ObjectMakeRoom(res, maxlen);
             unsigned char output, byte;
             unsigned long i;
@@ -481,7 +482,7 @@ namespace mmkv
         {
             return ERR_BIT_OUTRANGE;
         }
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -569,7 +570,7 @@ namespace mmkv
         size_t bitoffset = offset;
         size_t byte, bit;
         size_t bitval = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -620,7 +621,7 @@ namespace mmkv
         {
             return ERR_OFFSET_OUTRANGE;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, true);
         if (NULL == kv)
@@ -640,6 +641,7 @@ namespace mmkv
         std::pair<MMKVTable::iterator, bool> ret = kv->insert(MMKVTable::value_type(key_obj, Object()));
         const Object& kk = ret.first->first;
         Object& value_data = ret.first->second;
+        ChargeMemory(V_TYPE_STRING);
         if (!ret.second)
         {
             if (value_data.type != V_TYPE_STRING)
@@ -11,6 +11,11 @@
 #include <boost/interprocess/offset_ptr.hpp>
 #include <assert.h>
 #include <string.h>
+#include <stdint.h>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // The probing method
 // Linear probing
@@ -54,7 +59,7 @@ namespace mmkv
             // Happy dereferencer
             ht_reference operator*() const
             {
-                return *((*vals)[pos]);
+                return *(ht->entry(pos));
             }
             ht_pointer operator->() const
             {
@@ -158,7 +163,7 @@ namespace mmkv
             // Happy dereferencer
             ht_reference operator*() const
             {
-                return *((*vals)[pos]);
+                return *(ht->entry(pos));
             }
             pointer operator->() const
             {
@@ -247,13 +252,30 @@ namespace mmkv
         private:
             typedef typename Alloc::template rebind<offset_pointer>::other internal_value_alloc_type;
             typedef typename Alloc::template rebind<char>::other flags_value_alloc_type;
+            typedef typename Alloc::template rebind<uint32_t>::other hashes_alloc_type;
 
             typedef boost::interprocess::offset_ptr<char> flags_offset_pointer;
+            typedef boost::interprocess::offset_ptr<uint32_t> hashes_offset_pointer;
 
             static const size_type FLAG_DELETED = 2;
             static const size_type FLAG_SETTED = 1;
             static const size_type FLAG_EMPTY = 0;
+
+            // control bytes of grouped layout, a setted bucket holds 7 bits of its hash code
+            static const uint8_t CTRL_EMPTY = 0x80;
+            static const uint8_t CTRL_DELETED = 0xFE;
         public:
+            /*
+             * LAYOUT_PROBING: quadratic probing over a 2 bits flags array, entries allocated one by one.
+             * LAYOUT_GROUPED: swiss table like, buckets are probed by groups of GROUP_WIDTH control bytes
+             *                 (with SSE2 when available), entries are stored inline in a slot array.
+             * LAYOUT_INLINE:  same probing as LAYOUT_PROBING, entries are stored inline in a slot array
+             *                 instead of allocated one by one.
+             */
+            static const uint32_t LAYOUT_PROBING = 0;
+            static const uint32_t LAYOUT_GROUPED = 1;
+            static const uint32_t LAYOUT_INLINE = 2;
+            static const size_type GROUP_WIDTH = 16;
             typedef fixed_hashtable_iterator<value_type, Key, ht_type> iterator;
             typedef fixed_hashtable_const_iterator<value_type, Key, ht_type> const_iterator;
             static const size_type ILLEGAL_BUCKET = size_type(-1);
@@ -263,6 +285,11 @@ namespace mmkv
             size_t num_deleted;
             internal_values_pointer table;
             flags_offset_pointer flags;
+            //low 32 bits of the hash code of every setted bucket
+            hashes_offset_pointer hashes;
+            //inline entries of grouped/inline layout
+            offset_pointer slots;
+            uint32_t layout;
 
             value_alloc_type allocator;
 
@@ -295,13 +322,76 @@ namespace mmkv
                 hasher h;
                 return h(v);
             }
+            static uint32_t short_hash(size_type h)
+            {
+                return (uint32_t) h;
+            }
             bool equals(const key_type& a, const key_type& b) const
             {
                 key_equal eq;
                 return eq(a, b);
             }
+            bool grouped() const
+            {
+                return layout == LAYOUT_GROUPED;
+            }
+            bool inline_entries() const
+            {
+                return layout != LAYOUT_PROBING;
+            }
+            static uint64_t group_hash(size_type h)
+            {
+                return (uint64_t) h * 0x9E3779B97F4A7C15ULL;
+            }
+            static uint8_t ctrl_hash(uint64_t gh)
+            {
+                return (uint8_t) ((gh >> 25) & 0x7F);
+            }
+            static uint32_t group_match(const char* ctrl, uint8_t v)
+            {
+#if defined(__SSE2__)
+                __m128i group = _mm_loadu_si128((const __m128i*) ctrl);
+                return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) v)));
+#else
+                uint32_t mask = 0;
+                for (size_type i = 0; i < GROUP_WIDTH; i++)
+                {
+                    if ((uint8_t) ctrl[i] == v)
+                    {
+                        mask |= (1U << i);
+                    }
+                }
+                return mask;
+#endif
+            }
+            // empty or deleted buckets, both have the high bit setted
+            static uint32_t group_match_free(const char* ctrl)
+            {
+#if defined(__SSE2__)
+                return (uint32_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) ctrl));
+#else
+                uint32_t mask = 0;
+                for (size_type i = 0; i < GROUP_WIDTH; i++)
+                {
+                    if ((uint8_t) ctrl[i] & 0x80)
+                    {
+                        mask |= (1U << i);
+                    }
+                }
+                return mask;
+#endif
+            }
             uint8_t get_flag(size_type bucknum) const
             {
+                if (grouped())
+                {
+                    uint8_t c = (uint8_t) flags[bucknum];
+                    if (c == CTRL_EMPTY)
+                    {
+                        return FLAG_EMPTY;
+                    }
+                    return c == CTRL_DELETED ? FLAG_DELETED : FLAG_SETTED;
+                }
                 size_t bitoffset = bucknum << 1;
                 size_t byte = bitoffset >> 3;
                 uint8_t byteval = (uint8_t) flags[byte];
@@ -310,6 +400,12 @@ namespace mmkv
             }
             void set_flag(size_type bucknum, uint8_t v) const
             {
+                if (grouped())
+                {
+                    assert(v != FLAG_SETTED);
+                    flags[bucknum] = (char) (v == FLAG_EMPTY ? CTRL_EMPTY : CTRL_DELETED);
+                    return;
+                }
                 size_t bitoffset = bucknum << 1;
                 size_t byte = bitoffset >> 3;
                 uint8_t* ss = (uint8_t*) (flags.get());
@@ -319,8 +415,14 @@ namespace mmkv
                 //byteval = (((byteval >> bit) & v) << bit) | (byteval & (0xFF >> (8 - bit)));
                 ss[byte] = byteval;
             }
-            void set_occupied(size_type pos)
+            void set_occupied(size_type pos, size_type hashcode)
             {
+                if (grouped())
+                {
+                    flags[pos] = (char) ctrl_hash(group_hash(hashcode));
+                    return;
+                }
+                hashes[pos] = short_hash(hashcode);
                 set_flag(pos, FLAG_SETTED);
             }
             void set_deleted(size_type pos)
@@ -356,9 +458,19 @@ namespace mmkv
             std::pair<size_type, size_type> find_position(
                     const key_type &key) const
             {
+                return find_position(key, hash(key));
+            }
+            std::pair<size_type, size_type> find_position(
+                    const key_type &key, size_type hashcode) const
+            {
+                if (grouped())
+                {
+                    return find_group_position(key, hashcode);
+                }
                 size_type num_probes = 0;         // how many times we've probed
                 const size_type bucket_count_minus_one = bucket_count() - 1;
-                size_type bucknum = hash(key) & bucket_count_minus_one;
+                size_type bucknum = hashcode & bucket_count_minus_one;
+                const uint32_t h = short_hash(hashcode);
                 size_type insert_pos = ILLEGAL_BUCKET; // where we would insert
                 while (1)
                 {                          // probe until something happens
@@ -377,7 +489,7 @@ namespace mmkv
                             insert_pos = bucknum;
 
                     }
-                    else if (equals(key, get_key(*(table[bucknum]))))
+                    else if (hashes[bucknum] == h && equals(key, get_key(*entry(bucknum))))
                     {
                         return std::pair<size_type, size_type>(bucknum,
                                 ILLEGAL_BUCKET);
@@ -385,9 +497,105 @@ namespace mmkv
                     ++num_probes;                   // we're doing another probe
                     bucknum = (bucknum + JUMP_(key, num_probes))
                             & bucket_count_minus_one;
-                    assert(
-                            num_probes < bucket_count()
-                                    && "Hashtable is full: an error in key_equal<> or hash<>");
+                    //never spin forever on a table modified by a concurrent writer(optimistic read)
+                    if (num_probes >= bucket_count())
+                    {
+                        return std::pair<size_type, size_type>(ILLEGAL_BUCKET, insert_pos);
+                    }
+                }
+            }
+            std::pair<size_type, size_type> find_group_position(
+                    const key_type &key, size_type hashcode) const
+            {
+                const uint64_t gh = group_hash(hashcode);
+                const uint8_t h = ctrl_hash(gh);
+                const size_type group_mask = num_buckets / GROUP_WIDTH - 1;
+                size_type group = (size_type) (gh >> 32) & group_mask;
+                size_type insert_pos = ILLEGAL_BUCKET;
+                const char* ctrl = flags.get();
+                //every group is visited once at most since group count is power of 2
+                for (size_type num_probes = 0; num_probes <= group_mask;)
+                {
+                    const char* g = ctrl + group * GROUP_WIDTH;
+                    uint32_t match = group_match(g, h);
+                    while (match != 0)
+                    {
+                        size_type pos = group * GROUP_WIDTH + __builtin_ctz(match);
+                        if (equals(key, get_key(*entry(pos))))
+                        {
+                            return std::pair<size_type, size_type>(pos, ILLEGAL_BUCKET);
+                        }
+                        match &= (match - 1);
+                    }
+                    if (insert_pos == ILLEGAL_BUCKET)
+                    {
+                        uint32_t free = group_match_free(g);
+                        if (free != 0)
+                        {
+                            insert_pos = group * GROUP_WIDTH + __builtin_ctz(free);
+                        }
+                    }
+                    if (group_match(g, CTRL_EMPTY) != 0)
+                    {
+                        break;
+                    }
+                    ++num_probes;
+                    group = (group + num_probes) & group_mask;
+                }
+                return std::pair<size_type, size_type>(ILLEGAL_BUCKET, insert_pos);
+            }
+            // probes from the home bucket of 'hashcode' to bucket 'target'
+            size_type probe_count(size_type hashcode, size_type target) const
+            {
+                size_type num_probes = 0;
+                if (grouped())
+                {
+                    const size_type group_mask = num_buckets / GROUP_WIDTH - 1;
+                    size_type group = (size_type) (group_hash(hashcode) >> 32) & group_mask;
+                    while (group != target / GROUP_WIDTH && num_probes <= group_mask)
+                    {
+                        ++num_probes;
+                        group = (group + num_probes) & group_mask;
+                    }
+                    return num_probes;
+                }
+                const size_type bucket_count_minus_one = bucket_count() - 1;
+                size_type bucknum = hashcode & bucket_count_minus_one;
+                while (bucknum != target && num_probes < num_buckets)
+                {
+                    ++num_probes;
+                    bucknum = (bucknum + JUMP_(hashcode, num_probes)) & bucket_count_minus_one;
+                }
+                return num_probes;
+            }
+            // first empty or deleted bucket of the probe sequence of 'hashcode'
+            size_type find_free_position(size_type hashcode) const
+            {
+                if (!grouped())
+                {
+                    const size_type bucket_count_minus_one = bucket_count() - 1;
+                    size_type bucknum = hashcode & bucket_count_minus_one;
+                    size_type num_probes = 0;
+                    while (test_setted(bucknum))
+                    {
+                        ++num_probes;
+                        bucknum = (bucknum + JUMP_(hashcode, num_probes)) & bucket_count_minus_one;
+                    }
+                    return bucknum;
+                }
+                const uint64_t gh = group_hash(hashcode);
+                const size_type group_mask = num_buckets / GROUP_WIDTH - 1;
+                size_type group = (size_type) (gh >> 32) & group_mask;
+                size_type num_probes = 0;
+                while (1)
+                {
+                    uint32_t free = group_match_free(flags.get() + group * GROUP_WIDTH);
+                    if (free != 0)
+                    {
+                        return group * GROUP_WIDTH + __builtin_ctz(free);
+                    }
+                    ++num_probes;
+                    group = (group + num_probes) & group_mask;
                 }
             }
             typename ExtractKey::result_type get_key(const_reference v) const
@@ -398,21 +606,25 @@ namespace mmkv
             // const components (they're probably pair<const X, Y>).  We use
             // explicit destructor invocation and placement new to get around
             // this.  Arg.
-            void set_value(size_t bucket_pos, const_reference src)
+            void set_value(size_t bucket_pos, const_reference src, size_type hashcode)
             {
                 value_type* v = NULL;
                 if (test_setted(bucket_pos))
                 {
-                    v = table[bucket_pos].get();
+                    v = entry(bucket_pos);
                     v->~value_type();
                 }
+                else if (inline_entries())
+                {
+                    v = entry(bucket_pos);
+                }
                 else
                 {
                     v = allocator.allocate(1);
                     table[bucket_pos] = v;
                 }
                 new (v) value_type(src);
-                set_occupied(bucket_pos);
+                set_occupied(bucket_pos, hashcode);
             }
 
             void destroy_buckets(size_type first, size_type last)
@@ -421,13 +633,20 @@ namespace mmkv
                 {
                     if (test_setted(first))
                     {
-                        allocator.destroy(table[first].get());
+                        if (inline_entries())
+                        {
+                            entry(first)->~value_type();
+                        }
+                        else
+                        {
+                            allocator.destroy_ptr(table[first].get());
+                        }
                     }
                     set_empty(first);
                 }
             }
             // Private method used by insert_noresize and find_or_insert.
-            iterator insert_at(const_reference obj, size_type pos)
+            iterator insert_at(const_reference obj, size_type pos, size_type hashcode)
             {
                 if (test_deleted(pos))
                 {      // just replace if it's been del.
@@ -440,7 +659,7 @@ namespace mmkv
                 {
                     ++num_elements;               // replacing an empty bucket
                 }
-                set_value(pos, obj);
+                set_value(pos, obj, hashcode);
                 return iterator(this, pos, &table, false);
             }
             bool set_deleted(iterator &it)
@@ -450,31 +669,85 @@ namespace mmkv
                     return false;
                 }
                 set_deleted(it.position());
-                value_type* val = table[it.position()].get();
+                value_type* val = entry(it.position());
                 val->~value_type();
-                allocator.deallocate(val, 1);
+                if (!inline_entries())
+                {
+                    allocator.deallocate(val, 1);
+                }
                 return true;
             }
         public:
-            fixed_hashtable(size_t init_capacity, const Alloc& alloc = Alloc()) :
-                    num_elements(0), num_buckets(0), num_deleted(0), allocator(
-                            alloc)
+            fixed_hashtable(size_t init_capacity, const Alloc& alloc = Alloc(), uint32_t table_layout =
+                    LAYOUT_PROBING) :
+                    num_elements(0), num_buckets(0), num_deleted(0), layout(table_layout), allocator(alloc)
             {
-                internal_value_alloc_type internal_allocator(allocator);
                 flags_value_alloc_type flags_allocator(allocator);
-                offset_pointer* vals = internal_allocator.allocate(
-                        init_capacity + 1);
-                table = vals;
+                if (grouped())
+                {
+                    if (init_capacity < GROUP_WIDTH)
+                    {
+                        init_capacity = GROUP_WIDTH;
+                    }
+                    flags = flags_allocator.allocate(init_capacity);
+                    memset(flags.get(), CTRL_EMPTY, init_capacity);
+                    slots = allocator.allocate(init_capacity);
+                    num_buckets = init_capacity;
+                    return;
+                }
+                if (inline_entries())
+                {
+                    slots = allocator.allocate(init_capacity);
+                }
+                else
+                {
+                    internal_value_alloc_type internal_allocator(allocator);
+                    offset_pointer* vals = internal_allocator.allocate(
+                            init_capacity + 1);
+                    table = vals;
+                }
                 size_t flags_size = (init_capacity / 4) + 1;
                 flags = flags_allocator.allocate(flags_size);
                 memset(flags.get(), 0, flags_size);
+                hashes_alloc_type hashes_allocator(allocator);
+                hashes = hashes_allocator.allocate(init_capacity);
+                memset(hashes.get(), 0, sizeof(uint32_t) * init_capacity);
                 num_buckets = init_capacity;
             }
-            static size_t estimate_memory_size(size_t capacity)
+            static size_t estimate_memory_size(size_t capacity, uint32_t table_layout = LAYOUT_PROBING)
             {
-                size_t n = sizeof(offset_pointer) * (capacity + 1);
+                if (table_layout == LAYOUT_GROUPED)
+                {
+                    return capacity * (sizeof(value_type) + 1);
+                }
+                size_t n = table_layout == LAYOUT_INLINE ?
+                        sizeof(value_type) * capacity : sizeof(offset_pointer) * (capacity + 1);
                 size_t flags_size = (capacity / 4) + 1;
-                return n + flags_size;
+                return n + flags_size + sizeof(uint32_t) * capacity;
+            }
+            uint32_t get_layout() const
+            {
+                return layout;
+            }
+            /*
+             * LAYOUT_PROBING entries are allocated one by one, an entry copied elsewhere is repointed here
+             */
+            bool allocated_entries() const
+            {
+                return !inline_entries();
+            }
+            void relocate_entry(size_type pos, value_type* v)
+            {
+                assert(allocated_entries());
+                table[pos] = v;
+            }
+            value_type* entry(size_type pos) const
+            {
+                if (inline_entries())
+                {
+                    return slots.get() + pos;
+                }
+                return table[pos].get();
             }
             value_alloc_type get_allocator() const
             {
@@ -524,8 +797,9 @@ namespace mmkv
             // If you know *this is big enough to hold obj, use this routine
             std::pair<iterator, bool> insert_noresize(const_reference obj)
             {
+                const size_type hashcode = hash(get_key(obj));
                 const std::pair<size_type, size_type> pos = find_position(
-                        get_key(obj));
+                        get_key(obj), hashcode);
                 if (pos.first != ILLEGAL_BUCKET)
                 {      // object was already there
                     return std::pair<iterator, bool>(
@@ -533,20 +807,128 @@ namespace mmkv
                 }
                 else
                 {                             // pos.second says where to put it
-                    return std::pair<iterator, bool>(insert_at(obj, pos.second),
+                    return std::pair<iterator, bool>(insert_at(obj, pos.second, hashcode),
                             true);
                 }
             }
+            /*
+             * Move the entry of 'src' at bucket 'pos' into this table, keys are never compared.
+             * Probing/inline layout reuse the cached hash code, grouped layout rehashes the key.
+             * Allocated entries are moved by pointer, inline entries are copied.
+             * Caller makes sure the key is not in this table, both tables have same layout.
+             */
+            void move_from(ht_type& src, size_type pos)
+            {
+                assert(layout == src.layout);
+                //bucket count never exceeds 2^32, so the short hash selects the same bucket
+                const size_type hashcode = grouped() ? hash(get_key(*src.entry(pos))) : src.hashes[pos];
+                size_type bucknum = find_free_position(hashcode);
+                if (test_deleted(bucknum))
+                {
+                    --num_deleted;
+                }
+                else
+                {
+                    ++num_elements;
+                }
+                if (inline_entries())
+                {
+                    value_type* v = src.entry(pos);
+                    new (entry(bucknum)) value_type(*v);
+                    v->~value_type();
+                }
+                else
+                {
+                    table[bucknum] = src.table[pos];
+                }
+                set_occupied(bucknum, hashcode);
+                src.set_deleted(pos);
+                ++src.num_deleted;
+            }
             iterator find(const key_type& key)
+            {
+                return find(key, hash(key));
+            }
+            iterator find(const key_type& key, size_type hashcode)
             {
                 if (size() == 0)
                     return end();
-                std::pair<size_type, size_type> pos = find_position(key);
+                std::pair<size_type, size_type> pos = find_position(key, hashcode);
                 if (pos.first == ILLEGAL_BUCKET)     // alas, not there
                     return end();
                 else
                     return iterator(this, pos.first, &table, false);
             }
+            size_type hash_code(const key_type& key) const
+            {
+                return hash(key);
+            }
+            /*
+             * Scan all buckets, histogram[n] is the count of entries found after 'n' probes
+             * (0 means found in its home bucket, or home group for grouped layout).
+             */
+            void probe_histogram(std::vector<uint64_t>& histogram) const
+            {
+                for (size_type pos = 0; pos < num_buckets; pos++)
+                {
+                    if (!test_setted(pos))
+                    {
+                        continue;
+                    }
+                    size_type hashcode = grouped() ? hash(get_key(*entry(pos))) : hashes[pos];
+                    size_type n = probe_count(hashcode, pos);
+                    if (histogram.size() <= n)
+                    {
+                        histogram.resize(n + 1);
+                    }
+                    histogram[n]++;
+                }
+            }
+            /*
+             * Batched lookup: prefetch the home bucket of every key first, then the entries
+             * (the bucket is in cache by then), then find(key, hashcode) them one by one.
+             */
+            void prefetch(size_type hashcode) const
+            {
+                if (grouped())
+                {
+                    const size_type group_mask = num_buckets / GROUP_WIDTH - 1;
+                    size_type pos = ((size_type) (group_hash(hashcode) >> 32) & group_mask) * GROUP_WIDTH;
+                    __builtin_prefetch(flags.get() + pos);
+                    return;
+                }
+                size_type pos = hashcode & (num_buckets - 1);
+                __builtin_prefetch(flags.get() + (pos >> 2));
+                __builtin_prefetch(hashes.get() + pos);
+                if (inline_entries())
+                {
+                    __builtin_prefetch(slots.get() + pos);
+                }
+                else
+                {
+                    __builtin_prefetch(table.get() + pos);
+                }
+            }
+            void prefetch_entry(size_type hashcode) const
+            {
+                if (grouped())
+                {
+                    const uint64_t gh = group_hash(hashcode);
+                    const size_type group_mask = num_buckets / GROUP_WIDTH - 1;
+                    size_type pos = ((size_type) (gh >> 32) & group_mask) * GROUP_WIDTH;
+                    uint32_t match = group_match(flags.get() + pos, ctrl_hash(gh));
+                    if (match != 0)
+                    {
+                        __builtin_prefetch(slots.get() + pos + __builtin_ctz(match));
+                    }
+                    return;
+                }
+                size_type pos = hashcode & (num_buckets - 1);
+                if (!inline_entries() && test_setted(pos))
+                {
+                    __builtin_prefetch(table[pos].get());
+                }
+            }
             // DELETION ROUTINES
             size_type erase(const key_type& key)
             {
@@ -563,6 +945,10 @@ namespace mmkv
                     return 0;                    // because we deleted nothing
                 }
             }
+            bool bucket_setted(size_type bucknum) const
+            {
+                return test_setted(bucknum);
+            }
             bool valid_iterator(iterator it)
             {
                 return it.ht == this;
@@ -616,10 +1002,23 @@ namespace mmkv
             ~fixed_hashtable()
             {
                 clear();
-                internal_value_alloc_type internal_allocator(allocator);
-                internal_allocator.deallocate(table.get(), 1);
                 flags_value_alloc_type flags_allocator(allocator);
                 flags_allocator.deallocate(flags.get(), 1);
+                if (inline_entries())
+                {
+                    allocator.deallocate(slots.get(), 1);
+                }
+                else
+                {
+                    internal_value_alloc_type internal_allocator(allocator);
+                    internal_allocator.deallocate(table.get(), 1);
+                }
+                if (grouped())
+                {
+                    return;
+                }
+                hashes_alloc_type hashes_allocator(allocator);
+                hashes_allocator.deallocate(hashes.get(), 1);
             }
     };
     template<class V, class K, class HF, class ExK, class SetK, class EqK,
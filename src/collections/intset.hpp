@@ -0,0 +1,228 @@
+/*
+ *Copyright (c) 2015-2015, yinqiwen <yinqiwen@gmail.com>
+ *All rights reserved.
+ *
+ *Redistribution and use in source and binary forms, with or without
+ *modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Redis nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ *THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SRC_COLLECTIONS_INTSET_HPP_
+#define SRC_COLLECTIONS_INTSET_HPP_
+
+#include <stdint.h>
+#include <string.h>
+#include <limits>
+
+namespace mmkv
+{
+    /*
+     * Set of integers packed as a sorted array of 16/32/64 bits values after a fixed header:
+     *     [width:4][count:4][v0][v1]...
+     * All values share the width of the widest one, the array is widened in place when a value
+     * out of current width is inserted. The buffer is owned by the caller, which has to make room
+     * before 'Insert'.
+     */
+    class IntSet
+    {
+        private:
+            struct Header
+            {
+                    uint32_t width; //bytes of each value
+                    uint32_t count;
+            };
+            char* m_buf;
+            size_t m_capacity;
+            Header* GetHeader() const
+            {
+                return (Header*) m_buf;
+            }
+            static int64_t Read(const char* p, uint32_t width)
+            {
+                switch (width)
+                {
+                    case sizeof(int16_t):
+                    {
+                        int16_t v;
+                        memcpy(&v, p, sizeof(v));
+                        return v;
+                    }
+                    case sizeof(int32_t):
+                    {
+                        int32_t v;
+                        memcpy(&v, p, sizeof(v));
+                        return v;
+                    }
+                    default:
+                    {
+                        int64_t v;
+                        memcpy(&v, p, sizeof(v));
+                        return v;
+                    }
+                }
+            }
+            static void Write(char* p, uint32_t width, int64_t v)
+            {
+                switch (width)
+                {
+                    case sizeof(int16_t):
+                    {
+                        int16_t v16 = (int16_t) v;
+                        memcpy(p, &v16, sizeof(v16));
+                        break;
+                    }
+                    case sizeof(int32_t):
+                    {
+                        int32_t v32 = (int32_t) v;
+                        memcpy(p, &v32, sizeof(v32));
+                        break;
+                    }
+                    default:
+                    {
+                        memcpy(p, &v, sizeof(v));
+                        break;
+                    }
+                }
+            }
+            char* Values() const
+            {
+                return m_buf + sizeof(Header);
+            }
+        public:
+            IntSet(const char* buf, size_t capacity) :
+                    m_buf(const_cast<char*>(buf)), m_capacity(capacity)
+            {
+            }
+            static size_t EmptyBytes()
+            {
+                return sizeof(Header);
+            }
+            static void Init(char* buf)
+            {
+                Header* header = (Header*) buf;
+                header->width = sizeof(int16_t);
+                header->count = 0;
+            }
+            static uint32_t WidthOf(int64_t v)
+            {
+                if (v >= std::numeric_limits<int16_t>::min() && v <= std::numeric_limits<int16_t>::max())
+                {
+                    return sizeof(int16_t);
+                }
+                if (v >= std::numeric_limits<int32_t>::min() && v <= std::numeric_limits<int32_t>::max())
+                {
+                    return sizeof(int32_t);
+                }
+                return sizeof(int64_t);
+            }
+            uint32_t Width() const
+            {
+                return GetHeader()->width;
+            }
+            size_t Count() const
+            {
+                size_t max_count = (m_capacity - sizeof(Header)) / Width();
+                return GetHeader()->count < max_count ? GetHeader()->count : max_count;
+            }
+            size_t Bytes() const
+            {
+                return sizeof(Header) + Width() * Count();
+            }
+            int64_t Get(size_t idx) const
+            {
+                return Read(Values() + idx * Width(), Width());
+            }
+            /*
+             * binary search, 'idx' is set to the position 'v' is at or would be inserted at
+             */
+            bool Find(int64_t v, size_t& idx) const
+            {
+                size_t low = 0, high = Count();
+                while (low < high)
+                {
+                    size_t mid = low + (high - low) / 2;
+                    int64_t cur = Get(mid);
+                    if (cur == v)
+                    {
+                        idx = mid;
+                        return true;
+                    }
+                    if (cur < v)
+                    {
+                        low = mid + 1;
+                    }
+                    else
+                    {
+                        high = mid;
+                    }
+                }
+                idx = low;
+                return false;
+            }
+            /*
+             * buffer size needed after 'v' inserted
+             */
+            size_t BytesAfterInsert(int64_t v) const
+            {
+                uint32_t width = WidthOf(v) > Width() ? WidthOf(v) : Width();
+                return sizeof(Header) + width * (Count() + 1);
+            }
+            /*
+             * insert 'v' at 'idx' returned by 'Find', caller makes sure the buffer has room for
+             * BytesAfterInsert(v)
+             */
+            void Insert(size_t idx, int64_t v)
+            {
+                uint32_t width = Width();
+                size_t count = Count();
+                uint32_t new_width = WidthOf(v);
+                if (new_width > width)
+                {
+                    //a value needs wider encoding is either smaller or larger than all others
+                    size_t offset = v < 0 ? 1 : 0;
+                    for (size_t i = count; i > 0; i--)
+                    {
+                        Write(Values() + (i - 1 + offset) * new_width, new_width,
+                                Read(Values() + (i - 1) * width, width));
+                    }
+                    idx = v < 0 ? 0 : count;
+                    GetHeader()->width = new_width;
+                    width = new_width;
+                }
+                else
+                {
+                    memmove(Values() + (idx + 1) * width, Values() + idx * width, (count - idx) * width);
+                }
+                Write(Values() + idx * width, width, v);
+                GetHeader()->count++;
+            }
+            void Erase(size_t idx)
+            {
+                uint32_t width = Width();
+                memmove(Values() + idx * width, Values() + (idx + 1) * width, (Count() - idx - 1) * width);
+                GetHeader()->count--;
+            }
+    };
+}
+
+#endif /* SRC_COLLECTIONS_INTSET_HPP_ */
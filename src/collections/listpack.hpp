@@ -0,0 +1,260 @@
+/*
+ *Copyright (c) 2015-2015, yinqiwen <yinqiwen@gmail.com>
+ *All rights reserved.
+ *
+ *Redistribution and use in source and binary forms, with or without
+ *modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Redis nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ *THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SRC_COLLECTIONS_LISTPACK_HPP_
+#define SRC_COLLECTIONS_LISTPACK_HPP_
+
+#include <stdint.h>
+#include <string.h>
+#include "types.hpp"
+
+namespace mmkv
+{
+    /*
+     * Small hash/set packed into a single allocation, entries are length prefixed strings stored
+     * back to back after a fixed header:
+     *     [bytes:4][count:4] [len:1|0xFF len:4][data] [len:1|0xFF len:4][data] ...
+     * Hash fields & values are adjacent entries, set members are kept sorted in 'Object' order.
+     * The buffer is owned by the caller, which has to make room before 'Insert'/'Replace'.
+     */
+    class ListPack
+    {
+        private:
+            struct Header
+            {
+                    uint32_t bytes; //used bytes including header
+                    uint32_t count;
+            };
+            static const uint8_t kLongLen = 0xFF;
+            char* m_buf;
+            size_t m_capacity;
+            Header* GetHeader() const
+            {
+                return (Header*) m_buf;
+            }
+            static Data Normalize(const Data& v, char* buf, size_t buflen)
+            {
+                if (NULL == v.Value())
+                {
+                    //integer data
+                    return Data(buf, ll2string(buf, buflen, (long long) v.Len()));
+                }
+                return v;
+            }
+            static size_t PrefixBytes(size_t len)
+            {
+                return len < kLongLen ? 1 : 1 + sizeof(uint32_t);
+            }
+            void Write(size_t pos, const Data& v)
+            {
+                char* p = m_buf + pos;
+                if (v.Len() < kLongLen)
+                {
+                    *(uint8_t*) p = (uint8_t) v.Len();
+                    p++;
+                }
+                else
+                {
+                    *(uint8_t*) p = kLongLen;
+                    uint32_t len = v.Len();
+                    memcpy(p + 1, &len, sizeof(len));
+                    p += 1 + sizeof(len);
+                }
+                memcpy(p, v.Value(), v.Len());
+            }
+            size_t EntryLen(size_t pos, size_t& prefix) const
+            {
+                uint8_t len = *(const uint8_t*) (m_buf + pos);
+                if (len < kLongLen)
+                {
+                    prefix = 1;
+                    return len;
+                }
+                uint32_t long_len;
+                memcpy(&long_len, m_buf + pos + 1, sizeof(long_len));
+                prefix = 1 + sizeof(long_len);
+                return long_len;
+            }
+        public:
+            /*
+             * 'capacity' bounds every entry access, so that a buffer changed by a concurrent
+             * writer(optimistic read) never leads reads out of the allocation.
+             */
+            ListPack(const char* buf, size_t capacity) :
+                    m_buf(const_cast<char*>(buf)), m_capacity(capacity)
+            {
+            }
+            static size_t EmptyBytes()
+            {
+                return sizeof(Header);
+            }
+            static void Init(char* buf)
+            {
+                Header* header = (Header*) buf;
+                header->bytes = sizeof(Header);
+                header->count = 0;
+            }
+            static size_t EntryBytes(const Data& v)
+            {
+                char buf[32];
+                Data d = Normalize(v, buf, sizeof(buf));
+                return PrefixBytes(d.Len()) + d.Len();
+            }
+            size_t Count() const
+            {
+                return GetHeader()->count;
+            }
+            size_t Bytes() const
+            {
+                return GetHeader()->bytes;
+            }
+            size_t Begin() const
+            {
+                return sizeof(Header);
+            }
+            size_t End() const
+            {
+                return Bytes() < m_capacity ? Bytes() : m_capacity;
+            }
+            size_t Next(size_t pos) const
+            {
+                if (pos >= End())
+                {
+                    return End();
+                }
+                size_t prefix;
+                size_t len = EntryLen(pos, prefix);
+                size_t next = pos + prefix + len;
+                return next < End() ? next : End();
+            }
+            Data Get(size_t pos) const
+            {
+                if (pos >= End())
+                {
+                    return Data();
+                }
+                size_t prefix;
+                size_t len = EntryLen(pos, prefix);
+                if (pos + prefix + len > End())
+                {
+                    return Data();
+                }
+                return Data(m_buf + pos + prefix, len);
+            }
+            /*
+             * position of the first entry equal to 'v' among every 'step'th entries, End() if none
+             */
+            size_t Find(const Data& v, size_t step = 1) const
+            {
+                char buf[32];
+                Data d = Normalize(v, buf, sizeof(buf));
+                size_t pos = Begin();
+                while (pos < End())
+                {
+                    Data entry = Get(pos);
+                    if (entry.Len() == d.Len() && 0 == memcmp(entry.Value(), d.Value(), d.Len()))
+                    {
+                        return pos;
+                    }
+                    for (size_t i = 0; i < step && pos < End(); i++)
+                    {
+                        pos = Next(pos);
+                    }
+                }
+                return End();
+            }
+            /*
+             * first entry not less than 'v' in a sorted pack
+             */
+            size_t LowerBound(const Object& v, bool& found) const
+            {
+                found = false;
+                size_t pos = Begin();
+                while (pos < End())
+                {
+                    int cmp = Object(Get(pos), true).Compare(v);
+                    if (cmp >= 0)
+                    {
+                        found = cmp == 0;
+                        return pos;
+                    }
+                    pos = Next(pos);
+                }
+                return End();
+            }
+            /*
+             * caller makes sure the buffer has room for Bytes() + EntryBytes(v)
+             */
+            void Insert(size_t pos, const Data& v)
+            {
+                char buf[32];
+                Data d = Normalize(v, buf, sizeof(buf));
+                size_t entry_bytes = PrefixBytes(d.Len()) + d.Len();
+                memmove(m_buf + pos + entry_bytes, m_buf + pos, Bytes() - pos);
+                Write(pos, d);
+                GetHeader()->bytes += entry_bytes;
+                GetHeader()->count++;
+            }
+            /*
+             * caller makes sure the buffer has room for Bytes() + EntryBytes(v) - old entry bytes
+             */
+            void Replace(size_t pos, const Data& v)
+            {
+                char buf[32];
+                Data d = Normalize(v, buf, sizeof(buf));
+                size_t next = Next(pos);
+                size_t old_bytes = next - pos;
+                size_t entry_bytes = PrefixBytes(d.Len()) + d.Len();
+                if (entry_bytes != old_bytes)
+                {
+                    memmove(m_buf + pos + entry_bytes, m_buf + next, Bytes() - next);
+                    GetHeader()->bytes = GetHeader()->bytes + entry_bytes - old_bytes;
+                }
+                Write(pos, d);
+            }
+            /*
+             * erase 'n' entries starting at 'pos'
+             */
+            void Erase(size_t pos, size_t n)
+            {
+                size_t end = pos;
+                size_t erased = 0;
+                while (erased < n && end < End())
+                {
+                    end = Next(end);
+                    erased++;
+                }
+                memmove(m_buf + pos, m_buf + end, Bytes() - end);
+                GetHeader()->bytes -= (end - pos);
+                GetHeader()->count -= erased;
+            }
+    };
+}
+
+#endif /* SRC_COLLECTIONS_LISTPACK_HPP_ */
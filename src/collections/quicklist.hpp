@@ -0,0 +1,631 @@
+/*
+ *Copyright (c) 2015-2015, yinqiwen <yinqiwen@gmail.com>
+ *All rights reserved.
+ *
+ *Redistribution and use in source and binary forms, with or without
+ *modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Redis nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ *THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SRC_COLLECTIONS_QUICKLIST_HPP_
+#define SRC_COLLECTIONS_QUICKLIST_HPP_
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/interprocess/containers/deque.hpp>
+#include "mmkv_allocator.hpp"
+#include "collections/listpack.hpp"
+#include "lz4.h"
+
+namespace mmkv
+{
+    /*
+     * List of strings stored as a deque of 'ListPack' nodes, a node takes new entries until it
+     * reaches 'node_bytes'. With a non zero 'compress_depth', nodes more than 'compress_depth'
+     * nodes away from both ends are LZ4 compressed, push/pop at both ends never touch a compressed
+     * node.
+     */
+    class QuickList
+    {
+        public:
+            class Iterator;
+            friend class Iterator;
+            struct Node
+            {
+                    boost::interprocess::offset_ptr<char> buf;
+                    uint32_t capacity; //allocated bytes of 'buf'
+                    uint32_t bytes; //list pack bytes, also the decompressed size of a compressed node
+                    uint32_t count;
+                    uint32_t compressed; //compressed bytes, 0 for raw node
+                    uint32_t incompressible; //compression failed on the current content
+                    Node() :
+                            capacity(0), bytes(0), count(0), compressed(0), incompressible(0)
+                    {
+                    }
+            };
+            typedef Allocator<char> CharAllocator;
+            typedef Allocator<Node> NodeAllocator;
+            typedef boost::interprocess::deque<Node, NodeAllocator> NodeDeque;
+
+            /*
+             * forward iterator over entries, compressed nodes are decoded into a private buffer
+             */
+            class Iterator
+            {
+                private:
+                    const QuickList* m_list;
+                    size_t m_node;
+                    size_t m_pos;
+                    const char* m_data; //node buffer, or 'm_decoded' for a compressed node
+                    size_t m_capacity;
+                    std::string m_decoded;
+                    ListPack Pack() const
+                    {
+                        return ListPack(m_data, m_capacity);
+                    }
+                    void Bind()
+                    {
+                        m_data = NULL;
+                        m_capacity = 0;
+                        if (NULL == m_list || m_node >= m_list->m_nodes.size())
+                        {
+                            return;
+                        }
+                        const Node& node = m_list->m_nodes[m_node];
+                        if (node.compressed > 0)
+                        {
+                            m_data = m_decoded.data();
+                            m_capacity = m_decoded.size();
+                        }
+                        else
+                        {
+                            m_data = node.buf.get();
+                            m_capacity = node.capacity;
+                        }
+                    }
+                    void Load()
+                    {
+                        m_pos = ListPack::EmptyBytes();
+                        if (m_node < m_list->m_nodes.size() && m_list->m_nodes[m_node].compressed > 0)
+                        {
+                            Decode(m_list->m_nodes[m_node], m_decoded);
+                        }
+                        Bind();
+                    }
+                public:
+                    Iterator() :
+                            m_list(NULL), m_node(0), m_pos(0), m_data(NULL), m_capacity(0)
+                    {
+                    }
+                    Iterator(const QuickList* list, size_t index) :
+                            m_list(list), m_node(0), m_pos(0), m_data(NULL), m_capacity(0)
+                    {
+                        size_t offset = 0;
+                        m_node = list->Locate(index, offset);
+                        Load();
+                        for (size_t i = 0; i < offset && Valid(); i++)
+                        {
+                            m_pos = Pack().Next(m_pos);
+                        }
+                    }
+                    Iterator(const Iterator& other) :
+                            m_list(other.m_list), m_node(other.m_node), m_pos(other.m_pos), m_data(NULL), m_capacity(
+                                    0), m_decoded(other.m_decoded)
+                    {
+                        Bind();
+                    }
+                    Iterator& operator=(const Iterator& other)
+                    {
+                        m_list = other.m_list;
+                        m_node = other.m_node;
+                        m_pos = other.m_pos;
+                        m_decoded = other.m_decoded;
+                        Bind();
+                        return *this;
+                    }
+                    bool Valid() const
+                    {
+                        return NULL != m_data && m_pos < Pack().End();
+                    }
+                    void Next()
+                    {
+                        ListPack pack = Pack();
+                        m_pos = pack.Next(m_pos);
+                        if (m_pos >= pack.End())
+                        {
+                            m_node++;
+                            Load();
+                        }
+                    }
+                    Data Value() const
+                    {
+                        return Pack().Get(m_pos);
+                    }
+            };
+        private:
+            static const uint32_t kMinCompressBytes = 64;
+            NodeDeque m_nodes;
+            CharAllocator m_alloc;
+            uint64_t m_count;
+            uint32_t m_node_bytes;
+            uint32_t m_compress_depth;
+
+            static void Decode(const Node& node, std::string& out)
+            {
+                out.resize(node.bytes);
+                if (LZ4_decompress_safe(node.buf.get(), &out[0], node.compressed, node.bytes) != (int) node.bytes)
+                {
+                    //never expected, leave an empty pack instead of garbage
+                    out.resize(ListPack::EmptyBytes());
+                    ListPack::Init(&out[0]);
+                }
+            }
+            static Data Normalize(const Data& v, char* buf, size_t buflen)
+            {
+                if (NULL == v.Value())
+                {
+                    return Data(buf, ll2string(buf, buflen, (long long) v.Len()));
+                }
+                return v;
+            }
+            static bool Equals(const Data& entry, const Data& v)
+            {
+                return entry.Len() == v.Len() && 0 == memcmp(entry.Value(), v.Value(), v.Len());
+            }
+            static size_t Offset(const ListPack& pack, size_t idx)
+            {
+                if (idx >= pack.Count())
+                {
+                    return pack.End();
+                }
+                size_t pos = pack.Begin();
+                for (size_t i = 0; i < idx && pos < pack.End(); i++)
+                {
+                    pos = pack.Next(pos);
+                }
+                return pos;
+            }
+            /*
+             * node holding the 'index'th entry and the entry's offset in node, scanned from the
+             * nearer end
+             */
+            size_t Locate(size_t index, size_t& offset) const
+            {
+                if (index >= m_count)
+                {
+                    offset = 0;
+                    return m_nodes.size();
+                }
+                if (index < m_count / 2)
+                {
+                    size_t idx = 0;
+                    while (index >= m_nodes[idx].count)
+                    {
+                        index -= m_nodes[idx].count;
+                        idx++;
+                    }
+                    offset = index;
+                    return idx;
+                }
+                size_t rindex = m_count - 1 - index;
+                size_t idx = m_nodes.size() - 1;
+                while (rindex >= m_nodes[idx].count)
+                {
+                    rindex -= m_nodes[idx].count;
+                    idx--;
+                }
+                offset = m_nodes[idx].count - 1 - rindex;
+                return idx;
+            }
+            void Reserve(Node& node, size_t bytes)
+            {
+                if (bytes <= node.capacity)
+                {
+                    return;
+                }
+                //double up to the node size, so that appends don't realloc on every entry
+                size_t grow = std::min((size_t) node.capacity * 2, (size_t) m_node_bytes);
+                bytes = (std::max(bytes, grow) + 63) & ~((size_t) 63);
+                node.buf = (char*) m_alloc.realloc(node.buf.get(), bytes);
+                node.capacity = bytes;
+            }
+            void Free(Node& node)
+            {
+                m_alloc.deallocate_ptr(node.buf.get());
+                node.buf = NULL;
+                node.capacity = 0;
+            }
+            void Decompress(Node& node)
+            {
+                if (node.compressed == 0)
+                {
+                    return;
+                }
+                std::string raw;
+                Decode(node, raw);
+                Free(node);
+                Reserve(node, raw.size());
+                memcpy(node.buf.get(), raw.data(), raw.size());
+                node.compressed = 0;
+            }
+            void Compress(Node& node)
+            {
+                if (node.compressed > 0 || node.incompressible || node.bytes < kMinCompressBytes)
+                {
+                    return;
+                }
+                std::vector<char> out(node.bytes);
+                int n = LZ4_compress_limitedOutput(node.buf.get(), &out[0], node.bytes, node.bytes - 1);
+                if (n <= 0)
+                {
+                    node.incompressible = 1;
+                    return;
+                }
+                Free(node);
+                node.buf = (char*) m_alloc.allocate(n);
+                node.capacity = n;
+                memcpy(node.buf.get(), &out[0], n);
+                node.compressed = n;
+            }
+            ListPack RawPack(size_t idx)
+            {
+                Node& node = m_nodes[idx];
+                Decompress(node);
+                return ListPack(node.buf.get(), node.capacity);
+            }
+            void Sync(size_t idx)
+            {
+                Node& node = m_nodes[idx];
+                ListPack pack(node.buf.get(), node.capacity);
+                node.bytes = pack.Bytes();
+                node.count = pack.Count();
+                node.incompressible = 0;
+            }
+            void Balance(size_t idx)
+            {
+                if (0 == m_compress_depth || idx >= m_nodes.size())
+                {
+                    return;
+                }
+                if (idx >= m_compress_depth && idx + m_compress_depth < m_nodes.size())
+                {
+                    Compress(m_nodes[idx]);
+                }
+                else
+                {
+                    Decompress(m_nodes[idx]);
+                }
+            }
+            /*
+             * nodes near both ends may cross the compress depth after nodes added/removed
+             */
+            void BalanceEnds()
+            {
+                if (0 == m_compress_depth)
+                {
+                    return;
+                }
+                size_t n = m_nodes.size();
+                for (size_t i = 0; i <= m_compress_depth && i < n; i++)
+                {
+                    Balance(i);
+                    Balance(n - 1 - i);
+                }
+            }
+            void InsertNode(size_t idx)
+            {
+                m_nodes.insert(m_nodes.begin() + idx, Node());
+                Node& node = m_nodes[idx];
+                Reserve(node, ListPack::EmptyBytes());
+                ListPack::Init(node.buf.get());
+                Sync(idx);
+            }
+            void RemoveNode(size_t idx)
+            {
+                Free(m_nodes[idx]);
+                m_nodes.erase(m_nodes.begin() + idx);
+            }
+            bool Fits(size_t idx, const Data& v) const
+            {
+                const Node& node = m_nodes[idx];
+                return node.count == 0 || node.bytes + ListPack::EntryBytes(v) <= m_node_bytes;
+            }
+            void InsertAt(size_t idx, size_t offset, const Data& v)
+            {
+                ListPack pack = RawPack(idx);
+                Reserve(m_nodes[idx], pack.Bytes() + ListPack::EntryBytes(v));
+                pack = ListPack(m_nodes[idx].buf.get(), m_nodes[idx].capacity);
+                pack.Insert(Offset(pack, offset), v);
+                Sync(idx);
+                m_count++;
+            }
+            /*
+             * move the second half entries of a full node into a new node after it
+             */
+            void Split(size_t idx)
+            {
+                InsertNode(idx + 1);
+                ListPack pack = RawPack(idx);
+                size_t keep = pack.Count() / 2;
+                size_t pos = Offset(pack, keep);
+                Reserve(m_nodes[idx + 1], ListPack::EmptyBytes() + pack.Bytes() - pos);
+                ListPack next(m_nodes[idx + 1].buf.get(), m_nodes[idx + 1].capacity);
+                for (size_t p = pos; p < pack.End(); p = pack.Next(p))
+                {
+                    next.Insert(next.End(), pack.Get(p));
+                }
+                pack.Erase(pos, pack.Count() - keep);
+                Sync(idx);
+                Sync(idx + 1);
+            }
+        public:
+            QuickList(const CharAllocator& alloc, uint32_t node_bytes, uint32_t compress_depth) :
+                    m_nodes(NodeAllocator(alloc)), m_alloc(alloc), m_count(0), m_node_bytes(node_bytes), m_compress_depth(
+                            compress_depth)
+            {
+            }
+            ~QuickList()
+            {
+                clear();
+            }
+            size_t size() const
+            {
+                return m_count;
+            }
+            bool empty() const
+            {
+                return 0 == m_count;
+            }
+            /*
+             * bytes of the node buffers & node array
+             */
+            size_t MemoryUsage() const
+            {
+                size_t bytes = m_nodes.size() * sizeof(Node);
+                for (size_t i = 0; i < m_nodes.size(); i++)
+                {
+                    if (NULL != m_nodes[i].buf.get())
+                    {
+                        bytes += m_alloc.usable_size(m_nodes[i].buf.get());
+                    }
+                }
+                return bytes;
+            }
+            Iterator begin(size_t index = 0) const
+            {
+                return Iterator(this, index);
+            }
+            void push_front(const Data& v)
+            {
+                if (m_nodes.empty() || !Fits(0, v))
+                {
+                    InsertNode(0);
+                }
+                InsertAt(0, 0, v);
+                BalanceEnds();
+            }
+            void push_back(const Data& v)
+            {
+                if (m_nodes.empty() || !Fits(m_nodes.size() - 1, v))
+                {
+                    InsertNode(m_nodes.size());
+                }
+                InsertAt(m_nodes.size() - 1, m_nodes.back().count, v);
+                BalanceEnds();
+            }
+            bool pop_front(std::string& v)
+            {
+                return erase_front(1, &v) == 1;
+            }
+            bool pop_back(std::string& v)
+            {
+                return erase_back(1, &v) == 1;
+            }
+            bool get(size_t index, std::string& v) const
+            {
+                Iterator it(this, index);
+                if (!it.Valid())
+                {
+                    return false;
+                }
+                Data d = it.Value();
+                v.assign(d.Value(), d.Len());
+                return true;
+            }
+            bool set(size_t index, const Data& v)
+            {
+                size_t offset = 0;
+                size_t idx = Locate(index, offset);
+                if (idx >= m_nodes.size())
+                {
+                    return false;
+                }
+                ListPack pack = RawPack(idx);
+                Reserve(m_nodes[idx], pack.Bytes() + ListPack::EntryBytes(v));
+                pack = ListPack(m_nodes[idx].buf.get(), m_nodes[idx].capacity);
+                pack.Replace(Offset(pack, offset), v);
+                Sync(idx);
+                Balance(idx);
+                return true;
+            }
+            /*
+             * insert 'v' before the 'index'th entry, append if 'index' is size()
+             */
+            void insert(size_t index, const Data& v)
+            {
+                if (index >= m_count)
+                {
+                    push_back(v);
+                    return;
+                }
+                size_t offset = 0;
+                size_t idx = Locate(index, offset);
+                if (!Fits(idx, v) && m_nodes[idx].count > 1)
+                {
+                    Split(idx);
+                    if (offset >= m_nodes[idx].count)
+                    {
+                        offset -= m_nodes[idx].count;
+                        idx++;
+                    }
+                }
+                InsertAt(idx, offset, v);
+                Balance(idx);
+                BalanceEnds();
+            }
+            /*
+             * index of the first entry equal to 'v', -1 if none
+             */
+            int64_t find(const Data& v) const
+            {
+                char buf[32];
+                Data d = Normalize(v, buf, sizeof(buf));
+                int64_t index = 0;
+                for (Iterator it = begin(); it.Valid(); it.Next(), index++)
+                {
+                    if (Equals(it.Value(), d))
+                    {
+                        return index;
+                    }
+                }
+                return -1;
+            }
+            /*
+             * remove up to 'count' entries equal to 'v' from head, or from tail if 'from_tail'
+             */
+            size_t remove(const Data& v, size_t count, bool from_tail)
+            {
+                char buf[32];
+                Data d = Normalize(v, buf, sizeof(buf));
+                size_t removed = 0;
+                for (size_t i = 0; i < m_nodes.size() && removed < count;)
+                {
+                    size_t idx = from_tail ? m_nodes.size() - 1 - i : i;
+                    ListPack pack = RawPack(idx);
+                    std::vector<size_t> matches;
+                    for (size_t pos = pack.Begin(); pos < pack.End(); pos = pack.Next(pos))
+                    {
+                        if (Equals(pack.Get(pos), d))
+                        {
+                            matches.push_back(pos);
+                        }
+                    }
+                    //erase backward, so that offsets of the earlier matches stay valid
+                    size_t n = std::min(matches.size(), count - removed);
+                    size_t first = from_tail ? matches.size() - n : 0;
+                    for (size_t j = first + n; j > first; j--)
+                    {
+                        pack.Erase(matches[j - 1], 1);
+                    }
+                    removed += n;
+                    m_count -= n;
+                    Sync(idx);
+                    if (m_nodes[idx].count == 0)
+                    {
+                        //the next node to visit takes the same 'i'
+                        RemoveNode(idx);
+                    }
+                    else
+                    {
+                        Balance(idx);
+                        i++;
+                    }
+                }
+                BalanceEnds();
+                return removed;
+            }
+            /*
+             * erase up to 'n' entries from head, the first one is saved into 'first' if not NULL
+             */
+            size_t erase_front(size_t n, std::string* first = NULL)
+            {
+                size_t erased = 0;
+                while (erased < n && !m_nodes.empty())
+                {
+                    Node& node = m_nodes.front();
+                    if (NULL != first && 0 == erased)
+                    {
+                        Data d = RawPack(0).Get(ListPack::EmptyBytes());
+                        first->assign(d.Value(), d.Len());
+                    }
+                    if (node.count <= n - erased)
+                    {
+                        erased += node.count;
+                        m_count -= node.count;
+                        RemoveNode(0);
+                        continue;
+                    }
+                    ListPack pack = RawPack(0);
+                    pack.Erase(pack.Begin(), n - erased);
+                    m_count -= n - erased;
+                    erased = n;
+                    Sync(0);
+                }
+                BalanceEnds();
+                return erased;
+            }
+            /*
+             * erase up to 'n' entries from tail, the last one is saved into 'last' if not NULL
+             */
+            size_t erase_back(size_t n, std::string* last = NULL)
+            {
+                size_t erased = 0;
+                while (erased < n && !m_nodes.empty())
+                {
+                    size_t idx = m_nodes.size() - 1;
+                    Node& node = m_nodes.back();
+                    ListPack pack = RawPack(idx);
+                    if (NULL != last && 0 == erased)
+                    {
+                        Data d = pack.Get(Offset(pack, node.count - 1));
+                        last->assign(d.Value(), d.Len());
+                    }
+                    if (node.count <= n - erased)
+                    {
+                        erased += node.count;
+                        m_count -= node.count;
+                        RemoveNode(idx);
+                        continue;
+                    }
+                    pack.Erase(Offset(pack, node.count - (n - erased)), n - erased);
+                    m_count -= n - erased;
+                    erased = n;
+                    Sync(idx);
+                }
+                BalanceEnds();
+                return erased;
+            }
+            void clear()
+            {
+                for (size_t i = 0; i < m_nodes.size(); i++)
+                {
+                    Free(m_nodes[i]);
+                }
+                m_nodes.clear();
+                m_count = 0;
+            }
+    };
+}
+
+#endif /* SRC_COLLECTIONS_QUICKLIST_HPP_ */
@@ -44,6 +44,9 @@
 #include <alloca.h>
 #include "mmkv_allocator.hpp"
 #include "collections/incremental_rehashmap.hpp"
+#include "collections/listpack.hpp"
+#include "collections/intset.hpp"
+#include "collections/quicklist.hpp"
 
 namespace mmkv
 {
@@ -60,15 +63,65 @@ namespace mmkv
     typedef mmkv::btree::btree_map<Object, VoidPtr, std::less<Object>, StringObjectTableAllocator> StringObjectTable;
     typedef mmkv::btree::btree_set<ScoreValue, std::less<ScoreValue>, ScoreValueAllocator> SortedSet;
     typedef boost::interprocess::offset_ptr<StringObjectTable> StringObjectTablePtr;
-    typedef boost::interprocess::deque<Object, ObjectAllocator> StringList;
+    typedef QuickList StringList;
     typedef mmkv::btree::btree_set<Object, std::less<Object>, ObjectAllocator> StringSet;
     typedef std::set<Object> StdObjectSet;
-    typedef std::map<Object, double> StdObjectScoreTable;
     typedef std::vector<StringSet*> StringSetArray;
 
+    /*
+     * walks the members of a packed set, 'ListPack' or 'IntSet' encoded, in order
+     */
+    class PackedSetReader
+    {
+        private:
+            ListPack m_list;
+            IntSet m_ints;
+            bool m_intset;
+            size_t m_pos; //entry offset in list pack, index in intset
+        public:
+            PackedSetReader() :
+                    m_list(NULL, 0), m_ints(NULL, 0), m_intset(false), m_pos(0)
+            {
+            }
+            PackedSetReader(const Object& value) :
+                    m_list(value.RawValue(), value.len), m_ints(value.RawValue(), value.len), m_intset(
+                            value.IsIntSet()), m_pos(m_intset ? 0 : m_list.Begin())
+            {
+            }
+            size_t Count() const
+            {
+                return m_intset ? m_ints.Count() : m_list.Count();
+            }
+            bool Valid() const
+            {
+                return m_intset ? m_pos < m_ints.Count() : m_pos < m_list.End();
+            }
+            void Next()
+            {
+                m_pos = m_intset ? m_pos + 1 : m_list.Next(m_pos);
+            }
+            void Skip(size_t n)
+            {
+                for (size_t i = 0; i < n && Valid(); i++)
+                {
+                    Next();
+                }
+            }
+            Object Member() const
+            {
+                if (m_intset)
+                {
+                    Object obj;
+                    obj.SetInteger(m_ints.Get(m_pos));
+                    return obj;
+                }
+                return Object(m_list.Get(m_pos), true);
+            }
+    };
+
     typedef mmkv::btree::btree_map<Object, Object, std::less<Object>, StringMapAllocator> ObjectBTreeTable;
     typedef mmkv_google::dense_hash_map<Object, Object, ObjectHash, ObjectEqual, StringMapAllocator> ObjectHashTable;
-    typedef incremental_rehashmap<Object, Object, ObjectHash, ObjectEqual, StringMapAllocator> ObjectReHashTable;
+    typedef incremental_rehashmap<Object, MMValue, ObjectHash, ObjectEqual, StringMapAllocator> ObjectReHashTable;
     typedef ObjectReHashTable MMKVTable;
 
     typedef Allocator<TTLValue> TTLValueAllocator;
@@ -94,26 +147,7 @@ namespace mmkv
             }
     };
 
-    typedef std::pair<const Object, long double> StringScoreValue;
-    typedef Allocator<StringScoreValue> StringScoreValueAllocator;
-    typedef mmkv_google::sparse_hash_map<Object, long double, ObjectHash, ObjectEqual, StringScoreValueAllocator> SparseStringDoubleTable;
-    typedef mmkv::btree::btree_map<Object, long double, std::less<Object>, StringScoreValueAllocator> ObjectDoubleBTreeTable;
-//    struct StringDoubleTable: public SparseStringDoubleTable
-//    {
-//            StringDoubleTable(const StringScoreValueAllocator& allocator) :
-//                    SparseStringDoubleTable(0, ObjectHash(), ObjectEqual(), allocator)
-//            {
-//                Object empty;
-//                set_deleted_key(empty);
-//            }
-//    };
-    struct StringDoubleTable: public ObjectDoubleBTreeTable
-    {
-            StringDoubleTable(const StringScoreValueAllocator& allocator) :
-                ObjectDoubleBTreeTable(std::less<Object>(), allocator)
-            {
-            }
-    };
+    typedef incremental_rehashset<Object, ObjectHash, ObjectEqual, ObjectAllocator> ZSetMemberTable;
 
     typedef std::pair<const TTLKey, int64_t> TTLValuePair;
     typedef Allocator<TTLValuePair> TTLValuePairAllocator;
@@ -135,19 +169,30 @@ namespace mmkv
     typedef boost::interprocess::offset_ptr<ExpireInfoSet> ExpireInfoSetOffsetPtr;
     typedef boost::interprocess::vector<ExpireInfoSetOffsetPtr, Allocator<ExpireInfoSetOffsetPtr> > ExpireInfoSetArray;
 
+    /*
+     * allocated bytes of a db charged by its writers, see 'g_alloc_account': keys & values by ObjectType,
+     * key table buckets & ttl index at 'kKeyspaceMemorySlot'
+     */
+    static const uint32_t kKeyspaceMemorySlot = V_TYPE_POD + 1;
+    struct DBMemoryCounters
+    {
+            int64_t bytes[kKeyspaceMemorySlot + 1];
+            DBMemoryCounters()
+            {
+                memset(bytes, 0, sizeof(bytes));
+            }
+    };
+    typedef boost::interprocess::offset_ptr<DBMemoryCounters> DBMemoryCountersOffsetPtr;
+    typedef boost::interprocess::vector<DBMemoryCountersOffsetPtr, Allocator<DBMemoryCountersOffsetPtr> > DBMemoryCountersArray;
+
     struct ZSet
     {
             SortedSet set;
-            StringDoubleTable scores;
+            ZSetMemberTable members; //member index, keys reference the elements of 'set', see 'ScoreValue'
             ZSet(const Allocator<char>& allocator) :
-                    set(std::less<ScoreValue>(), ScoreValueAllocator(allocator)), scores(
-                            StringScoreValueAllocator(allocator))
-            {
-            }
-            void Clear()
+                    set(std::less<ScoreValue>(), ScoreValueAllocator(allocator)), members(ObjectAllocator(allocator),
+                            ZSetMemberTable::ht::LAYOUT_GROUPED)
             {
-                set.clear();
-                scores.clear();
             }
     };
 }
@@ -444,7 +444,7 @@ namespace mmkv
             it++;
         }
 
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         Allocator<char> allocator = m_segment.MSpaceAllocator<char>();
         int err;
@@ -461,32 +461,11 @@ namespace mmkv
             geohash_fast_encode(lat_range, lon_range, point.y, point.x, 30, &hash);
             long double score = (long double) hash.bits;
 
-            Object tmpk(point.value, true);
-            std::pair<StringDoubleTable::iterator, bool> ret = zset->scores.insert(
-                    StringDoubleTable::value_type(tmpk, score));
-            if (ret.second)
+            long double new_score;
+            if (GenericZAdd(*zset, point.value, score, false, false, false, new_score) == 1)
             {
-                ScoreValue fv;
-                AssignScoreValue(fv, score, point.value);
-                const_cast<Object&>(ret.first->first) = fv.value;
-                zset->set.insert(fv);
                 inserted++;
             }
-            else
-            {
-                if (ret.first->second == score)
-                {
-                    continue;
-                }
-                if (0 == UpdateZSetScore(*zset, tmpk, ret.first->second, score))
-                {
-                    ret.first->second = score;
-                }
-                else
-                {
-                    ABORT("Can not replace old zset element score.");
-                }
-            }
         }
         return inserted;
     }
@@ -626,7 +605,7 @@ namespace mmkv
         DEBUG_LOG("After areas merging, reduce searching area size from %u to %u", ress.size(), range_array.size());
 
         std::vector<GeoPointResult> points;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         int err;
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
@@ -642,19 +621,18 @@ namespace mmkv
         SortedSet::iterator last_it = zset->set.end();
         while (range_it != range_array.end())
         {
-            ScoreValue min_sv;
-            min_sv.score = range_it->start;
-            SortedSet::iterator min_it = zset->set.lower_bound(min_sv);
+            ScoreValueKey min_sv(range_it->start);
+            SortedSet::iterator min_it = zset->set.lower_bound(min_sv.Get());
             while (min_it != zset->set.end())
             {
                 ScoreValue& sv = *min_it;
-                if ((uint64_t) sv.score > range_it->stop)
+                if ((uint64_t) sv.Score() > range_it->stop)
                 {
                     break;
                 }
                 GeoPointResult point;
                 point.value = sv.value;
-                get_xy_by_hash(GEO_MERCATOR_TYPE, (uint64_t) sv.score, point.x, point.y);
+                get_xy_by_hash(GEO_MERCATOR_TYPE, (uint64_t) sv.Score(), point.x, point.y);
                 if (verify_distance_if_in_radius(x, y, point.x, point.y, options.radius, point.distance, 0.2))
                 {
                     bool valid_value = true;
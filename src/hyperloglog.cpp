@@ -1366,7 +1366,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, true);
         if (NULL == kv)
@@ -1378,6 +1378,7 @@ namespace mmkv
         Object tmpkey(key, false);
         std::pair<MMKVTable::iterator, bool> ret = kv->insert(MMKVTable::value_type(tmpkey, Object()));
         Object& value_data = ret.first->second;
+        ChargeMemory(V_TYPE_STRING);
         if (ret.second)
         {
             m_segment.AssignObjectValue(const_cast<Object&>(ret.first->first), key, false);
@@ -1430,7 +1431,7 @@ namespace mmkv
         struct hllhdr *hdr;
         uint64_t card;
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
@@ -1532,7 +1533,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
@@ -1570,6 +1571,7 @@ namespace mmkv
         std::pair<MMKVTable::iterator, bool> iret = kv->insert(MMKVTable::value_type(tmpkey, Object()));
 //        Object& value_data = const_cast<Object&>(iret.first.value());
         Object& value_data = iret.first->second;
+        ChargeMemory(V_TYPE_STRING);
         if (iret.second)
         {
             /* Create the key with a string value of the exact length to
@@ -42,14 +42,16 @@ namespace mmkv
             StringHashTable* current_hash;
             StringHashTable::iterator hash_iter;
             StringList* current_list;
-            StringList::iterator list_iter;
+            StringList::Iterator list_iter;
             SortedSet* current_zset;
             SortedSet::iterator zset_iter;
             StringSet* current_set;
             StringSet::iterator set_iter;
+            size_t pack_pos; //entry offset in packed hash
+            PackedSetReader pack_set;
             IteratorCursor(MMKVImpl* _kv) :
                     kv(_kv), current_table(NULL), current_hash(NULL), current_list(NULL), current_zset(NULL), current_set(
-                    NULL)
+                    NULL), pack_pos(0)
             {
                 dbid_iter = kv->m_dbid_set->begin();
             }
@@ -57,22 +59,46 @@ namespace mmkv
             {
                 return dbid_iter != kv->m_dbid_set->end();
             }
+            bool IsCompact()
+            {
+                return table_iter->second.IsCompact();
+            }
+            bool IsPacked()
+            {
+                return table_iter->second.IsPacked();
+            }
+            ListPack GetListPack()
+            {
+                return kv->GetListPack(table_iter->second);
+            }
+            bool NextPacked(size_t step)
+            {
+                ListPack lp = GetListPack();
+                for (size_t i = 0; i < step; i++)
+                {
+                    pack_pos = lp.Next(pack_pos);
+                }
+                return pack_pos < lp.End();
+            }
             bool NextList()
             {
-                if (NULL != current_list && list_iter != current_list->end())
+                if (NULL != current_list && list_iter.Valid())
                 {
-                    list_iter++;
-                    if (list_iter != current_list->end())
+                    list_iter.Next();
+                    if (list_iter.Valid())
                     {
                         return true;
                     }
-
                 }
                 current_list = NULL;
                 return false;
             }
             bool NextHash()
             {
+                if (IsCompact())
+                {
+                    return NextPacked(2);
+                }
                 if (NULL != current_hash && hash_iter != current_hash->end())
                 {
                     hash_iter++;
@@ -86,6 +112,11 @@ namespace mmkv
             }
             bool NextSet()
             {
+                if (IsPacked())
+                {
+                    pack_set.Next();
+                    return pack_set.Valid();
+                }
                 if (NULL != current_set && set_iter != current_set->end())
                 {
                     set_iter++;
@@ -129,6 +160,18 @@ namespace mmkv
                         current_zset = NULL;
                         current_list = NULL;
                         current_set = NULL;
+                        if (table_iter->second.IsPacked())
+                        {
+                            if (table_iter->second.type == V_TYPE_SET)
+                            {
+                                pack_set = PackedSetReader(table_iter->second);
+                            }
+                            else
+                            {
+                                pack_pos = GetListPack().Begin();
+                            }
+                            return;
+                        }
                         switch (table_iter->second.type)
                         {
                             case V_TYPE_LIST:
@@ -245,6 +288,14 @@ namespace mmkv
     {
         IteratorCursor* cursor = (IteratorCursor*) m_cursor;
         Object& value = cursor->table_iter->second;
+        if (value.IsPacked())
+        {
+            if (value.type == V_TYPE_SET)
+            {
+                return cursor->pack_set.Count();
+            }
+            return cursor->GetListPack().Count() / 2;
+        }
         switch (value.type)
         {
             case V_TYPE_LIST:
@@ -290,15 +341,25 @@ namespace mmkv
             }
             case V_TYPE_LIST:
             {
-                if (cursor->current_list != NULL && cursor->list_iter != cursor->current_list->end())
+                if (cursor->current_list != NULL && cursor->list_iter.Valid())
                 {
-                    cursor->list_iter->ToString(value);
+                    Data v = cursor->list_iter.Value();
+                    value.assign(v.Value(), v.Len());
                     return 1;
                 }
                 return 0;
             }
             case V_TYPE_SET:
             {
+                if (cursor->IsPacked())
+                {
+                    if (cursor->pack_set.Valid())
+                    {
+                        cursor->pack_set.Member().ToString(value);
+                        return 1;
+                    }
+                    return 0;
+                }
                 if (cursor->current_set != NULL && cursor->set_iter != cursor->current_set->end())
                 {
                     cursor->set_iter->ToString(value);
@@ -318,6 +379,19 @@ namespace mmkv
         ObjectType type = GetValueType();
         if (type == V_TYPE_HASH)
         {
+            if (cursor->IsCompact())
+            {
+                ListPack lp = cursor->GetListPack();
+                if (cursor->pack_pos < lp.End())
+                {
+                    Data f = lp.Get(cursor->pack_pos);
+                    Data v = lp.Get(lp.Next(cursor->pack_pos));
+                    field.assign(f.Value(), f.Len());
+                    value.assign(v.Value(), v.Len());
+                    return 1;
+                }
+                return 0;
+            }
             if (cursor->current_hash != NULL && cursor->hash_iter != cursor->current_hash->end())
             {
                 cursor->hash_iter->first.ToString(field);
@@ -336,7 +410,7 @@ namespace mmkv
         {
             if (cursor->current_zset != NULL && cursor->zset_iter != cursor->current_zset->end())
             {
-                score = cursor->zset_iter->score;
+                score = cursor->zset_iter->Score();
                 cursor->zset_iter->value.ToString(value);
                 return 1;
             }
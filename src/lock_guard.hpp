@@ -30,6 +30,7 @@
 #ifndef AUTO_LOCK_HPP_
 #define AUTO_LOCK_HPP_
 #include "lock_mode.hpp"
+#include <stdint.h>
 
 #define IS_KEY   (true)
 #define IS_VALUE (false)
@@ -133,6 +134,31 @@ namespace mmkv
                 }
             }
     };
+
+    template<typename T, LockMode M>
+    class DBLockGuard
+    {
+        private:
+            T& m_lock_impl;
+            uint32_t m_db;
+        public:
+            DBLockGuard(T& lock, uint32_t db) :
+                    m_lock_impl(lock), m_db(db)
+            {
+                if (m_lock_impl.LockEnable())
+                {
+                    m_lock_impl.LockDB(m_db, M);
+                }
+
+            }
+            ~DBLockGuard()
+            {
+                if (m_lock_impl.LockEnable())
+                {
+                    m_lock_impl.UnlockDB(m_db, M);
+                }
+            }
+    };
 }
 
 #endif /* AUTO_LOCK_HPP_ */
@@ -32,6 +32,7 @@
 #include "atomic.hpp"
 #include <string>
 #include <stdint.h>
+#include <sched.h>
 namespace mmkv
 {
     class FileLock
@@ -533,6 +533,9 @@ size_t mspace_used(mspace msp);
 void* mspace_top_address(mspace msp);
 size_t mspace_top_size(mspace msp);
 void mspace_inc_size(mspace msp, size_t inc);
+void mspace_dec_size(mspace msp, size_t dec);
+typedef void mspace_free_range_fn(void* start, size_t len, void* data);
+size_t mspace_walk_free(mspace msp, size_t min_size, mspace_free_range_fn* fn, void* data);
 #endif  /* MSPACES */
 
 #ifdef __cplusplus
@@ -1194,6 +1194,21 @@ extern "C"
     void mspace_inc_size(mspace msp, size_t inc);
     size_t mspace_top_size(mspace msp);
 
+    /*
+     mspace_dec_size gives back 'dec' bytes from the end of the top chunk,
+     the caller makes sure the top chunk is large enough.
+     */
+    void mspace_dec_size(mspace msp, size_t dec);
+
+    /*
+     mspace_walk_free calls 'fn' with the unused bytes of each free chunk no
+     smaller than 'min_size' and of the top chunk, leaving out the chunk
+     bookkeeping, so the content of the range may be discarded. Returns the
+     number of bytes passed to 'fn'.
+     */
+    typedef void mspace_free_range_fn(void* start, size_t len, void* data);
+    size_t mspace_walk_free(mspace msp, size_t min_size, mspace_free_range_fn* fn, void* data);
+
 #if !NO_MALLINFO
     /*
      mspace_mallinfo behaves as mallinfo, but reports properties of
@@ -4147,6 +4162,8 @@ static void* internal_realloc(mstate m, void* oldmem, size_t bytes)
                 m->top = newtop;
                 m->topsize = newtopsize;
                 newp = oldp;
+                /* shrinking is accounted by freeing the remainder, growing into top here */
+                m->exts += nb - oldsize;
             }
         }
         else
@@ -5413,6 +5430,48 @@ size_t mspace_top_size(mspace msp)
     return ms->topsize;
 }
 
+void mspace_dec_size(mspace msp, size_t dec)
+{
+    mstate ms = (mstate) msp;
+    ms->seg.size -= dec;
+    ms->footprint -= dec;
+    init_top(ms, ms->top.get(), ms->topsize - dec);
+}
+
+size_t mspace_walk_free(mspace msp, size_t min_size, mspace_free_range_fn* fn, void* data)
+{
+    mstate ms = (mstate) msp;
+    size_t total = 0;
+    if (!ok_magic(ms) || !is_initialized(ms))
+    {
+        return 0;
+    }
+    if (min_size < sizeof(tchunk))
+    {
+        min_size = sizeof(tchunk);
+    }
+    msegmentptr s = &ms->seg;
+    mchunkptr top = ms->top.get();
+    mchunkptr q = align_as_chunk(s->base.get());
+    while (segment_holds(s, q) && q != top && q->head != FENCEPOST_HEAD)
+    {
+        size_t size = chunksize(q);
+        if (!cinuse(q) && size >= min_size)
+        {
+            /* free list links & tree fields stay, the size footer lives in the next chunk */
+            fn((char*) q + sizeof(tchunk), size - sizeof(tchunk), data);
+            total += size - sizeof(tchunk);
+        }
+        q = next_chunk(q);
+    }
+    if (ms->topsize > sizeof(tchunk))
+    {
+        fn((char*) top + sizeof(tchunk), ms->topsize - sizeof(tchunk), data);
+        total += ms->topsize - sizeof(tchunk);
+    }
+    return total;
+}
+
 #if !NO_MALLINFO
 struct mallinfo mspace_mallinfo(mspace msp)
 {
@@ -43,6 +43,8 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sys/syscall.h>
 
 #define UNLOCKED 0
 #define READ_LOCKED 1
@@ -52,16 +54,41 @@ namespace mmkv
 {
     static const int kHeaderLength = 1024 * 1024;
     static const int kMetaLength = 4096;
-    static const int kLocksFileLength = 1024 * 1024;
+    typedef char MetaSizeCheck[sizeof(Meta) <= (size_t) kMetaLength ? 1 : -1];
+    static const int kLocksFileLength = 2 * 1024 * 1024;
+    static const uint32_t kLocksMagicCode = 0x4C4B0002;
     static pid_t g_current_pid = 0;
+    static volatile uint32_t g_fork_generation = 0;
     static ThreadLocal<uint32_t> g_lock_state;
+    static ThreadLocal<uint32_t> g_locked_db;
     static const char* kBackupFileName = "mmkv.snapshot";
     static const char* kDataFileName = "data";
 
     static const uint32_t kMagicCode = 0xCD007B;
     static const uint32_t kVersionCode = 1;
-    static const int kMaxReaderProcCount = 65536;
-    static int g_reader_count_index = -1;
+    /*
+     * version of the layout of data in the 'data' file, bump it when the layout of shared
+     * structures changes since an old file can not be mapped by current code.
+     * 2: cached hash codes in hashtable buckets
+     * 3: grouped hashtable layout
+     * 4: mixed hash code of integer keys & hash policy id
+     * 5: packed small hashes/sets
+     * 6: packed integer sets
+     * 7: lists chunked into packed nodes
+     * 8: subtree counts in btree internal nodes
+     * 9: zset elements allocated once, hashed member index
+     * 10: size class slabs for small blocks
+     * 11: slab frame maps per 1GB
+     * 12: reserved mapping length for in place growth
+     * 13: access clock of top level values for eviction
+     */
+    static const uint32_t kDataFormatVersion = 13;
+    static const int kMaxReaderSlotCount = 16384;
+    static const int kCacheLineSize = 64;
+    static const int kMaxDBLockCount = 256;
+
+    static const size_t kHugePageSize = 2 * 1024 * 1024;
+    static const size_t kPunchMinChunk = 64 * 1024;
 
     static inline int64_t allign_page(int64_t size)
     {
@@ -74,9 +101,20 @@ namespace mmkv
         return size;
     }
 
+    static void reset_mspace_caches();
     /*
-     * this code not work well with fork(), but i'm use it since this lib would not runinng in a fork process.
+     * cached pid, per thread reader slots & slab caches are invalidated in forked child
      */
+    static void on_fork_child()
+    {
+        g_current_pid = 0;
+        g_fork_generation++;
+        reset_mspace_caches();
+    }
+    static void register_fork_handler()
+    {
+        pthread_atfork(NULL, NULL, on_fork_child);
+    }
     static pid_t get_current_pid()
     {
         if (0 != g_current_pid)
@@ -86,27 +124,226 @@ namespace mmkv
         g_current_pid = getpid();
         return g_current_pid;
     }
+    static pid_t get_current_tid()
+    {
+        return syscall(SYS_gettid);
+    }
+
+    /*
+     * one slot per reader thread, padded to a cache line so that read locks of
+     * different threads never write the same line.
+     */
     struct ReaderCount
     {
-            pid_t pid;
+            volatile pid_t pid;
+            volatile pid_t tid;
             volatile uint32_t count;
+            char padding[kCacheLineSize - 3 * sizeof(uint32_t)];
+    }__attribute__((aligned(64)));
+    /*
+     * writers bump 'write_begin' before modifying & 'write_end' after, optimistic readers
+     * validate that no write started or was in progress while reading.
+     */
+    struct WriteSeq
+    {
+            volatile uint64_t write_begin;
+            volatile uint64_t write_end;
+    };
+    struct DBLock
+    {
+            SleepingRWLock lock;
+            volatile pid_t writer_pid;
+            WriteSeq seq;
     };
+    /*
+     * 'reader_bitmap' marks used reader slots, so that verify only visits slots in use.
+     */
     struct MMLock
     {
+            volatile uint32_t magic;
             SleepingRWLock lock;
             volatile pid_t writer_pid;
-            ReaderCount readers[kMaxReaderProcCount];
-            volatile bool inited;
-            MMLock() :
-                    writer_pid(0), inited(false)
+            volatile bool db_lock_enable;
+            SleepingRWLock meta_lock;
+            SleepingRWLock mspace_lock;
+            DBLock db_locks[kMaxDBLockCount];
+            WriteSeq seq;
+            volatile uint64_t reader_bitmap[kMaxReaderSlotCount / 64];
+            ReaderCount readers[kMaxReaderSlotCount];
+    };
+
+    typedef char MMLockSizeCheck[sizeof(MMLock) <= (size_t) kLocksFileLength ? 1 : -1];
+
+    struct ReaderSlot
+    {
+            MMLock* lock;
+            int index;
+            uint32_t generation;
+            ReaderSlot() :
+                    lock(NULL), index(-1), generation(0)
+            {
+            }
+            ~ReaderSlot()
             {
-                memset(readers, 0, sizeof(ReaderCount) * kMaxReaderProcCount);
+                //release slot on thread exit
+                if (NULL != lock && index >= 0 && generation == g_fork_generation)
+                {
+                    ReaderCount& reader = lock->readers[index];
+                    if (reader.count == 0)
+                    {
+                        __sync_and_and_fetch(&lock->reader_bitmap[index / 64], ~(1ULL << (index % 64)));
+                        reader.pid = 0;
+                        barrier();
+                        reader.tid = 0;
+                    }
+                }
             }
     };
 
+    struct MSpaceLockEntry
+    {
+            void* mspace;
+            char* base;
+            SleepingRWLock* lock;
+            uint32_t cache_blocks;
+            uint64_t cache_serial;
+    };
+    static volatile uint32_t g_optimistic_readers = 0;
+
+    static inline void begin_write_seq(WriteSeq& seq)
+    {
+        atomic_add(&seq.write_begin, 1);
+    }
+    static inline void end_write_seq(WriteSeq& seq)
+    {
+        atomic_add(&seq.write_end, 1);
+    }
+    static inline bool read_write_seq(const WriteSeq& seq, uint64_t& version)
+    {
+        version = seq.write_end;
+        barrier();
+        return seq.write_begin == version;
+    }
+
+    static MSpaceLockEntry g_mspace_locks[kMaxMSpaceLockCount];
+    static int g_mspace_lock_count = 0;
+    static uint64_t g_mspace_cache_serial = 0;
+
+    static SleepingRWLock* get_mspace_lock(void* msp)
+    {
+        for (int i = 0; i < g_mspace_lock_count; i++)
+        {
+            if (g_mspace_locks[i].mspace == msp)
+            {
+                return g_mspace_locks[i].lock;
+            }
+        }
+        return NULL;
+    }
+
+    static void register_mspace_lock(void* msp, char* base, SleepingRWLock* lock, uint32_t cache_blocks)
+    {
+        if (cache_blocks > kMaxSlabCacheBlocks)
+        {
+            cache_blocks = kMaxSlabCacheBlocks;
+        }
+        for (int i = 0; i < g_mspace_lock_count; i++)
+        {
+            if (g_mspace_locks[i].lock == lock)
+            {
+                //remapped store, offsets of cached blocks are still valid
+                g_mspace_locks[i].mspace = msp;
+                g_mspace_locks[i].base = base;
+                g_mspace_locks[i].cache_blocks = cache_blocks;
+                return;
+            }
+        }
+        if (g_mspace_lock_count >= kMaxMSpaceLockCount)
+        {
+            ABORT("Too many stores opened with per db lock.");
+        }
+        MSpaceLockEntry& entry = g_mspace_locks[g_mspace_lock_count];
+        entry.mspace = msp;
+        entry.base = base;
+        entry.lock = lock;
+        entry.cache_blocks = cache_blocks;
+        entry.cache_serial = ++g_mspace_cache_serial;
+        g_mspace_lock_count++;
+    }
+    static void reset_mspace_cache(void* msp)
+    {
+        for (int i = 0; i < g_mspace_lock_count; i++)
+        {
+            if (g_mspace_locks[i].mspace == msp)
+            {
+                g_mspace_locks[i].cache_serial = ++g_mspace_cache_serial;
+            }
+        }
+    }
+    static void reset_mspace_caches()
+    {
+        for (int i = 0; i < g_mspace_lock_count; i++)
+        {
+            g_mspace_locks[i].cache_serial = ++g_mspace_cache_serial;
+        }
+    }
+    bool get_mspace_cache_slot(int slot, MSpaceCacheInfo& info)
+    {
+        if (slot < 0 || slot >= g_mspace_lock_count || 0 == g_mspace_locks[slot].cache_blocks)
+        {
+            return false;
+        }
+        const MSpaceLockEntry& entry = g_mspace_locks[slot];
+        info.mspace = entry.mspace;
+        info.base = entry.base;
+        info.blocks = entry.cache_blocks;
+        info.slot = slot;
+        info.serial = entry.cache_serial;
+        return true;
+    }
+    bool get_mspace_cache(void* msp, MSpaceCacheInfo& info)
+    {
+        for (int i = 0; i < g_mspace_lock_count; i++)
+        {
+            if (g_mspace_locks[i].mspace == msp)
+            {
+                return get_mspace_cache_slot(i, info);
+            }
+        }
+        return false;
+    }
+
+    __thread int64_t* g_alloc_counters = NULL;
+    __thread int64_t* g_alloc_account = NULL;
+
+    void lock_mspace(void* msp)
+    {
+        if (0 == g_mspace_lock_count)
+        {
+            return;
+        }
+        SleepingRWLock* lock = get_mspace_lock(msp);
+        if (NULL != lock)
+        {
+            lock->Lock(WRITE_LOCK);
+        }
+    }
+    void unlock_mspace(void* msp)
+    {
+        if (0 == g_mspace_lock_count)
+        {
+            return;
+        }
+        SleepingRWLock* lock = get_mspace_lock(msp);
+        if (NULL != lock)
+        {
+            lock->Unlock(WRITE_LOCK);
+        }
+    }
+
     MemorySegmentManager::MemorySegmentManager() :
-            m_readonly(false), m_lock_enable(false), m_named_objs(NULL), m_global_lock(
-            NULL), m_data_buf(NULL)
+            m_readonly(false), m_lock_enable(false), m_db_lock_enable(false), m_named_objs(NULL), m_global_lock(
+            NULL), m_data_buf(NULL), m_map_size(0)
     {
 
     }
@@ -118,8 +355,22 @@ namespace mmkv
     int MemorySegmentManager::PostInit()
     {
         Meta* meta = (Meta*) m_data_buf;
-        madvise(m_data_buf, meta->file_size, MADV_RANDOM);
+        if (m_open_options.huge_pages)
+        {
+#ifdef MADV_HUGEPAGE
+            madvise(m_data_buf, m_map_size, MADV_HUGEPAGE);
+#endif
+        }
+        else
+        {
+            madvise(m_data_buf, meta->file_size, MADV_RANDOM);
+        }
         void* mspace = (char*) meta + kHeaderLength + kMetaLength;
+        if (DBLockEnable())
+        {
+            register_mspace_lock((char*) meta + meta->mspace_offset, (char*) meta, &(m_global_lock->mspace_lock),
+                    m_open_options.alloc_cache_blocks);
+        }
         if (!m_open_options.readonly)
         {
             if (m_open_options.reserve_space)
@@ -130,6 +381,26 @@ namespace mmkv
         return 0;
     }
 
+    /*
+     * mapping length recorded in the meta of an existing data file, 0 for new or incompatible files
+     */
+    static size_t read_map_size(const char* path)
+    {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return 0;
+        }
+        Meta meta;
+        ssize_t n = pread(fd, &meta, sizeof(meta), 0);
+        close(fd);
+        if (n != (ssize_t) sizeof(meta) || meta.format_version != kDataFormatVersion)
+        {
+            return 0;
+        }
+        return meta.map_size;
+    }
+
     int MemorySegmentManager::Open(const OpenOptions& open_options)
     {
         if (!is_dir_exist(open_options.dir))
@@ -158,6 +429,12 @@ namespace mmkv
 
         int open_ret = -1;
         MMapBuf data_buf(m_logger), locks_buf(m_logger);
+        struct stat locks_st;
+        if (0 == stat(locks_path, &locks_st) && locks_st.st_size < kLocksFileLength)
+        {
+            //locks file of older layout, content would be reset by magic check below
+            truncate(locks_path, kLocksFileLength);
+        }
         open_ret = locks_buf.OpenWrite(locks_path, kLocksFileLength, true);
         if (open_ret < 0)
         {
@@ -166,38 +443,56 @@ namespace mmkv
         }
         m_global_lock = (MMLock*) locks_buf.buf;
 
-        if (!m_global_lock->inited)
+        if (m_global_lock->magic != kLocksMagicCode)
         {
+            //new file or locks file of older layout
             memset(m_global_lock, 0, sizeof(MMLock));
-            m_global_lock->inited = 1;
+            m_global_lock->magic = kLocksMagicCode;
         }
+        static pthread_once_t fork_handler_once = PTHREAD_ONCE_INIT;
+        pthread_once(&fork_handler_once, register_fork_handler);
 
-        if (open_options.readonly)
-        {
-            open_ret = data_buf.OpenRead(data_path);
-        }
-        else
+        m_open_options = open_options;
+        m_open_options.create_options.size = AlignFileSize(open_options.create_options.size);
+        //all processes map the length decided by the creator, so growth of the file is visible to each
+        size_t map_size = read_map_size(data_path);
+        if (0 == map_size && open_options.create_options.map_size > 0)
         {
-            open_ret = data_buf.OpenWrite(data_path, open_options.create_options.size, open_options.create_if_notexist);
+            map_size = AlignFileSize(open_options.create_options.map_size);
         }
-
+        open_ret = MapDataFile(data_buf, data_path, m_open_options.create_options.size,
+                open_options.create_if_notexist, map_size);
         if (open_ret < 0)
         {
             return -1;
         }
 
         m_data_buf = data_buf.buf;
-        m_open_options = open_options;
-        ReCreate(open_ret == 1);
+        m_map_size = data_buf.map_size;
+        if (0 != ReCreate(open_ret == 1))
+        {
+            return -1;
+        }
         Verify();
-        //get g_reader_count_index
-        GetReaderCountIndex();
+        //lock mode is decided by the first attached process
+        if (!HasOtherAttachedProcs())
+        {
+            m_global_lock->db_lock_enable = open_options.per_db_lock;
+        }
+        else if (m_global_lock->db_lock_enable != open_options.per_db_lock)
+        {
+            WARN_LOG("Store is already opened with per_db_lock:%d by other process, ignore current setting.", m_global_lock->db_lock_enable);
+        }
+        m_db_lock_enable = m_global_lock->db_lock_enable;
+        GetReaderCount();
         PostInit();
         return 0;
     }
 
     int MemorySegmentManager::ReCreate(bool overwrite)
     {
+        g_alloc_counters = NULL;
+        g_alloc_account = NULL;
         MemorySpaceInfo mspace_info;
         mspace_info.space = m_data_buf;
 
@@ -208,6 +503,24 @@ namespace mmkv
             meta->file_size = m_open_options.create_options.size;
             meta->size = m_open_options.create_options.size - kHeaderLength - kMetaLength;
             meta->size = allign_page(meta->size);
+            meta->format_version = kDataFormatVersion;
+            meta->table_layout = m_open_options.create_options.table_layout;
+            meta->hash_policy = HashPolicy::kID;
+            meta->score_precision = m_open_options.create_options.score_precision;
+            meta->map_size = m_map_size;
+            memset(&meta->slab, 0, sizeof(meta->slab));
+        }
+        else if (meta->format_version != kDataFormatVersion)
+        {
+            ERROR_LOG("Data format version:%u is not compatible with current version:%u.", meta->format_version,
+                    kDataFormatVersion);
+            return -1;
+        }
+        else if (meta->hash_policy != HashPolicy::kID)
+        {
+            ERROR_LOG("Data is hashed with policy:%u while current build uses policy:%u.", meta->hash_policy,
+                    HashPolicy::kID);
+            return -1;
         }
 
         void* mspace_buf = (char*) meta + kHeaderLength + kMetaLength;
@@ -229,15 +542,13 @@ namespace mmkv
         return 0;
     }
 
-    int MemorySegmentManager::EnsureWritableValueSpace(size_t space_size)
+    size_t MemorySegmentManager::GetExpandSize(size_t space_size)
     {
-        if (m_open_options.readonly)
-        {
-            ERROR_LOG("Permission denied to expand.");
-            return -1;
-        }
         Meta* meta = (Meta*) m_data_buf;
-        size_t top_size = mspace_top_size((char*) (meta) + meta->mspace_offset);
+        void* msp = (char*) (meta) + meta->mspace_offset;
+        lock_mspace(msp);
+        size_t top_size = mspace_top_size(msp);
+        unlock_mspace(msp);
         if (space_size == 0)
         {
             if (top_size < (meta->size >> 1))
@@ -252,11 +563,204 @@ namespace mmkv
             {
                 new_size = static_cast<size_t>(meta->size * 1.5);
             }
-            return Expand(new_size);
+            return new_size;
         }
         return 0;
     }
 
+    int MemorySegmentManager::EnsureWritableValueSpace(size_t space_size, bool remap)
+    {
+        if (m_open_options.readonly)
+        {
+            ERROR_LOG("Permission denied to expand.");
+            return -1;
+        }
+        size_t new_size = GetExpandSize(space_size);
+        if (0 == new_size)
+        {
+            return EXPAND_NONE;
+        }
+        new_size = AlignFileSize(new_size);
+        Meta* meta = (Meta*) m_data_buf;
+        if (new_size <= meta->map_size && new_size <= m_map_size)
+        {
+            return GrowInPlace(new_size) < 0 ? -1 : EXPAND_IN_PLACE;
+        }
+        if (!remap)
+        {
+            return EXPAND_NEED_REMAP;
+        }
+        return Expand(new_size);
+    }
+
+    /*
+     * Extend the data file within the mapping every attached process already has, nothing moves so
+     * readers & writers of this and other processes keep going without remapping.
+     */
+    int MemorySegmentManager::GrowInPlace(size_t new_size)
+    {
+        Meta* meta = (Meta*) m_data_buf;
+        void* msp = (char*) meta + meta->mspace_offset;
+        int ret = 0;
+        //writers of other dbs may grow the file at the same time in per db lock mode
+        lock_mspace(msp);
+        size_t old_file_size = meta->file_size;
+        if (old_file_size < new_size)
+        {
+            uint64_t micros = get_current_micros();
+            char data_path[m_open_options.dir.size() + 100];
+            sprintf(data_path, "%s/data", m_open_options.dir.c_str());
+            int fd = open(data_path, O_RDWR);
+            //allocate the blocks now, writing to a hole of a full disk would raise SIGBUS later
+            int err = fd < 0 ? errno : posix_fallocate(fd, old_file_size, new_size - old_file_size);
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            if (0 != err)
+            {
+                ERROR_LOG("Failed to grow data file:%s to %llu for reason:%s", data_path, new_size, strerror(err));
+                ret = -1;
+            }
+            else
+            {
+                size_t inc = new_size - old_file_size;
+                char* grown = (char*) m_data_buf + old_file_size;
+                if (!m_open_options.huge_pages)
+                {
+                    madvise(grown, inc, MADV_RANDOM);
+                }
+                if (m_open_options.reserve_space)
+                {
+                    mlock(grown, inc);
+                }
+                meta->file_size = new_size;
+                meta->size = new_size - kHeaderLength - kMetaLength;
+                mspace_inc_size(msp, inc);
+                INFO_LOG("Cost %lluus to grow store in place from %llu to %llu.", get_current_micros() - micros,
+                        old_file_size, new_size);
+            }
+        }
+        unlock_mspace(msp);
+        return ret;
+    }
+
+    size_t MemorySegmentManager::AlignFileSize(size_t size)
+    {
+        if (m_open_options.huge_pages)
+        {
+            //hugetlbfs only accepts lengths of whole huge pages
+            return (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+        }
+        return allign_page(size);
+    }
+
+    int MemorySegmentManager::MapDataFile(MMapBuf& data_buf, const char* path, size_t size, bool create_if_notexist,
+            size_t map_size)
+    {
+        //counters of the calling writer move with the mapping
+        g_alloc_counters = NULL;
+        g_alloc_account = NULL;
+        if (m_open_options.huge_pages)
+        {
+            //file offsets and addresses must agree modulo 2MB for the kernel to map whole huge pages
+            data_buf.align = kHugePageSize;
+        }
+        if (m_open_options.readonly)
+        {
+            return data_buf.OpenRead(path, map_size);
+        }
+        return data_buf.OpenWrite(path, size, create_if_notexist, map_size);
+    }
+
+    struct PunchContext
+    {
+            int fd;
+            char* base;
+            size_t align;
+            int err;
+    };
+
+    static void punch_free_range(void* start, size_t len, void* data)
+    {
+        PunchContext* ctx = (PunchContext*) data;
+        size_t begin = ((char*) start - ctx->base + ctx->align - 1) & ~(ctx->align - 1);
+        size_t end = ((char*) start + len - ctx->base) & ~(ctx->align - 1);
+        if (0 != ctx->err || end <= begin)
+        {
+            return;
+        }
+#ifdef FALLOC_FL_PUNCH_HOLE
+        if (0 != fallocate(ctx->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, begin, end - begin))
+        {
+            ctx->err = errno;
+        }
+#else
+        ctx->err = ENOTSUP;
+#endif
+    }
+
+    /*
+     * Cut the file tail off the top chunk when the store could expand again, then punch holes for the
+     * pages of large free chunks, so the disk & page cache only hold live data. Other processes keep
+     * their mappings, the released ranges just read back as zeros.
+     */
+    int64_t MemorySegmentManager::Trim()
+    {
+        if (m_open_options.readonly)
+        {
+            ERROR_LOG("Permission denied to trim.");
+            return -1;
+        }
+        Meta* meta = (Meta*) m_data_buf;
+        void* msp = (char*) meta + meta->mspace_offset;
+        char data_path[m_open_options.dir.size() + 100];
+        sprintf(data_path, "%s/data", m_open_options.dir.c_str());
+        int fd = open(data_path, O_RDWR);
+        if (fd < 0)
+        {
+            ERROR_LOG("Failed to open data file:%s for reason:%s", data_path, strerror(errno));
+            return -1;
+        }
+        uint64_t micros = get_current_micros();
+        struct stat st;
+        fstat(fd, &st);
+        int64_t old_blocks = st.st_blocks;
+        PunchContext ctx;
+        ctx.fd = fd;
+        ctx.base = (char*) m_data_buf;
+        ctx.align = m_open_options.huge_pages ? kHugePageSize : sysconf(_SC_PAGESIZE);
+        ctx.err = 0;
+        lock_mspace(msp);
+        size_t old_file_size = meta->file_size;
+        if (m_open_options.create_options.autoexpand)
+        {
+            //keep the top chunk at half the space, so the next write does not expand right away
+            size_t live = meta->size - mspace_top_size(msp);
+            size_t new_size = AlignFileSize(kHeaderLength + kMetaLength + live * 2 + ctx.align);
+            if (new_size < old_file_size && 0 == ftruncate(fd, new_size))
+            {
+                mspace_dec_size(msp, old_file_size - new_size);
+                meta->file_size = new_size;
+                meta->size = new_size - kHeaderLength - kMetaLength;
+                m_open_options.create_options.size = new_size;
+            }
+        }
+        mspace_walk_free(msp, kPunchMinChunk, punch_free_range, &ctx);
+        unlock_mspace(msp);
+        fstat(fd, &st);
+        close(fd);
+        if (0 != ctx.err)
+        {
+            ERROR_LOG("Failed to punch holes in data file:%s for reason:%s", data_path, strerror(ctx.err));
+            return -1;
+        }
+        int64_t released = (old_blocks - st.st_blocks) * 512;
+        INFO_LOG("Cost %lluus to trim store from %llu to %llu, %lld bytes released.", get_current_micros() - micros,
+                old_file_size, meta->file_size, released);
+        return released > 0 ? released : 0;
+    }
+
     int MemorySegmentManager::Expand(size_t new_size)
     {
         if (m_open_options.readonly)
@@ -271,21 +775,24 @@ namespace mmkv
         }
         uint64_t micros = get_current_micros();
         size_t old_file_size = meta->file_size;
-        new_size = allign_page(new_size);
+        new_size = AlignFileSize(new_size);
         size_t inc = new_size - meta->file_size;
+        size_t map_size = meta->map_size;
 
-        munmap(m_data_buf, meta->file_size);
+        WaitOptimisticReaders();
+        munmap(m_data_buf, m_map_size);
         char data_path[m_open_options.dir.size() + 100];
         sprintf(data_path, "%s/data", m_open_options.dir.c_str());
         truncate(data_path, new_size);
         m_open_options.create_options.size = new_size;
         MMapBuf data_buf(m_logger);
-        int open_ret = data_buf.OpenWrite(data_path, new_size, false);
+        int open_ret = MapDataFile(data_buf, data_path, new_size, false, map_size);
         if (open_ret < 0)
         {
             return -1;
         }
         m_data_buf = data_buf.buf;
+        m_map_size = data_buf.map_size;
         ReCreate(false);
         PostInit();
         meta = (Meta*) m_data_buf;
@@ -371,6 +878,10 @@ namespace mmkv
     {
         return m_space_allocator.allocate(size);
     }
+    size_t MemorySegmentManager::UsableSize(const void* ptr)
+    {
+        return NULL == ptr ? 0 : m_space_allocator.usable_size(ptr);
+    }
     void MemorySegmentManager::Deallocate(void* ptr)
     {
         if (NULL == ptr)
@@ -384,22 +895,50 @@ namespace mmkv
         return m_space_allocator;
     }
 
-    int MemorySegmentManager::GetReaderCountIndex()
+    volatile uint32_t& MemorySegmentManager::GetReaderCount()
     {
-        if (g_reader_count_index != -1)
+        ReaderSlot& slot = m_reader_slot.GetValue();
+        if (slot.index >= 0 && slot.generation == g_fork_generation)
         {
-            return g_reader_count_index;
+            return m_global_lock->readers[slot.index].count;
         }
-        for (int i = 0; i < kMaxReaderProcCount; i++)
-        {
-            if (m_global_lock->readers[i].pid == get_current_pid() || m_global_lock->readers[i].pid == 0)
+        MMLock* lock = m_global_lock;
+        pid_t pid = get_current_pid();
+        pid_t tid = get_current_tid();
+        uint32_t start = ((uint32_t) tid * 2654435761U) % kMaxReaderSlotCount;
+        int index = -1;
+        for (int i = 0; i < kMaxReaderSlotCount && index < 0; i++)
+        {
+            int idx = (start + i) % kMaxReaderSlotCount;
+            ReaderCount& reader = lock->readers[idx];
+            pid_t owner = reader.tid;
+            if (0 == owner)
+            {
+                if (cmpxchg(&reader.tid, 0, tid) == 0)
+                {
+                    index = idx;
+                }
+            }
+            else if (reader.count == 0 && (owner == tid || kill(reader.pid, 0) != 0))
             {
-                m_global_lock->readers[i].pid = get_current_pid();
-                g_reader_count_index = i;
-                return i;
+                //take over slot left by exited thread
+                if (cmpxchg(&reader.tid, owner, tid) == owner)
+                {
+                    index = idx;
+                }
             }
         }
-        return 0;
+        if (index < 0)
+        {
+            WARN_LOG("No free reader slot, share slot 0 with others.");
+            index = 0;
+        }
+        lock->readers[index].pid = pid;
+        __sync_or_and_fetch(&lock->reader_bitmap[index / 64], 1ULL << (index % 64));
+        slot.lock = lock;
+        slot.index = index;
+        slot.generation = g_fork_generation;
+        return lock->readers[index].count;
     }
     bool MemorySegmentManager::Lock(LockMode mode)
     {
@@ -416,17 +955,29 @@ namespace mmkv
         if (mode == WRITE_LOCK && ret)
         {
             lock->writer_pid = get_current_pid();
+            begin_write_seq(lock->seq);
             g_lock_state.SetValue(WRITE_LOCKED);
         }
         else
         {
-            atomic_add(&(lock->readers[GetReaderCountIndex()].count), 1);
+            atomic_add(&GetReaderCount(), 1);
+            //a store wide read lock must exclude writers of every db
+            if (m_db_lock_enable)
+            {
+                for (int i = 0; i < kMaxDBLockCount; i++)
+                {
+                    lock->db_locks[i].lock.Lock(READ_LOCK);
+                }
+            }
             g_lock_state.SetValue(READ_LOCKED);
         }
+        g_locked_db.SetValue(kAllDBLock);
         return ret;
     }
     bool MemorySegmentManager::Unlock(LockMode mode)
     {
+        g_alloc_counters = NULL;
+        g_alloc_account = NULL;
         if (!LockEnable())
         {
             return true;
@@ -438,29 +989,230 @@ namespace mmkv
         }
         if (mode == WRITE_LOCK)
         {
+            end_write_seq(lock->seq);
             lock->writer_pid = 0;
         }
         else
         {
-            atomic_add(&(lock->readers[GetReaderCountIndex()].count), -1);
+            if (m_db_lock_enable)
+            {
+                for (int i = kMaxDBLockCount - 1; i >= 0; i--)
+                {
+                    lock->db_locks[i].lock.Unlock(READ_LOCK);
+                }
+            }
+            atomic_add(&GetReaderCount(), -1);
         }
         bool ret = lock->lock.Unlock(mode);
         g_lock_state.SetValue(UNLOCKED);
         return ret;
     }
 
-    bool MemorySegmentManager::IsLocked(bool readonly)
+    bool MemorySegmentManager::LockDB(uint32_t db, LockMode mode)
     {
+        if (!m_db_lock_enable || db == kAllDBLock)
+        {
+            return Lock(mode);
+        }
         if (!LockEnable())
         {
             return true;
         }
-        uint32_t lock_state = g_lock_state.GetValue();
-        return readonly ? lock_state == READ_LOCKED : lock_state == WRITE_LOCKED;
-    }
-
-    bool MemorySegmentManager::Verify()
-    {
+        MMLock* lock = m_global_lock;
+        if (NULL == lock)
+        {
+            return false;
+        }
+        //hold store wide read lock to exclude store wide writers(expand/flushall/restore)
+        bool ret = lock->lock.Lock(READ_LOCK);
+        atomic_add(&GetReaderCount(), 1);
+        DBLock& db_lock = lock->db_locks[db % kMaxDBLockCount];
+        ret = ret && db_lock.lock.Lock(mode);
+        if (mode == WRITE_LOCK)
+        {
+            db_lock.writer_pid = get_current_pid();
+            begin_write_seq(db_lock.seq);
+            g_lock_state.SetValue(WRITE_LOCKED);
+        }
+        else
+        {
+            g_lock_state.SetValue(READ_LOCKED);
+        }
+        g_locked_db.SetValue(db);
+        return ret;
+    }
+    bool MemorySegmentManager::UnlockDB(uint32_t db, LockMode mode)
+    {
+        if (!m_db_lock_enable || db == kAllDBLock)
+        {
+            return Unlock(mode);
+        }
+        g_alloc_counters = NULL;
+        g_alloc_account = NULL;
+        if (!LockEnable())
+        {
+            return true;
+        }
+        MMLock* lock = m_global_lock;
+        if (NULL == lock)
+        {
+            return false;
+        }
+        DBLock& db_lock = lock->db_locks[db % kMaxDBLockCount];
+        if (mode == WRITE_LOCK)
+        {
+            end_write_seq(db_lock.seq);
+            db_lock.writer_pid = 0;
+        }
+        bool ret = db_lock.lock.Unlock(mode);
+        atomic_add(&GetReaderCount(), -1);
+        ret = lock->lock.Unlock(READ_LOCK) && ret;
+        g_lock_state.SetValue(UNLOCKED);
+        return ret;
+    }
+    bool MemorySegmentManager::OptimisticReadBegin(uint32_t db, ReadVersion& version)
+    {
+        if (!m_open_options.optimistic_read || !LockEnable())
+        {
+            return false;
+        }
+        //announce before checking write seq, so that remapping waits for us
+        atomic_add(&g_optimistic_readers, 1);
+        MMLock* lock = m_global_lock;
+        bool ok = read_write_seq(lock->seq, version.global);
+        if (ok && m_db_lock_enable && db != kAllDBLock)
+        {
+            ok = read_write_seq(lock->db_locks[db % kMaxDBLockCount].seq, version.db);
+        }
+        if (!ok)
+        {
+            atomic_add(&g_optimistic_readers, -1);
+        }
+        return ok;
+    }
+    bool MemorySegmentManager::OptimisticReadEnd(uint32_t db, const ReadVersion& version)
+    {
+        barrier();
+        MMLock* lock = m_global_lock;
+        bool ok = lock->seq.write_begin == version.global;
+        if (ok && m_db_lock_enable && db != kAllDBLock)
+        {
+            ok = lock->db_locks[db % kMaxDBLockCount].seq.write_begin == version.db;
+        }
+        atomic_add(&g_optimistic_readers, -1);
+        return ok;
+    }
+    void MemorySegmentManager::WaitOptimisticReaders()
+    {
+        while (g_optimistic_readers > 0)
+        {
+            cpu_relax();
+        }
+    }
+
+    uint32_t MemorySegmentManager::LockedDB()
+    {
+        if (!DBLockEnable() || g_lock_state.GetValue() == UNLOCKED)
+        {
+            return kAllDBLock;
+        }
+        return g_locked_db.GetValue();
+    }
+    bool MemorySegmentManager::DBLockEnable()
+    {
+        return m_lock_enable && m_db_lock_enable;
+    }
+    SleepingRWLock& MemorySegmentManager::GetMetaLock()
+    {
+        return m_global_lock->meta_lock;
+    }
+
+    bool MemorySegmentManager::IsLocked(bool readonly)
+    {
+        if (!LockEnable())
+        {
+            return true;
+        }
+        uint32_t lock_state = g_lock_state.GetValue();
+        return readonly ? lock_state == READ_LOCKED : lock_state == WRITE_LOCKED;
+    }
+
+    void MemorySegmentManager::ResetLocks()
+    {
+        WARN_LOG("Clear lock state since 'open_ignore_error' is setted.");
+        memset(m_global_lock, 0, sizeof(MMLock));
+        m_global_lock->magic = kLocksMagicCode;
+    }
+
+    /*
+     * visit reader slots marked in bitmap, stop when 'visitor' returns false.
+     */
+    template<typename Visitor>
+    static void visit_used_reader_slots(MMLock* lock, Visitor& visitor)
+    {
+        for (int i = 0; i < kMaxReaderSlotCount / 64; i++)
+        {
+            uint64_t bits = lock->reader_bitmap[i];
+            while (bits != 0)
+            {
+                int bit = __builtin_ctzll(bits);
+                bits &= bits - 1;
+                if (!visitor(i * 64 + bit))
+                {
+                    return;
+                }
+            }
+        }
+    }
+
+    struct DeadReaderCleaner
+    {
+            MMLock* lock;
+            bool db_lock_crashed;
+            bool operator()(int index)
+            {
+                ReaderCount& reader = lock->readers[index];
+                if (reader.pid <= 0 || kill(reader.pid, 0) == 0)
+                {
+                    return true;
+                }
+                if (reader.count > 0 && lock->db_lock_enable)
+                {
+                    //can not tell which db read locks the dead process held
+                    db_lock_crashed = true;
+                    return false;
+                }
+                while (reader.count > 0)
+                {
+                    lock->lock.Unlock(READ_LOCK);
+                    reader.count--;
+                }
+                __sync_and_and_fetch(&lock->reader_bitmap[index / 64], ~(1ULL << (index % 64)));
+                reader.pid = 0;
+                reader.tid = 0;
+                return true;
+            }
+    };
+
+    struct LiveReaderFinder
+    {
+            MMLock* lock;
+            pid_t self;
+            bool found;
+            bool operator()(int index)
+            {
+                pid_t pid = lock->readers[index].pid;
+                if (pid > 0 && pid != self && kill(pid, 0) == 0)
+                {
+                    found = true;
+                    return false;
+                }
+                return true;
+            }
+    };
+
+    bool MemorySegmentManager::Verify()
+    {
         if (m_global_lock->writer_pid != 0)
         {
             if (kill(m_global_lock->writer_pid, 0) != 0)
@@ -468,9 +1220,7 @@ namespace mmkv
                 ERROR_LOG("Old write process crashed while writing.");
                 if (m_open_options.open_ignore_error)
                 {
-                    WARN_LOG("Clear write lock state since 'open_ignore_error' is setted.");
-                    m_global_lock->inited = true;
-                    memset(m_global_lock, 0, sizeof(MMLock));
+                    ResetLocks();
                     return true;
                 }
                 else
@@ -479,22 +1229,38 @@ namespace mmkv
                 }
             }
         }
-        //clear dead readers lock state
-        for (int i = 0; i < kMaxReaderProcCount; i++)
+        for (int i = 0; i < kMaxDBLockCount; i++)
         {
-            if (m_global_lock->readers[i].pid > 0)
+            pid_t writer_pid = m_global_lock->db_locks[i].writer_pid;
+            if (writer_pid != 0 && kill(writer_pid, 0) != 0)
             {
-                if (kill(m_global_lock->readers[i].pid, 0) != 0)
+                ERROR_LOG("Old write process crashed while writing db lock:%d.", i);
+                if (m_open_options.open_ignore_error)
                 {
-                    while (m_global_lock->readers[i].count > 0)
-                    {
-                        m_global_lock->lock.Unlock(READ_LOCK);
-                        m_global_lock->readers[i].count--;
-                    }
-                    m_global_lock->readers[i].pid = 0;
+                    ResetLocks();
+                    return true;
+                }
+                else
+                {
+                    return false;
                 }
             }
         }
+        //clear dead readers lock state
+        DeadReaderCleaner cleaner;
+        cleaner.lock = m_global_lock;
+        cleaner.db_lock_crashed = false;
+        visit_used_reader_slots(m_global_lock, cleaner);
+        if (cleaner.db_lock_crashed)
+        {
+            ERROR_LOG("Old process crashed while holding db lock.");
+            if (m_open_options.open_ignore_error)
+            {
+                ResetLocks();
+                return true;
+            }
+            return false;
+        }
         m_named_objs->verify();
         return true;
     }
@@ -534,6 +1300,93 @@ namespace mmkv
         XXH64_update(cksm64, data, len);
     }
 
+    /*
+     * Incremental backups compare digests of fixed size pages of the key space with the ones recorded
+     * in the '.pages' manifest written next to every backup, only pages whose digest changed are saved.
+     */
+    static const uint32_t kIncrementMagicCode = 0xCD017B;
+    static const uint32_t kPageManifestMagicCode = 0xCD027B;
+    static const uint32_t kBackupPageSize = 4096;
+    static const char* kPageManifestSuffix = ".pages";
+
+    struct PageManifest
+    {
+            uint64_t id;
+            uint64_t space_len;
+            std::vector<uint64_t> digests;
+            PageManifest() :
+                    id(0), space_len(0)
+            {
+            }
+    };
+
+    static void page_digests(const char* space, uint64_t len, PageManifest& manifest)
+    {
+        manifest.space_len = len;
+        manifest.digests.clear();
+        manifest.digests.reserve((len + kBackupPageSize - 1) / kBackupPageSize);
+        for (uint64_t offset = 0; offset < len; offset += kBackupPageSize)
+        {
+            size_t page_len = len - offset > kBackupPageSize ? kBackupPageSize : len - offset;
+            manifest.digests.push_back(XXH64(space + offset, page_len, kMagicCode));
+        }
+        manifest.id = XXH64(manifest.digests.empty() ? NULL : &manifest.digests[0],
+                manifest.digests.size() * sizeof(uint64_t), kMagicCode + len);
+    }
+
+    static int save_page_manifest(const std::string& path, const PageManifest& manifest)
+    {
+        FILE* dest_file = fopen(path.c_str(), "w");
+        if (NULL == dest_file)
+        {
+            return -1;
+        }
+        uint64_t count = manifest.digests.size();
+        int err = 0;
+        if (fwrite(&kPageManifestMagicCode, sizeof(kPageManifestMagicCode), 1, dest_file) != 1
+                || fwrite(&kBackupPageSize, sizeof(kBackupPageSize), 1, dest_file) != 1
+                || fwrite(&manifest.id, sizeof(manifest.id), 1, dest_file) != 1
+                || fwrite(&manifest.space_len, sizeof(manifest.space_len), 1, dest_file) != 1
+                || fwrite(&count, sizeof(count), 1, dest_file) != 1
+                || (count > 0 && fwrite(&manifest.digests[0], sizeof(uint64_t), count, dest_file) != count))
+        {
+            err = -1;
+        }
+        fclose(dest_file);
+        return err;
+    }
+
+    static int load_page_manifest(const std::string& path, PageManifest& manifest)
+    {
+        FILE* src_file = fopen(path.c_str(), "r");
+        if (NULL == src_file)
+        {
+            return -1;
+        }
+        uint32_t magic_code = 0, page_size = 0;
+        uint64_t count = 0;
+        int err = 0;
+        if (fread(&magic_code, sizeof(magic_code), 1, src_file) != 1 || magic_code != kPageManifestMagicCode
+                || fread(&page_size, sizeof(page_size), 1, src_file) != 1 || page_size != kBackupPageSize
+                || fread(&manifest.id, sizeof(manifest.id), 1, src_file) != 1
+                || fread(&manifest.space_len, sizeof(manifest.space_len), 1, src_file) != 1
+                || fread(&count, sizeof(count), 1, src_file) != 1
+                || count != (manifest.space_len + kBackupPageSize - 1) / kBackupPageSize)
+        {
+            err = -1;
+        }
+        else
+        {
+            manifest.digests.resize(count);
+            if (count > 0 && fread(&manifest.digests[0], sizeof(uint64_t), count, src_file) != count)
+            {
+                err = -1;
+            }
+        }
+        fclose(src_file);
+        return err;
+    }
+
     int MemorySegmentManager::Backup(const std::string& path)
     {
         int err = 0;
@@ -560,6 +1413,7 @@ namespace mmkv
         void* key_space_start = (char*) meta + kMetaLength + kHeaderLength;
         void* key_mspace_top = mspace_top_address(key_mspace);
         uint32_t now = time(NULL);
+        PageManifest manifest;
 
         FILE* dest_file = fopen(path.c_str(), "w");
         if (NULL == dest_file)
@@ -618,35 +1472,190 @@ namespace mmkv
 
         dump_cksum_str(cksm64, cksm32, path + ".cksm", cksm);
         INFO_LOG("Snapshot cksm:%s", cksm.c_str());
+        //digests of the saved pages, base of the next incremental backup
+        page_digests((const char*) key_space_start, (char*) key_mspace_top - (char*) key_space_start, manifest);
+        if (0 != save_page_manifest(path + kPageManifestSuffix, manifest))
+        {
+            ERROR_LOG("Failed to save page manifest of backup:%s", path.c_str());
+            err = -1;
+        }
         _end: fclose(dest_file);
         XXH64_freeState(cksm64);
         XXH32_freeState(cksm32);
         return err;
     }
 
-    int MemorySegmentManager::Restore(const std::string& from_file)
+    int MemorySegmentManager::BackupIncrement(const std::string& base_file, const std::string& path)
     {
-        Meta* meta = (Meta*) m_data_buf;
-        munmap(m_data_buf, meta->file_size);
+        PageManifest base, manifest;
+        if (0 != load_page_manifest(base_file + kPageManifestSuffix, base))
+        {
+            ERROR_LOG("Failed to load page manifest of base backup:%s", base_file.c_str());
+            return -1;
+        }
+        char meta[sizeof(Meta)];
+        char header[sizeof(Header)];
+        //(start page, page count) of every run of changed pages & their content in order
+        std::vector<std::pair<uint32_t, uint32_t> > runs;
+        std::string pages;
+        {
+            RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(*this);
+            if (NULL == m_data_buf)
+            {
+                ERROR_LOG("Empty data to backup.");
+                return -1;
+            }
+            Meta* meta_ptr = (Meta*) m_data_buf;
+            void* key_mspace = (char*) meta_ptr + meta_ptr->mspace_offset;
+            const char* key_space_start = (char*) meta_ptr + kMetaLength + kHeaderLength;
+            uint64_t space_len = (char*) mspace_top_address(key_mspace) - key_space_start;
+            memcpy(meta, meta_ptr, sizeof(meta));
+            memcpy(header, (char*) m_data_buf + kMetaLength, sizeof(header));
+            page_digests(key_space_start, space_len, manifest);
+            size_t base_pages = base.digests.size();
+            //the tail of a partial last page was never saved in the base
+            bool base_tail_partial = base.space_len % kBackupPageSize != 0;
+            for (uint32_t i = 0; i < manifest.digests.size(); i++)
+            {
+                if (i < base_pages && base.digests[i] == manifest.digests[i]
+                        && !(base_tail_partial && i + 1 == base_pages))
+                {
+                    continue;
+                }
+                uint64_t offset = (uint64_t) i * kBackupPageSize;
+                size_t page_len = space_len - offset > kBackupPageSize ? kBackupPageSize : space_len - offset;
+                pages.append(key_space_start + offset, page_len);
+                if (!runs.empty() && runs.back().first + runs.back().second == i)
+                {
+                    runs.back().second++;
+                }
+                else
+                {
+                    runs.push_back(std::make_pair(i, 1));
+                }
+            }
+        }
+
+        int err = 0;
+        uint16_t meta_len = sizeof(meta);
+        uint32_t header_len = sizeof(header);
+        uint32_t page_size = kBackupPageSize;
+        uint32_t run_end[2] = { 0, 0 };
+        size_t pages_cursor = 0;
+        uint32_t changed_pages = 0;
+        std::string cksm;
+        XXH64_state_t* cksm64 = XXH64_createState();
+        XXH32_state_t* cksm32 = XXH32_createState();
+        void* chsumset[2];
+        XXH64_reset(cksm64, kMagicCode);
+        XXH32_reset(cksm32, kMagicCode);
+        chsumset[0] = cksm64;
+        chsumset[1] = cksm32;
+        FILE* dest_file = fopen(path.c_str(), "w");
+        if (NULL == dest_file)
+        {
+            ERROR_LOG("Failed to open backup file:%s to write.", path.c_str());
+            XXH64_freeState(cksm64);
+            XXH32_freeState(cksm32);
+            return -1;
+        }
+        if (fwrite(&kIncrementMagicCode, sizeof(kIncrementMagicCode), 1, dest_file) != 1
+                || fwrite(&kVersionCode, sizeof(kVersionCode), 1, dest_file) != 1
+                || fwrite(&base.id, sizeof(base.id), 1, dest_file) != 1
+                || fwrite(&manifest.id, sizeof(manifest.id), 1, dest_file) != 1
+                || fwrite(&page_size, sizeof(page_size), 1, dest_file) != 1
+                || fwrite(&manifest.space_len, sizeof(manifest.space_len), 1, dest_file) != 1)
+        {
+            ERROR_LOG("Failed to save increment header");
+            err = -1;
+            goto _end;
+        }
+        if (fwrite(&meta_len, sizeof(meta_len), 1, dest_file) != 1 || fwrite(meta, 1, meta_len, dest_file) != meta_len)
+        {
+            ERROR_LOG("Failed to save meta content");
+            err = -1;
+            goto _end;
+        }
+        xxhash_cksum_callback(meta, meta_len, chsumset);
+        if (fwrite(&header_len, sizeof(header_len), 1, dest_file) != 1
+                || fwrite(header, 1, header_len, dest_file) != header_len)
+        {
+            ERROR_LOG("Failed to save header space content");
+            err = -1;
+            goto _end;
+        }
+        xxhash_cksum_callback(header, header_len, chsumset);
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            uint64_t run_offset = (uint64_t) runs[i].first * kBackupPageSize;
+            uint64_t run_len = (uint64_t) runs[i].second * kBackupPageSize;
+            if (run_offset + run_len > manifest.space_len)
+            {
+                run_len = manifest.space_len - run_offset;
+            }
+            if (fwrite(&runs[i].first, sizeof(uint32_t), 1, dest_file) != 1
+                    || fwrite(&runs[i].second, sizeof(uint32_t), 1, dest_file) != 1
+                    || 0 != lz4_compress_tofile(pages.data() + pages_cursor, run_len, dest_file, xxhash_cksum_callback,
+                                    chsumset))
+            {
+                ERROR_LOG("Failed to compress changed pages");
+                err = -1;
+                goto _end;
+            }
+            pages_cursor += run_len;
+            changed_pages += runs[i].second;
+        }
+        if (fwrite(run_end, sizeof(run_end), 1, dest_file) != 1)
+        {
+            ERROR_LOG("Failed to save end of changed pages");
+            err = -1;
+            goto _end;
+        }
+        dump_cksum_str(cksm64, cksm32, path + ".cksm", cksm);
+        INFO_LOG("Incremental snapshot of %u/%u pages cksm:%s", changed_pages, (uint32_t) manifest.digests.size(),
+                cksm.c_str());
+        if (0 != save_page_manifest(path + kPageManifestSuffix, manifest))
+        {
+            ERROR_LOG("Failed to save page manifest of backup:%s", path.c_str());
+            err = -1;
+        }
+        _end: fclose(dest_file);
+        XXH64_freeState(cksm64);
+        XXH32_freeState(cksm32);
+        return err;
+    }
+
+    int MemorySegmentManager::Restore(const std::string& from_file, const std::vector<std::string>& increments)
+    {
+        WaitOptimisticReaders();
+        munmap(m_data_buf, m_map_size);
         char data_path[m_open_options.dir.size() + 100];
         sprintf(data_path, "%s/data", m_open_options.dir.c_str());
         int err = Restore(from_file, data_path);
-        MMapBuf data_buf(m_logger);
-        if (m_open_options.readonly)
-        {
-            err = data_buf.OpenRead(data_path);
-        }
-        else
+        if (0 == err && !increments.empty())
         {
-            err = data_buf.OpenWrite(data_path, 0, false);
+            PageManifest manifest;
+            if (0 != load_page_manifest(from_file + kPageManifestSuffix, manifest))
+            {
+                ERROR_LOG("Failed to load page manifest of backup:%s", from_file.c_str());
+                err = -1;
+            }
+            uint64_t snapshot_id = manifest.id;
+            for (size_t i = 0; 0 == err && i < increments.size(); i++)
+            {
+                err = ApplyIncrement(increments[i], data_path, snapshot_id);
+            }
         }
-        if (err < 0)
+        MMapBuf data_buf(m_logger);
+        if (MapDataFile(data_buf, data_path, 0, false, read_map_size(data_path)) < 0)
         {
             return -1;
         }
         m_data_buf = data_buf.buf;
+        m_map_size = data_buf.map_size;
         ReCreate(false);
         PostInit();
+        reset_mspace_cache((char*) m_data_buf + ((Meta*) m_data_buf)->mspace_offset);
         return err;
     }
 
@@ -718,6 +1727,13 @@ namespace mmkv
         memcpy(&meta, backup.buf + buf_cursor, meta_len);
         xxhash_cksum_callback(&meta, meta_len, chsumset);
         buf_cursor += meta_len;
+        if (meta.format_version != kDataFormatVersion)
+        {
+            ERROR_LOG("Data format version:%u of backup is not compatible with current version:%u.",
+                    meta.format_version, kDataFormatVersion);
+            err = -1;
+            goto _end;
+        }
 
         //load header
         if (backup.size < buf_cursor + sizeof(uint32_t))
@@ -789,6 +1805,159 @@ namespace mmkv
         return err;
     }
 
+    int MemorySegmentManager::ApplyIncrement(const std::string& from_file, const std::string& to_file,
+            uint64_t& snapshot_id)
+    {
+        FILE* dest_file = NULL;
+        int err = 0;
+        MMapBuf backup(m_logger);
+        size_t buf_cursor = 0;
+        uint32_t magic_code = 0, version_code = 0, page_size = 0;
+        uint64_t base_id = 0, id = 0, space_len = 0;
+        uint16_t meta_len = 0;
+        uint32_t header_len = 0;
+        Meta meta;
+        char header[sizeof(Header)];
+        size_t head_len = sizeof(uint32_t) * 3 + sizeof(uint64_t) * 3 + sizeof(meta_len);
+        std::string cksm;
+        XXH64_state_t* cksm64 = XXH64_createState();
+        XXH32_state_t* cksm32 = XXH32_createState();
+        void* chsumset[2];
+        XXH64_reset(cksm64, kMagicCode);
+        XXH32_reset(cksm32, kMagicCode);
+        chsumset[0] = cksm64;
+        chsumset[1] = cksm32;
+        if (0 != backup.OpenRead(from_file))
+        {
+            ERROR_LOG("Failed to load incremental backup file:%s", from_file.c_str());
+            err = -1;
+            goto _end;
+        }
+        if (backup.size < head_len)
+        {
+            ERROR_LOG("No sufficient space for increment header.");
+            err = -1;
+            goto _end;
+        }
+        memcpy(&magic_code, backup.buf, sizeof(uint32_t));
+        memcpy(&version_code, backup.buf + sizeof(uint32_t), sizeof(uint32_t));
+        memcpy(&base_id, backup.buf + sizeof(uint32_t) * 2, sizeof(uint64_t));
+        memcpy(&id, backup.buf + sizeof(uint32_t) * 2 + sizeof(uint64_t), sizeof(uint64_t));
+        memcpy(&page_size, backup.buf + sizeof(uint32_t) * 2 + sizeof(uint64_t) * 2, sizeof(uint32_t));
+        memcpy(&space_len, backup.buf + sizeof(uint32_t) * 3 + sizeof(uint64_t) * 2, sizeof(uint64_t));
+        memcpy(&meta_len, backup.buf + sizeof(uint32_t) * 3 + sizeof(uint64_t) * 3, sizeof(meta_len));
+        buf_cursor = head_len;
+        if (magic_code != kIncrementMagicCode || version_code == 0 || version_code > kVersionCode
+                || page_size != kBackupPageSize)
+        {
+            ERROR_LOG("Wrong magic code/version/page size in increment header.");
+            err = -1;
+            goto _end;
+        }
+        if (base_id != snapshot_id)
+        {
+            ERROR_LOG("Increment:%s is not taken on top of the previous snapshot.", from_file.c_str());
+            err = -1;
+            goto _end;
+        }
+        if (meta_len != sizeof(Meta) || backup.size < buf_cursor + meta_len + sizeof(header_len))
+        {
+            ERROR_LOG("Invalid meta len:%u", meta_len);
+            err = -1;
+            goto _end;
+        }
+        memcpy(&meta, backup.buf + buf_cursor, meta_len);
+        xxhash_cksum_callback(&meta, meta_len, chsumset);
+        buf_cursor += meta_len;
+        if (meta.format_version != kDataFormatVersion
+                || meta.file_size < (uint64_t) kMetaLength + kHeaderLength + space_len)
+        {
+            ERROR_LOG("Data format version:%u of increment is not compatible with current version:%u.",
+                    meta.format_version, kDataFormatVersion);
+            err = -1;
+            goto _end;
+        }
+        memcpy(&header_len, backup.buf + buf_cursor, sizeof(uint32_t));
+        buf_cursor += sizeof(uint32_t);
+        if (header_len != sizeof(Header) || backup.size < buf_cursor + header_len)
+        {
+            ERROR_LOG("Invalid header len:%u compare to %u", header_len, sizeof(Header));
+            err = -1;
+            goto _end;
+        }
+        memcpy(header, backup.buf + buf_cursor, header_len);
+        xxhash_cksum_callback(header, header_len, chsumset);
+        buf_cursor += header_len;
+
+        dest_file = fopen(to_file.c_str(), "r+");
+        if (NULL == dest_file)
+        {
+            ERROR_LOG("Failed to open data file:%s to write.", to_file.c_str());
+            err = -1;
+            goto _end;
+        }
+        ftruncate(fileno(dest_file), meta.file_size);
+        fseek(dest_file, 0, SEEK_SET);
+        if (fwrite(&meta, 1, sizeof(meta), dest_file) != sizeof(meta))
+        {
+            ERROR_LOG("Failed to write meta content in backup file.");
+            err = -1;
+            goto _end;
+        }
+        fseek(dest_file, kMetaLength, SEEK_SET);
+        if (fwrite(header, 1, header_len, dest_file) != header_len)
+        {
+            ERROR_LOG("Failed to write header content in backup file.");
+            err = -1;
+            goto _end;
+        }
+        while (true)
+        {
+            uint32_t run[2];
+            size_t chunk_decomp_size = 0;
+            if (backup.size < buf_cursor + sizeof(run))
+            {
+                ERROR_LOG("No sufficient space for changed pages.");
+                err = -1;
+                goto _end;
+            }
+            memcpy(run, backup.buf + buf_cursor, sizeof(run));
+            buf_cursor += sizeof(run);
+            if (0 == run[1])
+            {
+                break;
+            }
+            if ((uint64_t) run[0] * kBackupPageSize >= space_len)
+            {
+                ERROR_LOG("Invalid changed page:%u", run[0]);
+                err = -1;
+                goto _end;
+            }
+            fseek(dest_file, kMetaLength + kHeaderLength + (uint64_t) run[0] * kBackupPageSize, SEEK_SET);
+            if (lz4_decompress_tofile(backup.buf + buf_cursor, backup.size - buf_cursor, dest_file, &chunk_decomp_size,
+                    xxhash_cksum_callback, chsumset) != 0)
+            {
+                ERROR_LOG("decompress changed pages failed");
+                err = -1;
+                goto _end;
+            }
+            buf_cursor += chunk_decomp_size;
+        }
+        snapshot_id = id;
+        dump_cksum_str(cksm64, cksm32, to_file + ".cksm", cksm);
+        INFO_LOG("Restore increment:%s cksm:%s", from_file.c_str(), cksm.c_str());
+        _end: backup.Close();
+        if (NULL != dest_file)
+        {
+            fflush(dest_file);
+            fsync(fileno(dest_file));
+            fclose(dest_file);
+        }
+        XXH64_freeState(cksm64);
+        XXH32_freeState(cksm32);
+        return err;
+    }
+
     bool MemorySegmentManager::CheckEqual(const std::string& file)
     {
         MMapBuf cmpbuf(m_logger, true);
@@ -848,6 +2017,63 @@ namespace mmkv
         return mspace_footprint(m_space_allocator.get_mspace());
     }
 
+    uint32_t MemorySegmentManager::TableLayout()
+    {
+        Meta* meta = (Meta*) m_data_buf;
+        return meta->table_layout;
+    }
+
+    void* MemorySegmentManager::Relocate(void* ptr)
+    {
+        Meta* meta = (Meta*) m_data_buf;
+        void* msp = m_space_allocator.get_mspace();
+        lock_mspace(msp);
+        void* p = slab_relocate(&meta->slab, (char*) m_data_buf, msp, ptr);
+        unlock_mspace(msp);
+        return p;
+    }
+
+    size_t MemorySegmentManager::SlabFreeBytes()
+    {
+        Meta* meta = (Meta*) m_data_buf;
+        return slab_free_bytes(&meta->slab);
+    }
+
+    double MemorySegmentManager::FragmentationRatio()
+    {
+        size_t used = MSpaceUsed();
+        size_t wasted = SlabFreeBytes();
+        if (used <= wasted)
+        {
+            return 1;
+        }
+        return (double) used / (used - wasted);
+    }
+
+    void MemorySegmentManager::FlushAllocCache()
+    {
+        if (NULL != m_data_buf && !m_open_options.readonly)
+        {
+            slab_cache_flush(m_space_allocator.get_mspace());
+        }
+    }
+
+    uint32_t MemorySegmentManager::ScorePrecision()
+    {
+        Meta* meta = (Meta*) m_data_buf;
+        return meta->score_precision;
+    }
+
+    bool MemorySegmentManager::HasOtherAttachedProcs()
+    {
+        LiveReaderFinder finder;
+        finder.lock = m_global_lock;
+        finder.self = get_current_pid();
+        finder.found = false;
+        visit_used_reader_slots(m_global_lock, finder);
+        return finder.found;
+    }
+
     bool MemorySegmentManager::LockEnable()
     {
         return m_lock_enable;
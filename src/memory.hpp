@@ -33,6 +33,7 @@
 #include "mmap.hpp"
 #include "containers.hpp"
 #include "locks.hpp"
+#include "thread_local.hpp"
 #include <new>
 
 namespace mmkv
@@ -46,19 +47,46 @@ namespace mmkv
             char named_objects[sizeof(StringObjectTable)];
     };
 
+    /*
+     * db id used to lock the whole store instead of a single db
+     */
+    static const uint32_t kAllDBLock = (uint32_t) -1;
+
+    struct ReadVersion
+    {
+            uint64_t global;
+            uint64_t db;
+            ReadVersion() :
+                    global(0), db(0)
+            {
+            }
+    };
+
+    /*
+     * results of MemorySegmentManager::EnsureWritableValueSpace
+     */
+    enum ExpandResult
+    {
+        EXPAND_NONE = 0, EXPAND_REMAPPED = 1, EXPAND_IN_PLACE = 2, EXPAND_NEED_REMAP = 3
+    };
+
     struct MMLock;
+    struct ReaderSlot;
     class MMKV;
     class MemorySegmentManager
     {
         private:
             bool m_readonly;
             bool m_lock_enable;
+            bool m_db_lock_enable;
             Logger m_logger;
             Allocator<char> m_space_allocator;
             //Allocator<char> m_value_allocator;
             StringObjectTable* m_named_objs;
             MMLock* m_global_lock;
+            ThreadLocal<ReaderSlot> m_reader_slot;
             void* m_data_buf;
+            size_t m_map_size;
             OpenOptions m_open_options;
             friend class MMKV;
             StringObjectTable& GetNamedObjects()
@@ -66,15 +94,27 @@ namespace mmkv
                 return *m_named_objs;
             }
             int PostInit();
+            size_t AlignFileSize(size_t size);
+            int MapDataFile(MMapBuf& data_buf, const char* path, size_t size, bool create_if_notexist, size_t map_size);
             int Expand(size_t new_size);
-            int GetReaderCountIndex();
+            int GrowInPlace(size_t new_size);
+            size_t GetExpandSize(size_t space_size);
+            volatile uint32_t& GetReaderCount();
+            void ResetLocks();
+            bool HasOtherAttachedProcs();
             int Restore(const std::string& from_dir, const std::string& to_dir);
+            int ApplyIncrement(const std::string& from_file, const std::string& to_file, uint64_t& snapshot_id);
         public:
             MemorySegmentManager();
             void SetLogger(const Logger& logger);
             int ReCreate(bool overwrite);
             int Open(const OpenOptions& open_options);
-            int EnsureWritableValueSpace(size_t space_size);
+            /*
+             * Expand the store if 'space_size' or half of the space is not free, see 'ExpandResult'.
+             * Growing within the reserved mapping is safe under a db write lock, otherwise 'remap' tells
+             * whether the caller holds the store write lock and the store may be remapped.
+             */
+            int EnsureWritableValueSpace(size_t space_size, bool remap = true);
 
             bool AssignObjectValue(Object& obj, const Data& value, bool try_int_encoding);
             bool ObjectMakeRoom(Object& obj, size_t size);
@@ -172,15 +212,67 @@ namespace mmkv
 
             size_t MSpaceUsed();
             size_t MSpaceCapacity();
+            /*
+             * usable bytes of a block returned by 'Allocate', as charged to memory counters
+             */
+            size_t UsableSize(const void* ptr);
+            /*
+             * 'Relocate' moves a small block out of a sparse slab for defragmentation and returns its new
+             * address, or NULL if it stays. The ratio is mspace bytes in use over bytes not wasted inside
+             * slabs, 1 means no fragmentation.
+             */
+            void* Relocate(void* ptr);
+            size_t SlabFreeBytes();
+            double FragmentationRatio();
+            /*
+             * returns bytes of the data file given back to the filesystem, see MMKV::Trim
+             */
+            int64_t Trim();
+            /*
+             * layout of top level key tables & width of zset scores, decided when the store is created
+             */
+            uint32_t TableLayout();
+            uint32_t ScorePrecision();
+            /*
+             * returns slab blocks cached by the calling thread, see 'alloc_cache_blocks'
+             */
+            void FlushAllocCache();
 
             bool Lock(LockMode mode);
             bool Unlock(LockMode mode);
             bool IsLocked(bool readonly);
             bool LockEnable();
 
+            /*
+             * In per db lock mode, lock one db while writers of other dbs keep running,
+             * otherwise same as Lock/Unlock.
+             */
+            bool LockDB(uint32_t db, LockMode mode);
+            bool UnlockDB(uint32_t db, LockMode mode);
+            uint32_t LockedDB();
+            bool DBLockEnable();
+            /*
+             * guards named objects & db id set in per db lock mode
+             */
+            SleepingRWLock& GetMetaLock();
+
+            /*
+             * Lock free read for 'optimistic_read', result read between begin & end is only valid
+             * when end returns true, otherwise caller should retry or fallback to lock.
+             */
+            bool OptimisticReadBegin(uint32_t db, ReadVersion& version);
+            bool OptimisticReadEnd(uint32_t db, const ReadVersion& version);
+            void WaitOptimisticReaders();
+
             bool Verify();
             int Backup(const std::string& path);
-            int Restore(const std::string& from_file);
+            /*
+             * Save pages of the key space whose digest differs from the one recorded by the snapshot 'base_file'
+             * (a full or incremental backup). Takes the read lock itself, only while changed pages are copied out.
+             */
+            int BackupIncrement(const std::string& base_file, const std::string& path);
+            int Restore(const std::string& from_file, const std::vector<std::string>& increments =
+                    std::vector<std::string>());
 
             bool CheckEqual(const std::string& file);
 
@@ -38,7 +38,7 @@
 
 namespace mmkv
 {
-    int MMapBuf::Init(const std::string& path, uint64_t size, bool readonly, bool reate_if_notexist)
+    int MMapBuf::Init(const std::string& path, uint64_t size, bool readonly, bool reate_if_notexist, uint64_t map_size)
     {
         int mode = O_RDONLY, permission = S_IRUSR;
         int mmap_mode = PROT_READ;
@@ -101,11 +101,40 @@ namespace mmkv
             }
         }
 
-        char* mbuf = (char*) mmap(NULL, size, mmap_mode, MAP_SHARED, fd, 0);
+        int map_flags = MAP_SHARED;
+        if (map_size > size)
+        {
+            map_flags |= MAP_NORESERVE;
+        }
+        else
+        {
+            map_size = size;
+        }
+        char* addr = NULL;
+        if (align > 0)
+        {
+            //reserve 'align' more bytes of address space, then map the file over the aligned part of it
+            char* reserved = (char*) mmap(NULL, map_size + align, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (reserved != MAP_FAILED)
+            {
+                addr = (char*) (((uintptr_t) reserved + align - 1) & ~((uintptr_t) align - 1));
+                if (addr > reserved)
+                {
+                    munmap(reserved, addr - reserved);
+                }
+                munmap(addr + map_size, reserved + align - addr);
+                map_flags |= MAP_FIXED;
+            }
+        }
+        char* mbuf = (char*) mmap(addr, map_size, mmap_mode, map_flags, fd, 0);
         close(fd);
         if (mbuf == MAP_FAILED)
         {
             const char* err = strerror(errno);
+            if (NULL != addr)
+            {
+                munmap(addr, map_size);
+            }
             ERROR_LOG("Failed to mmap replication log:%s for reason:%s", path.c_str(), err);
             return -1;
         }
@@ -113,23 +142,24 @@ namespace mmkv
         {
             this->buf = mbuf;
             this->size = size;
+            this->map_size = map_size;
         }
         return create_file ? 1 : 0;
     }
 
-    int MMapBuf::OpenWrite(const std::string& path, int64_t size, bool create_if_notexist)
+    int MMapBuf::OpenWrite(const std::string& path, int64_t size, bool create_if_notexist, uint64_t map_size)
     {
-        return Init(path, size, false, create_if_notexist);
+        return Init(path, size, false, create_if_notexist, map_size);
     }
 
-    int MMapBuf::OpenRead(const std::string& path)
+    int MMapBuf::OpenRead(const std::string& path, uint64_t map_size)
     {
-        return Init(path, 0, true, false);
+        return Init(path, 0, true, false, map_size);
     }
 
     int MMapBuf::Close()
     {
-        munmap(buf, size);
+        munmap(buf, map_size);
         return 0;
     }
 
@@ -38,19 +38,25 @@ namespace mmkv
     {
         private:
             Logger m_logger;
-            int Init(const std::string& path, uint64_t size, bool readonly, bool reate_if_notexist);
+            int Init(const std::string& path, uint64_t size, bool readonly, bool reate_if_notexist, uint64_t map_size);
         public:
 
             char* buf;
             uint64_t size;
+            uint64_t map_size; //mapped length, larger than 'size' to let the file grow in place
+            uint64_t align; //alignment of the mapping address if larger than a page, e.g. for huge pages
             bool atuoclose;
         public:
             MMapBuf(const Logger& logger, bool aclose = false) :
-                    m_logger(logger), buf(0), size(0),atuoclose(aclose)
+                    m_logger(logger), buf(0), size(0), map_size(0), align(0), atuoclose(aclose)
             {
             }
-            int OpenRead(const std::string& path);
-            int OpenWrite(const std::string& path, int64_t size, bool create_if_notexist);
+            /*
+             * 'map_size' reserves address space beyond the end of file with MAP_NORESERVE, pages there
+             * become accessible once the file grows, 0 maps the file size only.
+             */
+            int OpenRead(const std::string& path, uint64_t map_size = 0);
+            int OpenWrite(const std::string& path, int64_t size, bool create_if_notexist, uint64_t map_size = 0);
 
             int Close();
 
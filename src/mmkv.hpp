@@ -138,8 +138,28 @@ namespace mmkv
             bool rehashing;
             float rehash_progress;
             size_t expires;
+            /*
+             * running counters of allocated bytes: keys & values by their ObjectType, key table buckets
+             * & ttl index in 'keyspace_bytes'
+             */
+            int64_t type_bytes[V_TYPE_POD + 1];
+            int64_t keyspace_bytes;
             DBInfo() :
-                    id(0), rehashing(false), rehash_progress(0),expires(0)
+                    id(0), rehashing(false), rehash_progress(0),expires(0), keyspace_bytes(0)
+            {
+                for (int i = 0; i <= V_TYPE_POD; i++)
+                {
+                    type_bytes[i] = 0;
+                }
+            }
+    };
+
+    struct RoutineStats
+    {
+            int64_t max_lock_micros;  //longest write lock hold of one routine slice
+            int64_t lock_slices;
+            RoutineStats() :
+                    max_lock_micros(0), lock_slices(0)
             {
             }
     };
@@ -162,6 +182,7 @@ namespace mmkv
     typedef std::vector<uint32_t> WeightArray;
     typedef std::vector<DBID> DBIDArray;
     typedef std::vector<DBInfo> DBInfoArray;
+    typedef std::vector<uint64_t> ProbeHistogram;
 
     class StringArrayResult
     {
@@ -678,6 +699,16 @@ namespace mmkv
             virtual int FlushAll() = 0;
 
             virtual int GetAllDBInfo(DBInfoArray& dbs) = 0;
+            /*
+             * Bytes allocated for 'key' & its value, the value's containers are walked with the db read locked.
+             * Returns ERR_ENTRY_NOT_EXIST if there is no such key.
+             */
+            virtual int64_t MemoryUsage(DBID db, const Data& key) = 0;
+            /*
+             * Probe length distribution of the key table of 'db', histogram[n] is the count of keys
+             * found after 'n' probes. It scans the whole table with the db read locked.
+             */
+            virtual int GetProbeHistogram(DBID db, ProbeHistogram& histogram) = 0;
 
             template<typename T>
             PODProxy<T> NewPOD()
@@ -758,6 +789,16 @@ namespace mmkv
             }
 
             virtual size_t MSpaceUsed() = 0;
+            /*
+             * mspace bytes in use over bytes used by stored data, free slab blocks make up the difference
+             */
+            virtual double FragmentationRatio() = 0;
+            /*
+             * Shrink the data file down to twice the space in use when 'autoexpand' is on, and punch holes
+             * for large free chunks, return bytes given back to the filesystem or -1 on error.
+             * Walks all chunks of the mspace under the write lock.
+             */
+            virtual int64_t Trim() = 0;
 
             template<typename T>
             Allocator<T> GetAllocator()
@@ -770,11 +811,23 @@ namespace mmkv
             /*
              * 1. incremental rehash
              * 2. remove expired keys
+             * 3. defragment small blocks when 'defrag_ratio' is exceeded
+             * The write lock is released every 'routine_slice_micros', 'max_micros' bounds the whole call
+             * (0 means no limit). Return 1 if work is left, next call would resume from where it stopped.
              */
-            virtual int Routine() = 0;
+            virtual int Routine(int64_t max_micros = 0) = 0;
+            virtual void GetRoutineStats(RoutineStats& stats) = 0;
 
             virtual int Backup(const std::string& dest_file) = 0;
-            virtual int Restore(const std::string& from_file) = 0;
+            /*
+             * save pages changed since the snapshot 'base_file' which is either a full or an incremental backup,
+             * 'dest_file' can be the base of the next one.
+             */
+            virtual int BackupIncrement(const std::string& base_file, const std::string& dest_file) = 0;
+            /*
+             * restore the full backup 'from_file', then apply 'increments' in the order they were taken.
+             */
+            virtual int Restore(const std::string& from_file, const StringArray& increments = StringArray()) = 0;
             virtual int EnsureWritableSpace(size_t space_size) = 0;
 
             virtual Iterator* NewIterator() = 0;
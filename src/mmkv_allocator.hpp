@@ -34,8 +34,10 @@
 #include <new>
 #include <algorithm>
 #include <cstddef>
+#include <string.h>
 #include <stdexcept>
 #include <boost/interprocess/offset_ptr.hpp>
+#include "slab.hpp"
 
 extern "C" {
     extern void* mspace_malloc(void* msp, size_t bytes);
@@ -46,14 +48,52 @@ extern "C" {
 
 namespace mmkv
 {
+    /*
+     * serialize mspace access among writers of different dbs in per db lock mode,
+     * no-op for other stores.
+     */
+    void lock_mspace(void* msp);
+    void unlock_mspace(void* msp);
+
+    static const int kMaxMSpaceLockCount = 16;
+    /*
+     * per thread slab block caching of a store opened with per db lock, 'slot' indexes the store among
+     * per db lock stores of the process, 'serial' changes whenever cached blocks must be dropped.
+     * returns false if caching is disabled for the store.
+     */
+    struct MSpaceCacheInfo
+    {
+            void* mspace;
+            char* base;
+            uint32_t blocks;
+            int slot;
+            uint64_t serial;
+    };
+    bool get_mspace_cache(void* msp, MSpaceCacheInfo& info);
+    bool get_mspace_cache_slot(int slot, MSpaceCacheInfo& info);
+
+    /*
+     * per db memory counters of a writer & the one of them charged with usable bytes of blocks the thread
+     * allocates or frees, NULL charges nothing. Set while a writer works on a key, cleared on unlock.
+     */
+    extern __thread int64_t* g_alloc_counters;
+    extern __thread int64_t* g_alloc_account;
+
     struct Meta
     {
             size_t file_size;
             size_t size;
             size_t mspace_offset;
+            uint32_t format_version;
+            uint32_t table_layout;
+            uint32_t hash_policy;
+            uint32_t score_precision;
+            uint64_t map_size; //mapping length of every attached process, the file grows in place up to it
+            SlabArena slab;
             Meta() :
-                    file_size(0), size(0),  mspace_offset(1)
+                    file_size(0), size(0),  mspace_offset(1), format_version(0), table_layout(0), hash_policy(0), score_precision(0), map_size(0)
             {
+                memset(&slab, 0, sizeof(slab));
             }
     };
     struct MemorySpaceInfo
@@ -139,12 +179,27 @@ namespace mmkv
                 (void) hint;
                 void* p = NULL;
                 Meta* meta = (Meta*) (m_space.space.get());
-                p = mspace_malloc((char*) (meta) + meta->mspace_offset, count * sizeof(T));
+                void* msp = (char*) (meta) + meta->mspace_offset;
+                p = slab_cache_malloc(&meta->slab, (char*) meta, msp, count * sizeof(T));
+                if (NULL == p)
+                {
+                    lock_mspace(msp);
+                    p = slab_malloc(&meta->slab, (char*) meta, msp, count * sizeof(T));
+                    if (NULL == p)
+                    {
+                        p = mspace_malloc(msp, count * sizeof(T));
+                    }
+                    unlock_mspace(msp);
+                }
                 //allocate from other space
                 if (NULL == p)
                 {
                     throw std::bad_alloc();
                 }
+                if (NULL != g_alloc_account)
+                {
+                    *g_alloc_account += usable_size(p);
+                }
                 return (T*) p;
             }
 
@@ -152,11 +207,44 @@ namespace mmkv
             {
                 void* p = NULL;
                 Meta* meta = (Meta*) (m_space.space.get());
-                p = mspace_realloc((char*) (meta) + meta->mspace_offset, oldmem, bytes);
+                void* msp = (char*) (meta) + meta->mspace_offset;
+                if (NULL != g_alloc_account && NULL != oldmem)
+                {
+                    *g_alloc_account -= usable_size(oldmem);
+                }
+                lock_mspace(msp);
+                size_t slab_size = NULL == oldmem ? 0 : slab_usable_size(&meta->slab, (char*) meta, oldmem);
+                if (slab_size >= bytes)
+                {
+                    p = oldmem;
+                }
+                else if (slab_size > 0)
+                {
+                    //blocks move between slab classes & the mspace by copy
+                    p = slab_malloc(&meta->slab, (char*) meta, msp, bytes);
+                    if (NULL == p)
+                    {
+                        p = mspace_malloc(msp, bytes);
+                    }
+                    if (NULL != p)
+                    {
+                        memcpy(p, oldmem, slab_size);
+                        slab_free(&meta->slab, (char*) meta, msp, oldmem);
+                    }
+                }
+                else
+                {
+                    p = mspace_realloc(msp, oldmem, bytes);
+                }
+                unlock_mspace(msp);
                 if (NULL == p)
                 {
                     throw std::bad_alloc();
                 }
+                if (NULL != g_alloc_account)
+                {
+                    *g_alloc_account += usable_size(p);
+                }
                 return p;
             }
 
@@ -169,7 +257,21 @@ namespace mmkv
                     return;
                 Meta* meta = (Meta*) (m_space.space.get());
                 T* p = (T*) ptr;
-                mspace_free((char*) (meta) + meta->mspace_offset, p);
+                void* msp = (char*) (meta) + meta->mspace_offset;
+                if (NULL != g_alloc_account)
+                {
+                    *g_alloc_account -= usable_size(p);
+                }
+                if (slab_cache_free(&meta->slab, (char*) meta, msp, p))
+                {
+                    return;
+                }
+                lock_mspace(msp);
+                if (!slab_free(&meta->slab, (char*) meta, msp, p))
+                {
+                    mspace_free(msp, p);
+                }
+                unlock_mspace(msp);
             }
             inline void deallocate(const pointer &ptr, size_type n = 1)
             {
@@ -177,7 +279,7 @@ namespace mmkv
             }
 
             template<typename R>
-            void destroy(R* p)
+            void destroy_ptr(R* p)
             {
                 if (NULL == p)
                 {
@@ -207,7 +309,20 @@ namespace mmkv
             //!allocate, allocation_command and allocate_many.
             size_type size(const pointer &p) const
             {
-                return (size_type) mspace_usable_size(p.get()) / sizeof(T);
+                return (size_type) usable_size(p.get()) / sizeof(T);
+            }
+            /*
+             * bytes of the slab block or mspace chunk at 'p'
+             */
+            size_t usable_size(const void* p) const
+            {
+                Meta* meta = (Meta*) (m_space.space.get());
+                size_t slab_size = slab_usable_size(&meta->slab, (char*) meta, const_cast<void*>(p));
+                if (slab_size > 0)
+                {
+                    return slab_size;
+                }
+                return mspace_usable_size(const_cast<void*>(p));
             }
 
             //!Returns address of mutable object.
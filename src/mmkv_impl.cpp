@@ -44,9 +44,11 @@ namespace mmkv
     static const char* kTableConstName = "MMKVTable";
     static const char* kExpiresConstName = "MMKVExpires";
     static const char* kDBIDSetName = "MMKVDBIDSet";
+    static const char* kMemoryCountersConstName = "MMKVMemoryCounters";
 
     MMKVImpl::MMKVImpl() :
-            m_readonly(false), m_expires(NULL), m_dbid_set(NULL)
+            m_readonly(false), m_expires(NULL), m_memory_counters(NULL), m_dbid_set(NULL), m_rehash_cursor(0), m_expire_cursor(0), m_defrag_running(
+                    false), m_defrag_db(0), m_defrag_pos(0), m_defrag_inner(0), m_defrag_idle_mark(0)
     {
 
     }
@@ -75,6 +77,21 @@ namespace mmkv
     {
         return m_segment.MSpaceUsed();
     }
+    double MMKVImpl::FragmentationRatio()
+    {
+        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        return m_segment.FragmentationRatio();
+    }
+
+    int64_t MMKVImpl::Trim()
+    {
+        if (m_readonly)
+        {
+            return ERR_PERMISSION_DENIED;
+        }
+        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        return m_segment.Trim();
+    }
 
     Allocator<char> MMKVImpl::GetCharAllocator()
     {
@@ -101,25 +118,30 @@ namespace mmkv
             if (m_kvs.size() > db)
             {
                 kv = m_kvs[db];
-                if (NULL != kv)
-                {
-                    return kv;
-                }
             }
             else
             {
                 m_kvs.resize(db + 1);
             }
         }
+        if (NULL != kv || create_if_notexist)
+        {
+            SelectMemoryCounters(db);
+        }
+        if (NULL != kv)
+        {
+            return kv;
+        }
         char name[100];
         sprintf(name, "%s_%u", kTableConstName, db);
         if (create_if_notexist && !m_readonly)
         {
+            WriteLockGuard<SleepingRWLock> meta_guard(m_segment.GetMetaLock(), m_segment.DBLockEnable());
             ObjectMapAllocator allocator(m_segment.GetMSpaceAllocator());
             bool created = false;
             //kv = m_segment.FindOrConstructObject<MMKVTable>(name, &created)(std::less<Object>(), allocator);
             kv = m_segment.FindOrConstructObject<MMKVTable>(name, &created)(
-                    allocator);
+                    allocator, m_segment.TableLayout());
 //            kv = m_segment.FindOrConstructObject<MMKVTable>(name, &created)(0, ObjectHash(), ObjectEqual(), allocator);
             if (created)
             {
@@ -133,17 +155,21 @@ namespace mmkv
         }
         else
         {
+            ReadLockGuard<SleepingRWLock> meta_guard(m_segment.GetMetaLock(), m_segment.DBLockEnable());
             kv = m_segment.FindObject<MMKVTable>(name);
         }
         if (NULL != kv)
         {
-            LockGuard<SpinMutexLock> keylock_guard(m_kv_table_lock);
-            m_kvs[db] = kv;
+            {
+                LockGuard<SpinMutexLock> keylock_guard(m_kv_table_lock);
+                m_kvs[db] = kv;
+            }
+            SelectMemoryCounters(db);
         }
         return kv;
     }
 
-    const Object* MMKVImpl::FindMMValue(MMKVTable* table, const Data& key) const
+    const Object* MMKVImpl::FindMMValue(MMKVTable* table, const Data& key)
     {
         Object tmpkey(key, false);
         MMKVTable::iterator found = table->find(tmpkey);
@@ -151,26 +177,93 @@ namespace mmkv
         {
             return NULL;
         }
+        TouchValue(found->second);
         return &(found->second);
     }
 
+    Object* MMKVImpl::GetValueObject(DBID db, const Data& key, uint32_t expected_type, bool create_if_notexist,
+            int& err, bool* created)
+    {
+        if (NULL != created)
+        {
+            *created = false;
+        }
+        err = 0;
+        MMKVTable* kv = GetMMKVTable(db, create_if_notexist);
+        if (NULL == kv)
+        {
+            err = ERR_DB_NOT_EXIST;
+            return NULL;
+        }
+        Object tmpkey(key, false);
+        if (create_if_notexist)
+        {
+            std::pair<MMKVTable::iterator, bool> ret = kv->insert(MMKVTable::value_type(tmpkey, Object()));
+            Object& value_data = ret.first->second;
+            if (ret.second)
+            {
+                ChargeMemory(expected_type);
+                m_segment.AssignObjectValue(const_cast<Object&>(ret.first->first), key, false);
+                value_data.type = expected_type;
+                if (NULL != created)
+                {
+                    *created = true;
+                }
+                return &value_data;
+            }
+            if (value_data.type != expected_type)
+            {
+                err = ERR_INVALID_TYPE;
+                return NULL;
+            }
+            ChargeMemory(expected_type);
+            TouchValue(ret.first->second);
+            return &value_data;
+        }
+        MMKVTable::iterator found = kv->find(tmpkey);
+        if (found == kv->end())
+        {
+            err = ERR_ENTRY_NOT_EXIST;
+            return NULL;
+        }
+        Object& value_data = found->second;
+        if (IsExpired(db, key, value_data))
+        {
+            err = ERR_ENTRY_NOT_EXIST;
+            return NULL;
+        }
+        if (value_data.type != expected_type)
+        {
+            err = ERR_INVALID_TYPE;
+            return NULL;
+        }
+        ChargeMemory(expected_type);
+        TouchValue(found->second);
+        return &value_data;
+    }
+
     int MMKVImpl::ReOpen(bool lock)
     {
         if (!m_readonly)
         {
             m_expires = NULL;
+            m_memory_counters = NULL;
             m_dbid_set = NULL;
             m_kvs.clear();
+            m_memory_counters_cache.clear();
 
             Allocator<char> allocator = m_segment.GetMSpaceAllocator();
             WriteLockGuard<MemorySegmentManager> keylock_guard(m_segment, lock);
             m_expires = m_segment.FindOrConstructObject<ExpireInfoSetArray>(
                     kExpiresConstName)(allocator);
+            m_memory_counters = m_segment.FindOrConstructObject<DBMemoryCountersArray>(
+                    kMemoryCountersConstName)(allocator);
             m_dbid_set = m_segment.FindOrConstructObject<DBIDSet>(kDBIDSetName)(
                     std::less<DBID>(), allocator);
         }
         else
         {
+            m_memory_counters = m_segment.FindObject<DBMemoryCountersArray>(kMemoryCountersConstName);
             m_dbid_set = m_segment.FindObject<DBIDSet>(kDBIDSetName);
         }
         return 0;
@@ -200,6 +293,16 @@ namespace mmkv
 
     ExpireInfoSet* MMKVImpl::GetDBExpireInfo(DBID db, bool create_ifnotexist)
     {
+        if (m_segment.DBLockEnable())
+        {
+            ReadLockGuard<SleepingRWLock> meta_guard(m_segment.GetMetaLock());
+            ExpireInfoSet* expire = m_expires->size() > db ? m_expires->at(db).get() : NULL;
+            if (NULL != expire || !create_ifnotexist)
+            {
+                return expire;
+            }
+        }
+        WriteLockGuard<SleepingRWLock> meta_guard(m_segment.GetMetaLock(), m_segment.DBLockEnable());
         if (m_expires->size() < (db + 1))
         {
             if (!create_ifnotexist)
@@ -218,6 +321,75 @@ namespace mmkv
         return expire;
     }
 
+    /*
+     * counters are never erased but by FlushAll, so that they are cached per process
+     */
+    DBMemoryCounters* MMKVImpl::GetDBMemoryCounters(DBID db, bool create_if_notexist)
+    {
+        {
+            LockGuard<SpinMutexLock> keylock_guard(m_kv_table_lock);
+            if (m_memory_counters_cache.size() > db && NULL != m_memory_counters_cache[db])
+            {
+                return m_memory_counters_cache[db];
+            }
+        }
+        if (NULL == m_memory_counters)
+        {
+            return NULL;
+        }
+        DBMemoryCounters* counters = NULL;
+        {
+            WriteLockGuard<SleepingRWLock> meta_guard(m_segment.GetMetaLock(), m_segment.DBLockEnable());
+            if (m_memory_counters->size() > db)
+            {
+                counters = m_memory_counters->at(db).get();
+            }
+            if (NULL == counters && create_if_notexist && !m_readonly)
+            {
+                if (m_memory_counters->size() <= db)
+                {
+                    m_memory_counters->resize(db + 1);
+                }
+                counters = ::new (m_segment.Allocate(sizeof(DBMemoryCounters))) DBMemoryCounters;
+                (*m_memory_counters)[db] = counters;
+            }
+        }
+        if (NULL != counters)
+        {
+            LockGuard<SpinMutexLock> keylock_guard(m_kv_table_lock);
+            if (m_memory_counters_cache.size() <= db)
+            {
+                m_memory_counters_cache.resize(db + 1);
+            }
+            m_memory_counters_cache[db] = counters;
+        }
+        return counters;
+    }
+
+    void MMKVImpl::SelectMemoryCounters(DBID db)
+    {
+        g_alloc_counters = NULL;
+        g_alloc_account = NULL;
+        if (m_readonly || !m_segment.IsLocked(false))
+        {
+            return;
+        }
+        DBMemoryCounters* counters = GetDBMemoryCounters(db, true);
+        if (NULL != counters)
+        {
+            g_alloc_counters = counters->bytes;
+            g_alloc_account = counters->bytes + kKeyspaceMemorySlot;
+        }
+    }
+
+    void MMKVImpl::ChargeMemory(uint32_t slot)
+    {
+        if (NULL != g_alloc_counters)
+        {
+            g_alloc_account = g_alloc_counters + slot;
+        }
+    }
+
     void MMKVImpl::ClearTTL(DBID db, const Object& key, Object& value)
     {
         if (value.hasttl)
@@ -239,8 +411,11 @@ namespace mmkv
             }
             entry.expireat = fit->second;
             value.hasttl = 0;
+            int64_t* account = g_alloc_account;
+            ChargeMemory(kKeyspaceMemorySlot);
             expire->set.erase(entry);
             expire->map.erase(fit);
+            g_alloc_account = account;
         }
     }
 
@@ -263,6 +438,32 @@ namespace mmkv
         }
     }
 
+    void MMKVImpl::CompactMakeRoom(Object& value, size_t bytes)
+    {
+        if (bytes <= value.len)
+        {
+            return;
+        }
+        //grow in 32 bytes steps, ObjectMakeRoom copies the packed entries over
+        unsigned encoding = value.encoding;
+        m_segment.ObjectMakeRoom(value, (bytes + 31) & ~((size_t) 31));
+        value.encoding = encoding;
+    }
+
+    void MMKVImpl::CreatePackedValue(Object& value, uint32_t encoding)
+    {
+        CompactMakeRoom(value, std::max(ListPack::EmptyBytes(), IntSet::EmptyBytes()));
+        value.encoding = encoding;
+        if (encoding == OBJ_ENCODING_INTSET)
+        {
+            IntSet::Init(value.WritableData());
+        }
+        else
+        {
+            ListPack::Init(value.WritableData());
+        }
+    }
+
     int MMKVImpl::GetPOD(DBID db, const Data& key, bool created_if_notexist,
             uint32_t expected_type, Data& v)
     {
@@ -284,6 +485,7 @@ namespace mmkv
             value_data = &(ret.first->second);
             if (ret.second)
             {
+                ChargeMemory(V_TYPE_POD);
                 value_data->type = V_TYPE_POD;
                 m_segment.ObjectMakeRoom(*value_data,
                         sizeof(PODHeader) + v.len);
@@ -380,6 +582,8 @@ namespace mmkv
         entry.key.db = db;
         entry.key.key = key;
         value.hasttl = 1;
+        int64_t* account = g_alloc_account;
+        ChargeMemory(kKeyspaceMemorySlot);
         ExpireInfoSet* expire = GetDBExpireInfo(db, true);
         std::pair<TTLValueTable::iterator, bool> sit = expire->map.insert(
                 TTLValueTable::value_type(entry.key, ttl));
@@ -391,6 +595,7 @@ namespace mmkv
         }
         entry.expireat = ttl;
         expire->set.insert(entry);
+        g_alloc_account = account;
     }
     uint64_t MMKVImpl::GetTTL(DBID db, const Object& key, const Object& value)
     {
@@ -435,12 +640,6 @@ namespace mmkv
             case V_TYPE_LIST:
             {
                 StringList* m = (StringList*) ptr;
-                StringList::iterator it = m->begin();
-                while (it != m->end())
-                {
-                    DestroyObjectContent(*it);
-                    it = m->erase(it);
-                }
                 destroy_value(m_segment, m);
                 break;
             }
@@ -463,9 +662,8 @@ namespace mmkv
                 SortedSet::iterator it = m->set.begin();
                 while (it != m->set.end())
                 {
-                    Object obj = it->value;
-                    it = m->set.erase(it);
-                    DestroyObjectContent(obj);
+                    DestroyScoreValue(*it);
+                    it++;
                 }
                 destroy_value(m_segment, m);
                 break;
@@ -520,14 +718,19 @@ namespace mmkv
         if (found != table->end())
         {
             Object& value_data = found->second;
+            uint32_t type = value_data.type;
+            SelectMemoryCounters(db);
             ClearTTL(db, key, value_data);
+            ChargeMemory(type);
             int err = GenericDelValue(value_data);
             if (0 != err)
             {
                 return err;
             }
             Object key_obj = found->first;
+            ChargeMemory(kKeyspaceMemorySlot);
             table->erase(found);
+            ChargeMemory(type);
             DestroyObjectContent(key_obj);
             return 1;
         }
@@ -547,14 +750,17 @@ namespace mmkv
             {
                 return 0;
             }
+            ChargeMemory(old_data.type);
             GenericDelValue(old_data);
             old_data = v;
         }
         else
         {
+            ChargeMemory(v.type);
             m_segment.AssignObjectValue(const_cast<Object&>(ret.first->first),
                     key, false);
         }
+        ChargeMemory(v.type);
         return 1;
     }
 
@@ -564,7 +770,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, true);
         if (NULL == kv)
         {
@@ -589,7 +795,7 @@ namespace mmkv
 
     int MMKVImpl::Type(DBID db, const Data& key)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -609,7 +815,13 @@ namespace mmkv
 
     int MMKVImpl::Exists(DBID db, const Data& key)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        OPTIMISTIC_READ(db, GenericExists(db, key));
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        return GenericExists(db, key);
+    }
+
+    int MMKVImpl::GenericExists(DBID db, const Data& key)
+    {
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -650,7 +862,7 @@ namespace mmkv
     }
     int64_t MMKVImpl::PTTL(DBID db, const Data& key)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -684,7 +896,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
@@ -712,7 +924,7 @@ namespace mmkv
         {
             return nx ? 0 : 1;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, src_db == dest_db ? src_db : kAllDBLock);
         EnsureWritableValueSpace();
         MMKVTable* src_kv = GetMMKVTable(src_db, false);
         MMKVTable* dst_kv = GetMMKVTable(dest_db, nx ? false : true);
@@ -726,35 +938,54 @@ namespace mmkv
         {
             return ERR_ENTRY_NOT_EXIST;
         }
+        //insert may move entries of the same table while rehashing, do not touch 'found' after it
+        Object src_key_value = found->first;
+        Object src_value = found->second;
+        //a value moved to another db takes its charge along
+        int64_t moved_bytes = src_db == dest_db ? 0 : ValueMemoryUsage(src_value);
 
         Object tmpkey2(dest_key, false);
         std::pair<MMKVTable::iterator, bool> ret = dst_kv->insert(
-                MMKVTable::value_type(tmpkey2, found->second));
+                MMKVTable::value_type(tmpkey2, src_value));
         const Object& kk = ret.first->first;
         if (ret.second)
         {
-            src_kv->erase(found);
+            ChargeMemory(src_value.type);
             if (tmpkey2 == src_key_obj)
             {
-                const_cast<Object&>(kk) = found->first;
+                const_cast<Object&>(kk) = src_key_value;
+                if (src_db != dest_db && src_key_value.IsOffsetPtr())
+                {
+                    moved_bytes += m_segment.UsableSize(src_key_value.RawValue());
+                }
             }
             else
             {
                 m_segment.AssignObjectValue(const_cast<Object&>(kk), dest_key,
                         false);
             }
-            return 1;
+        }
+        else if (nx)
+        {
+            return 0;
         }
         else
         {
-            if (!nx)
+            ret.first->second = src_value;
+        }
+        SelectMemoryCounters(src_db);
+        src_kv->erase(src_key_obj);
+        if (moved_bytes > 0)
+        {
+            DBMemoryCounters* from = GetDBMemoryCounters(src_db, false);
+            DBMemoryCounters* to = GetDBMemoryCounters(dest_db, false);
+            if (NULL != from && NULL != to)
             {
-                ret.first->second = found->second;
-                src_kv->erase(found);
-                return 1;
+                from->bytes[src_value.type] -= moved_bytes;
+                to->bytes[src_value.type] += moved_bytes;
             }
-            return 0;
         }
+        return 1;
     }
 
     int MMKVImpl::Move(DBID db, const Data& key, DBID destdb)
@@ -772,7 +1003,7 @@ namespace mmkv
     int MMKVImpl::RandomKey(DBID db, std::string& key)
     {
         key.clear();
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv || kv->size() == 0)
         {
@@ -807,7 +1038,7 @@ namespace mmkv
     int MMKVImpl::Keys(DBID db, const std::string& pattern,
             const StringArrayResult& keys)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -833,7 +1064,7 @@ namespace mmkv
     int64_t MMKVImpl::Scan(DBID db, int64_t cursor, const std::string& pattern,
             int32_t limit_count, const StringArrayResult& result)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -866,7 +1097,7 @@ namespace mmkv
 
     int64_t MMKVImpl::DBSize(DBID db)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -880,7 +1111,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -894,16 +1125,21 @@ namespace mmkv
             it++;
         }
         kv->clear();
-        m_dbid_set->erase(db);
-        DeleteMMKVTable(db);
-
         //clear expire info for db
         ExpireInfoSet* expire = GetDBExpireInfo(db, false);
+        DBMemoryCounters* counters = GetDBMemoryCounters(db, false);
+        WriteLockGuard<SleepingRWLock> meta_guard(m_segment.GetMetaLock(), m_segment.DBLockEnable());
+        m_dbid_set->erase(db);
+        DeleteMMKVTable(db);
         if (NULL != expire)
         {
             m_segment.DestroyObject<ExpireInfoSet>(expire);
             (*m_expires)[db] = NULL;
         }
+        if (NULL != counters)
+        {
+            memset(counters->bytes, 0, sizeof(counters->bytes));
+        }
         return 0;
     }
     int MMKVImpl::FlushAll()
@@ -918,23 +1154,72 @@ namespace mmkv
         return 0;
     }
 
-    int MMKVImpl::Routine()
+    int MMKVImpl::Routine(int64_t max_micros)
     {
         if (m_readonly)
         {
             return ERR_PERMISSION_DENIED;
         }
-        if (IncrementalRehash() < 0)
-        {
-            return -1;
-        }
-        if (RemoveExpiredKeys() < 0)
+        uint64_t deadline = max_micros > 0 ? get_current_micros() + max_micros : 0;
+        int step = 0; //rehash, expire, defrag
+        while (true)
         {
-            return -1;
+            int ret = 0;
+            {
+                RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+                uint64_t start = get_current_micros();
+                uint64_t slice_end = start + m_options.routine_slice_micros;
+                switch (step)
+                {
+                    case 0:
+                    {
+                        ret = IncrementalRehash(slice_end);
+                        break;
+                    }
+                    case 1:
+                    {
+                        ret = RemoveExpiredKeys(slice_end);
+                        break;
+                    }
+                    default:
+                    {
+                        ret = Defrag(slice_end);
+                        break;
+                    }
+                }
+                int64_t cost = get_current_micros() - start;
+                if (cost > m_routine_stats.max_lock_micros)
+                {
+                    m_routine_stats.max_lock_micros = cost;
+                }
+                m_routine_stats.lock_slices++;
+            }
+            if (ret < 0)
+            {
+                return ret;
+            }
+            if (0 == ret)
+            {
+                if (step == 2)
+                {
+                    return 0;
+                }
+                step++;
+            }
+            //other processes get the write lock between slices
+            if (deadline > 0 && get_current_micros() >= deadline)
+            {
+                return 1;
+            }
         }
         return 0;
     }
 
+    void MMKVImpl::GetRoutineStats(RoutineStats& stats)
+    {
+        stats = m_routine_stats;
+    }
+
 #define ROUTINE_CB()  do{ \
     if(NULL != m_options.routine_cb){\
         int ret = (*m_options.routine_cb)();\
@@ -942,14 +1227,12 @@ namespace mmkv
     }\
 }while(0)
 
-    int MMKVImpl::IncrementalRehash()
+    /*
+     * Rehash dbs from 'm_rehash_cursor' until 'slice_end', return 1 if stopped before all dbs rehashed.
+     */
+    int MMKVImpl::IncrementalRehash(uint64_t slice_end)
     {
-        if (m_readonly)
-        {
-            return ERR_PERMISSION_DENIED;
-        }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
-        DBIDSet::iterator it = m_dbid_set->begin();
+        DBIDSet::iterator it = m_dbid_set->lower_bound(m_rehash_cursor);
         while (it != m_dbid_set->end())
         {
             MMKVTable* table = GetMMKVTable(*it, false);
@@ -960,23 +1243,27 @@ namespace mmkv
                 {
                     table->incremental_rehash(100);
                     ROUTINE_CB();
+                    if (get_current_micros() >= slice_end)
+                    {
+                        m_rehash_cursor = *it;
+                        return 1;
+                    }
                 }
             }
             ROUTINE_CB();
             it++;
         }
+        m_rehash_cursor = 0;
         return 0;
     }
 
-    int MMKVImpl::RemoveExpiredKeys()
+    /*
+     * Remove expired keys of dbs from 'm_expire_cursor' until 'slice_end', return 1 if stopped before all dbs checked.
+     */
+    int MMKVImpl::RemoveExpiredKeys(uint64_t slice_end)
     {
-        if (m_readonly)
-        {
-            return ERR_PERMISSION_DENIED;
-        }
         uint64_t start = get_current_micros();
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
-        for (size_t i = 0; i < m_expires->size(); i++)
+        for (size_t i = m_expire_cursor; i < m_expires->size(); i++)
         {
             ExpireInfoSet* expire = m_expires->at(i).get();
             if (NULL == expire)
@@ -1015,20 +1302,282 @@ namespace mmkv
                             err);
                 }
                 ROUTINE_CB();
+                if (get_current_micros() >= slice_end)
+                {
+                    m_expire_cursor = i;
+                    return 1;
+                }
             }
         }
+        m_expire_cursor = 0;
         return 0;
     }
 
+    static inline void repoint_object(Object& obj, const void* p)
+    {
+        *(boost::interprocess::offset_ptr<const void>*) obj.data = p;
+    }
+
+    /*
+     * Move small blocks of table entries, keys, string & packed values and members of hashes, sets & zsets out of sparse
+     * slabs, so that emptied slabs return to the mspace. Container structures hold offset pointers into
+     * themselves and are never moved. Return 1 if stopped before the pass is done.
+     */
+    int MMKVImpl::Defrag(uint64_t slice_end)
+    {
+        if (!m_defrag_running)
+        {
+            size_t slab_free = m_segment.SlabFreeBytes();
+            if (m_options.defrag_ratio <= 0 || slab_free < 16 * kSlabSize || slab_free == m_defrag_idle_mark
+                    || m_segment.FragmentationRatio() <= m_options.defrag_ratio)
+            {
+                return 0;
+            }
+            m_defrag_running = true;
+            m_defrag_db = 0;
+            m_defrag_pos = 0;
+            m_defrag_inner = 0;
+        }
+        DBIDSet::iterator it = m_dbid_set->lower_bound(m_defrag_db);
+        while (it != m_dbid_set->end())
+        {
+            MMKVTable* kv = GetMMKVTable(*it, false);
+            if (NULL != kv)
+            {
+                size_t pos = m_defrag_pos >= kv->bucket_count() ? kv->bucket_count() : m_defrag_pos;
+                MMKVTable::iterator kit = kv->get_iterator(pos);
+                while (kit != kv->end())
+                {
+                    if (0 == m_defrag_inner)
+                    {
+                        DefragTableEntry(*kv, kit);
+                    }
+                    if (DefragEntry(*it, const_cast<Object&>(kit->first), kit->second, slice_end))
+                    {
+                        m_defrag_inner = 0;
+                        kit++;
+                    }
+                    ROUTINE_CB();
+                    if (get_current_micros() >= slice_end)
+                    {
+                        m_defrag_db = *it;
+                        m_defrag_pos = kit == kv->end() ? kv->bucket_count() : kit.position();
+                        return 1;
+                    }
+                }
+            }
+            m_defrag_pos = 0;
+            m_defrag_inner = 0;
+            it++;
+        }
+        m_defrag_running = false;
+        m_defrag_idle_mark = m_segment.SlabFreeBytes();
+        if (m_options.trim_after_defrag)
+        {
+            m_segment.Trim();
+        }
+        return 0;
+    }
+
+    /*
+     * entries of probing layout tables are allocated one by one, the offset pointers of a copied entry
+     * are repointed to what they referred to.
+     */
+    void MMKVImpl::DefragTableEntry(MMKVTable& kv, MMKVTable::iterator& it)
+    {
+        if (!kv.allocated_entries())
+        {
+            return;
+        }
+        MMKVTable::value_type& entry = *it;
+        const char* key = entry.first.RawValue();
+        const char* value = entry.second.RawValue();
+        MMKVTable::value_type* p = (MMKVTable::value_type*) m_segment.Relocate(&entry);
+        if (NULL == p)
+        {
+            return;
+        }
+        if (p->first.IsOffsetPtr())
+        {
+            repoint_object(const_cast<Object&>(p->first), key);
+        }
+        if (p->second.IsOffsetPtr())
+        {
+            repoint_object(p->second, value);
+        }
+        kv.relocate_entry(it, p);
+    }
+
+    /*
+     * Return false if stopped inside the container of 'value', 'm_defrag_inner' is the next element.
+     */
+    bool MMKVImpl::DefragEntry(DBID db, Object& key, Object& value, uint64_t slice_end)
+    {
+        if (0 == m_defrag_inner)
+        {
+            if (value.hasttl)
+            {
+                DefragTTLKey(db, key);
+            }
+            else
+            {
+                DefragObject(key);
+            }
+        }
+        //the entry may have changed since the last slice, only containers are resumed
+        if (value.type == V_TYPE_STRING || value.IsCompact() || value.IsIntSet())
+        {
+            if (0 == m_defrag_inner)
+            {
+                DefragObject(value);
+            }
+            return true;
+        }
+        switch (value.type)
+        {
+            case V_TYPE_HASH:
+            {
+                return DefragElements(*(StringHashTable*) value.RawValue(), slice_end);
+            }
+            case V_TYPE_SET:
+            {
+                return DefragElements(*(StringSet*) value.RawValue(), slice_end);
+            }
+            case V_TYPE_ZSET:
+            {
+                ZSet* zset = (ZSet*) value.RawValue();
+                SortedSet::iterator it = zset->set.begin();
+                if (m_defrag_inner >= (size_t) zset->set.size())
+                {
+                    return true;
+                }
+                it.increment_by(m_defrag_inner);
+                while (it != zset->set.end())
+                {
+                    DefragElement(*zset, const_cast<ScoreValue&>(*it));
+                    m_defrag_inner++;
+                    it++;
+                    if (it != zset->set.end() && get_current_micros() >= slice_end)
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            default:
+            {
+                return true;
+            }
+        }
+    }
+
+    template<typename T>
+    bool MMKVImpl::DefragElements(T& container, uint64_t slice_end)
+    {
+        typename T::iterator it = container.begin();
+        if (m_defrag_inner >= (size_t) container.size())
+        {
+            return true;
+        }
+        it.increment_by(m_defrag_inner);
+        while (it != container.end())
+        {
+            DefragElement(const_cast<typename T::value_type&>(*it));
+            m_defrag_inner++;
+            it++;
+            if (it != container.end() && get_current_micros() >= slice_end)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void MMKVImpl::DefragObject(Object& obj)
+    {
+        if (!obj.IsOffsetPtr())
+        {
+            return;
+        }
+        void* p = m_segment.Relocate(obj.WritableData());
+        if (NULL != p)
+        {
+            repoint_object(obj, p);
+        }
+    }
+    /*
+     * expire entries share the key bytes, they are repointed along with the key
+     */
+    void MMKVImpl::DefragTTLKey(DBID db, Object& key)
+    {
+        ExpireInfoSet* expire = GetDBExpireInfo(db, false);
+        if (!key.IsOffsetPtr() || NULL == expire)
+        {
+            return;
+        }
+        TTLValue entry;
+        entry.key.db = db;
+        entry.key.key = key;
+        TTLValueTable::iterator fit = expire->map.find(entry.key);
+        if (fit == expire->map.end())
+        {
+            return;
+        }
+        entry.expireat = fit->second;
+        TTLValueSet::iterator sit = expire->set.find(entry);
+        if (sit == expire->set.end())
+        {
+            return;
+        }
+        void* p = m_segment.Relocate(key.WritableData());
+        if (NULL != p)
+        {
+            repoint_object(key, p);
+            repoint_object(const_cast<Object&>(fit->first.key), p);
+            repoint_object(const_cast<Object&>(sit->key.key), p);
+        }
+    }
+    void MMKVImpl::DefragElement(Object& member)
+    {
+        DefragObject(member);
+    }
+    void MMKVImpl::DefragElement(StringPair& entry)
+    {
+        DefragObject(const_cast<Object&>(entry.first));
+        DefragObject(entry.second);
+    }
+    /*
+     * a zset element is referenced by both the sorted set & the member index
+     */
+    void MMKVImpl::DefragElement(ZSet& zset, ScoreValue& element)
+    {
+        ZSetMemberTable::iterator mit = zset.members.find(element.value);
+        if (mit == zset.members.end())
+        {
+            return;
+        }
+        size_t score_bytes = element.ScoreBytes();
+        char* p = (char*) m_segment.Relocate(element.value.WritableData() - score_bytes);
+        if (NULL != p)
+        {
+            repoint_object(element.value, p + score_bytes);
+            repoint_object(const_cast<Object&>(*mit), p + score_bytes);
+        }
+    }
+
     int MMKVImpl::Backup(const std::string& file)
     {
         RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
         return m_segment.Backup(file);
     }
-    int MMKVImpl::Restore(const std::string& from_file)
+    int MMKVImpl::BackupIncrement(const std::string& base_file, const std::string& file)
+    {
+        return m_segment.BackupIncrement(base_file, file);
+    }
+    int MMKVImpl::Restore(const std::string& from_file, const StringArray& increments)
     {
         RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
-        int err = m_segment.Restore(from_file);
+        int err = m_segment.Restore(from_file, increments);
         ReOpen(false);
         return err;
     }
@@ -1042,16 +1591,177 @@ namespace mmkv
 //        return m_segment.CheckEqual(file);
 //    }
 
+    static const uint32_t kLFULogFactor = 10;
+
+    /*
+     * LFU counter after one decrement per idle minute since the last access
+     */
+    static inline uint32_t lfu_decayed_counter(uint32_t lru, uint32_t now)
+    {
+        uint32_t counter = lru & 0xFF;
+        uint32_t idle_minutes = (((now >> 8) - (lru >> 8)) & 0xFFFFFF) / 60;
+        return idle_minutes >= counter ? 0 : counter - idle_minutes;
+    }
+
+    void MMKVImpl::TouchValue(MMValue& value)
+    {
+        //optimistic readers hold no lock, the entry may have been freed under them
+        if (m_options.max_memory <= 0 || m_readonly || !(m_segment.IsLocked(true) || m_segment.IsLocked(false)))
+        {
+            return;
+        }
+        uint32_t now = access_clock_now();
+        uint32_t counter = value.lru & 0xFF;
+        if (m_options.max_memory_policy == ALLKEYS_LFU)
+        {
+            //logarithmic counter as redis: the more hits a key has, the less likely the next one counts
+            counter = lfu_decayed_counter(value.lru, now);
+            uint32_t base = counter > kLFUInitCounter ? counter - kLFUInitCounter : 0;
+            if (counter < 255 && random() < RAND_MAX / (base * kLFULogFactor + 1))
+            {
+                counter++;
+            }
+        }
+        value.lru = now | counter;
+    }
+
+    size_t MMKVImpl::UsedMemory()
+    {
+        size_t used = m_segment.MSpaceUsed();
+        size_t wasted = m_segment.SlabFreeBytes();
+        return used > wasted ? used - wasted : 0;
+    }
+
+    /*
+     * Evict one key picked by 'max_memory_policy' out of 'dbs', return false if there was no candidate.
+     */
+    bool MMKVImpl::EvictKey(const std::vector<DBID>& dbs)
+    {
+        if (m_options.max_memory_policy == VOLATILE_TTL)
+        {
+            //expire sets are ordered by expire time, so the first entries are exact candidates
+            const TTLValue* best = NULL;
+            for (size_t i = 0; i < dbs.size(); i++)
+            {
+                ExpireInfoSet* expire = GetDBExpireInfo(dbs[i], false);
+                if (NULL != expire && !expire->set.empty()
+                        && (NULL == best || expire->set.begin()->expireat < best->expireat))
+                {
+                    best = &(*(expire->set.begin()));
+                }
+            }
+            if (NULL == best)
+            {
+                return false;
+            }
+            MMKVTable* kv = GetMMKVTable(best->key.db, false);
+            return NULL != kv && GenericDel(kv, best->key.db, best->key.key) > 0;
+        }
+        bool lfu = m_options.max_memory_policy == ALLKEYS_LFU;
+        uint32_t samples = m_options.max_memory_samples > 0 ? m_options.max_memory_samples : 1;
+        uint32_t now = access_clock_now();
+        MMKVTable* best_kv = NULL;
+        DBID best_db = 0;
+        Object best_key;
+        uint64_t best_score = 0;
+        //volatile keys may be rare, give up after some misses
+        for (uint32_t i = 0, tries = 0; i < samples && tries < samples * 10; tries++)
+        {
+            DBID db = dbs[random() % dbs.size()];
+            MMKVTable* kv = GetMMKVTable(db, false);
+            if (NULL == kv || kv->size() == 0)
+            {
+                continue;
+            }
+            MMKVTable::iterator it = kv->sample_iterator(random());
+            if (it == kv->end())
+            {
+                continue;
+            }
+            if (m_options.max_memory_policy == VOLATILE_LRU && !it->second.hasttl)
+            {
+                continue;
+            }
+            i++;
+            uint32_t lru = it->second.lru;
+            uint64_t idle = ((now >> 8) - (lru >> 8)) & 0xFFFFFF;
+            uint64_t score = lfu ? ((uint64_t) (255 - lfu_decayed_counter(lru, now)) << 24) | idle : idle;
+            if (NULL == best_kv || score > best_score)
+            {
+                best_kv = kv;
+                best_db = db;
+                best_key = it->first;
+                best_score = score;
+            }
+        }
+        if (NULL == best_kv)
+        {
+            return false;
+        }
+        return GenericDel(best_kv, best_db, best_key) > 0;
+    }
+
+    /*
+     * Called by writers before they allocate, evicts keys until the stored data fits 'max_memory' again.
+     */
+    void MMKVImpl::EvictKeys()
+    {
+        uint32_t locked_db = m_segment.LockedDB();
+        if (locked_db != kAllDBLock)
+        {
+            //candidates come from all dbs, trade the db lock for the store write lock first
+            m_segment.UnlockDB(locked_db, WRITE_LOCK);
+            m_segment.Lock(WRITE_LOCK);
+        }
+        std::vector<DBID> dbs;
+        if (NULL != m_dbid_set)
+        {
+            dbs.assign(m_dbid_set->begin(), m_dbid_set->end());
+        }
+        while (!dbs.empty() && UsedMemory() > (size_t) m_options.max_memory)
+        {
+            if (!EvictKey(dbs))
+            {
+                DEBUG_LOG("No key to evict while %llu bytes used exceed max_memory.", UsedMemory());
+                break;
+            }
+        }
+        if (locked_db != kAllDBLock)
+        {
+            m_segment.Unlock(WRITE_LOCK);
+            m_segment.LockDB(locked_db, WRITE_LOCK);
+        }
+    }
+
     int MMKVImpl::EnsureWritableValueSpace(size_t space_size)
     {
+        if (!m_readonly && m_options.max_memory > 0 && UsedMemory() > (size_t) m_options.max_memory)
+        {
+            EvictKeys();
+        }
         if (!m_readonly
                 && (m_options.create_options.autoexpand || space_size > 0))
         {
-            if (m_segment.EnsureWritableValueSpace(space_size) > 0)
+            uint32_t locked_db = m_segment.LockedDB();
+            int ret = m_segment.EnsureWritableValueSpace(space_size, locked_db == kAllDBLock);
+            if (ret == EXPAND_NEED_REMAP)
+            {
+                //remap moves the whole store, so trade the db lock for the store write lock first
+                m_segment.UnlockDB(locked_db, WRITE_LOCK);
+                m_segment.Lock(WRITE_LOCK);
+                ret = m_segment.EnsureWritableValueSpace(space_size, true);
+                if (ret == EXPAND_REMAPPED)
+                {
+                    ReOpen(false);
+                }
+                m_segment.Unlock(WRITE_LOCK);
+                m_segment.LockDB(locked_db, WRITE_LOCK);
+            }
+            else if (ret == EXPAND_REMAPPED)
             {
                 ReOpen(false);
-                return 1;
             }
+            return ret > 0 ? 1 : 0;
         }
         return 0;
     }
@@ -1084,6 +1794,12 @@ namespace mmkv
                 {
                     info.expires = expires->set.size();
                 }
+                DBMemoryCounters* counters = GetDBMemoryCounters(*it, false);
+                if (NULL != counters)
+                {
+                    memcpy(info.type_bytes, counters->bytes, sizeof(info.type_bytes));
+                    info.keyspace_bytes = counters->bytes[kKeyspaceMemorySlot];
+                }
                 dbs.push_back(info);
             }
             it++;
@@ -1091,8 +1807,109 @@ namespace mmkv
         return 0;
     }
 
+    int MMKVImpl::GetProbeHistogram(DBID db, ProbeHistogram& histogram)
+    {
+        histogram.clear();
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        MMKVTable* table = GetMMKVTable(db, false);
+        if (NULL == table)
+        {
+            return ERR_DB_NOT_EXIST;
+        }
+        table->probe_histogram(histogram);
+        return 0;
+    }
+
+    static inline size_t object_memory_usage(MemorySegmentManager& segment, const Object& obj)
+    {
+        return obj.IsOffsetPtr() ? segment.UsableSize(obj.RawValue()) : 0;
+    }
+
+    /*
+     * usable bytes of the value's blocks, node counts of btrees & bucket arrays of hashtables are estimated
+     */
+    int64_t MMKVImpl::ValueMemoryUsage(const Object& value)
+    {
+        int64_t bytes = object_memory_usage(m_segment, value);
+        if (value.encoding != OBJ_ENCODING_OFFSET_PTR)
+        {
+            return bytes;
+        }
+        switch (value.type)
+        {
+            case V_TYPE_HASH:
+            {
+                StringHashTable* m = (StringHashTable*) value.RawValue();
+                bytes += m->bytes_used();
+                StringHashTable::iterator it = m->begin();
+                while (it != m->end())
+                {
+                    bytes += object_memory_usage(m_segment, it->first) + object_memory_usage(m_segment, it->second);
+                    it++;
+                }
+                break;
+            }
+            case V_TYPE_SET:
+            {
+                StringSet* m = (StringSet*) value.RawValue();
+                bytes += m->bytes_used();
+                StringSet::iterator it = m->begin();
+                while (it != m->end())
+                {
+                    bytes += object_memory_usage(m_segment, *it);
+                    it++;
+                }
+                break;
+            }
+            case V_TYPE_ZSET:
+            {
+                ZSet* m = (ZSet*) value.RawValue();
+                bytes += m->set.bytes_used() + m->members.memory_usage();
+                SortedSet::iterator it = m->set.begin();
+                while (it != m->set.end())
+                {
+                    bytes += m_segment.UsableSize(it->value.RawValue() - it->ScoreBytes());
+                    it++;
+                }
+                break;
+            }
+            case V_TYPE_LIST:
+            {
+                bytes += ((StringList*) value.RawValue())->MemoryUsage();
+                break;
+            }
+            default:
+            {
+                break;
+            }
+        }
+        return bytes;
+    }
+
+    int64_t MMKVImpl::MemoryUsage(DBID db, const Data& key)
+    {
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        MMKVTable* kv = GetMMKVTable(db, false);
+        if (NULL == kv)
+        {
+            return ERR_ENTRY_NOT_EXIST;
+        }
+        MMKVTable::iterator found = kv->find(Object(key, false));
+        if (found == kv->end())
+        {
+            return ERR_ENTRY_NOT_EXIST;
+        }
+        int64_t bytes = object_memory_usage(m_segment, found->first) + ValueMemoryUsage(found->second);
+        if (kv->allocated_entries())
+        {
+            bytes += m_segment.UsableSize(&(*found));
+        }
+        return bytes;
+    }
+
     MMKVImpl::~MMKVImpl()
     {
+        m_segment.FlushAllocCache();
     }
 }
 
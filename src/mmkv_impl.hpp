@@ -41,8 +41,27 @@
 #include "mmkv_options.hpp"
 
 #define DENSE_TABLE_DELETED_KEY "\t\t\t\t"
+
+/*
+ * Try the lock free read 'expr' for 'optimistic_read', return its result if no write happened meanwhile,
+ * otherwise fallback to the locked read path below.
+ */
+#define OPTIMISTIC_READ(db, expr)  do{ \
+    ReadVersion _version;\
+    for (int _i = 0; _i < kOptimisticReadRetry && m_segment.OptimisticReadBegin(db, _version); _i++){\
+        int _ret = (expr);\
+        if(m_segment.OptimisticReadEnd(db, _version)) return _ret;\
+    }\
+}while(0)
 namespace mmkv
 {
+    static const int kOptimisticReadRetry = 3;
+    /*
+     * keys looked up together by multi key reads, their buckets & entries are prefetched
+     * before any of them is resolved.
+     */
+    static const size_t kLookupBatchSize = 16;
+
     /* Struct to hold a inclusive/exclusive range spec by score comparison. */
     typedef struct
     {
@@ -59,6 +78,9 @@ namespace mmkv
             typedef std::vector<MMKVTable*> MMKVTableArray;
             MMKVTableArray m_kvs;
             ExpireInfoSetArray* m_expires;
+            DBMemoryCountersArray* m_memory_counters;
+            typedef std::vector<DBMemoryCounters*> DBMemoryCountersCache;
+            DBMemoryCountersCache m_memory_counters_cache;
             DBIDSet* m_dbid_set;
             SpinMutexLock m_kv_table_lock;
             Logger m_logger;
@@ -68,6 +90,19 @@ namespace mmkv
 
             OpenOptions m_options;
 
+            DBID m_rehash_cursor;
+            DBID m_expire_cursor;
+            /*
+             * defragmentation pass state: db, table bucket & element index inside the container of the current key.
+             * 'm_defrag_idle_mark' is the slab free bytes after the last pass, no pass starts until it changes.
+             */
+            bool m_defrag_running;
+            DBID m_defrag_db;
+            size_t m_defrag_pos;
+            size_t m_defrag_inner;
+            size_t m_defrag_idle_mark;
+            RoutineStats m_routine_stats;
+
             friend class IteratorCursor;
             friend class Iterator;
 
@@ -85,24 +120,80 @@ namespace mmkv
             void DestroyObjectContent(const Object& obj);
             Object CloneStrObject(const Object& obi);
 
+            /*
+             * small hashes/sets packed as 'ListPack', integer sets as 'IntSet', converted to btree beyond
+             * 'OpenOptions' limits
+             */
+            ListPack GetListPack(const Object& value)
+            {
+                return ListPack(value.RawValue(), value.len);
+            }
+            IntSet GetIntSet(const Object& value)
+            {
+                return IntSet(value.RawValue(), value.len);
+            }
+            void CompactMakeRoom(Object& value, size_t bytes);
+            void CreatePackedValue(Object& value, uint32_t encoding);
+            Object* GetHashValue(DBID db, const Data& key, bool create_if_notexist, size_t new_entries, size_t max_len,
+                    int& err);
+            StringHashTable* ConvertCompactHash(Object& value);
+            int CompactHSet(Object& value, const Data& field, const Data& val, bool nx);
+            void ConvertHashIfOversized(Object& value);
+            void CreateSetValue(Object& value, size_t entries, size_t max_len, bool integers);
+            Object* GetSetValue(DBID db, const Data& key, bool create_if_notexist, size_t new_entries, size_t max_len,
+                    bool integers, int& err);
+            StringSet* ConvertPackedSet(Object& value);
+            void ConvertIntSet(Object& value, size_t new_entries, size_t max_len);
+            int SetAddMember(Object& value, const Data& member);
+            int SetRemoveMember(Object& value, const Data& member);
+            bool SetIsMember(const Object& value, const Data& member);
+            size_t SetSize(const Object& value);
+            void ConvertSetIfOversized(Object& value);
+            int StoreSetMembers(DBID db, const Data& dest, const StringArray& members, bool integers);
+            /*
+             * list created with node size & compression of 'OpenOptions'
+             */
+            StringList* GetListValue(DBID db, const Data& key, bool create_if_notexist, int& err);
+
             void CreateHLLObject(Object& obj);
             int HLLSparseToDense(Object& o);
             int HLLSparseAdd(Object& o, unsigned char *ele, size_t elesize);
             int HLLAdd(Object& o, unsigned char *ele, size_t elesize);
 
-            void AssignScoreValue(ScoreValue& sv, long double score, const Data& value);
+            /*
+             * allocates the element of a zset member, see 'ScoreValue'
+             */
+            void CreateScoreValue(ScoreValue& sv, long double score, const Data& member);
+            void DestroyScoreValue(const ScoreValue& sv);
+            /*
+             * rounds 'score' to the score precision of the store
+             */
+            long double StoredScore(long double score);
             MMKVTable* GetMMKVTable(DBID db, bool create_if_notexist);
             int DeleteMMKVTable(DBID db);
             ExpireInfoSet* GetDBExpireInfo(DBID db, bool create_ifnotexist);
+            /*
+             * 'SelectMemoryCounters' charges allocations of a writer to the keyspace of 'db', 'ChargeMemory'
+             * switches to another slot of the same db: writers charge the key table & ttl index to the keyspace,
+             * keys & values to the value type.
+             */
+            DBMemoryCounters* GetDBMemoryCounters(DBID db, bool create_if_notexist);
+            void SelectMemoryCounters(DBID db);
+            void ChargeMemory(uint32_t slot);
+            int64_t ValueMemoryUsage(const Object& value);
             void ClearTTL(DBID db, const Object& key, Object& value);
             void SetTTL(DBID db, const Object& key, Object& value, uint64_t ttl);
             uint64_t GetTTL(DBID db, const Object& key, const Object& value);
 
-            const Object* FindMMValue(MMKVTable* table, const Data& key) const;
+            const Object* FindMMValue(MMKVTable* table, const Data& key);
             Object& FindOrCreateStringValue(MMKVTable* table, const Data& key, const Data& value, bool& created);
             int GenericSet(MMKVTable* table, DBID db, const Data& key, const Data& value, int32_t ex, int64_t px,
                     int8_t nx_xx, bool replace = false);
             int GenericGet(MMKVTable* table, DBID db, const Data& key, std::string& value);
+            int GenericGet(DBID db, const Data& key, std::string& value);
+            int GenericExists(DBID db, const Data& key);
+            int GenericHGet(DBID db, const Data& key, const Data& field, std::string& val);
+            int GenericZScore(DBID db, const Data& key, const Data& member, long double& score);
             int GenericDelValue(const Object& v);
             int GenericDelValue(uint32_t type, void* p);
             int GenericDel(MMKVTable* table, DBID db, const Object& key);
@@ -111,20 +202,45 @@ namespace mmkv
 
             int GenericSInterDiffUnion(DBID db, int op, const DataArray& keys, const Data* dest,
                     const StringArrayResult* results);
+            int GenericIntSetInterDiffUnion(DBID db, int op, const DataArray& keys, const Data* dest,
+                    const StringArrayResult* results);
 
             int GenericZSetInterUnion(DBID db, int op, const Data& destination, const DataArray& keys,
                     const WeightArray& weights, const std::string& aggregate);
             int ReOpen(bool lock);
             int EnsureWritableValueSpace(size_t space_size = 0);
+            /*
+             * access clock & eviction for 'max_memory', the clock is only updated with a limit set, so that
+             * reads do not dirty pages of the data file otherwise.
+             */
+            void TouchValue(MMValue& value);
+            size_t UsedMemory();
+            void EvictKeys();
+            bool EvictKey(const std::vector<DBID>& dbs);
             int GetValueByPattern(MMKVTable* table, const std::string& pattern, const Object& subst, Object& value);
             bool MatchValueByPattern(MMKVTable* table, const std::string& pattern, const std::string& value_pattern,
                     Object& subst);
-            int UpdateZSetScore(ZSet& zset, const Object& value, long double score, long double new_score);
+            /*
+             * adds 'member' to 'zset' or updates its score, returns 1 if added, 0 if updated, -1 if unchanged
+             */
+            int GenericZAdd(ZSet& zset, const Data& member, long double score, bool nx, bool xx, bool incr,
+                    long double& new_score);
+            void UpdateZSetScore(ZSet& zset, ScoreValue sv, long double new_score);
             int GeoSearchWithMinLimit(DBID db, const Data& key, const GeoSearchOptions& options, int coord_type,
                     long double x, long double y, int min_limit, const StringArrayResult& results);
 
-            int IncrementalRehash();
-            int RemoveExpiredKeys();
+            int IncrementalRehash(uint64_t slice_end);
+            int RemoveExpiredKeys(uint64_t slice_end);
+            int Defrag(uint64_t slice_end);
+            void DefragTableEntry(MMKVTable& kv, MMKVTable::iterator& it);
+            bool DefragEntry(DBID db, Object& key, Object& value, uint64_t slice_end);
+            template<typename T>
+            bool DefragElements(T& container, uint64_t slice_end);
+            void DefragObject(Object& obj);
+            void DefragTTLKey(DBID db, Object& key);
+            void DefragElement(Object& member);
+            void DefragElement(StringPair& entry);
+            void DefragElement(ZSet& zset, ScoreValue& element);
         public:
             MMKVImpl();
             MemorySegmentManager& GetMemoryManager()
@@ -134,86 +250,35 @@ namespace mmkv
             int Open(const OpenOptions& open_options);
 
             size_t MSpaceUsed();
+            double FragmentationRatio();
+            int64_t Trim();
 
+            /*
+             * value object of 'key', a created value is left empty with 'expected_type' for caller to fill
+             */
+            Object* GetValueObject(DBID db, const Data& key, uint32_t expected_type, bool create_if_notexist, int& err,
+                    bool* created = NULL);
             template<typename T>
             ConstructorProxy<T> GetObject(DBID db, const Data& key, uint32_t expected_type, bool create_if_notexist,
                     int& err, bool* created = NULL)
             {
+                ConstructorProxy<T> proxy;
+                bool value_created = false;
+                Object* value = GetValueObject(db, key, expected_type, create_if_notexist, err, &value_created);
                 if (NULL != created)
                 {
-                    *created = false;
+                    *created = value_created;
                 }
-                err = 0;
-                ConstructorProxy<T> proxy;
-                MMKVTable* kv = GetMMKVTable(db, create_if_notexist);
-                if (NULL == kv)
+                if (NULL == value)
                 {
-                    err = ERR_DB_NOT_EXIST;
                     return proxy;
                 }
-                Object tmpkey(key, false);
-                if (create_if_notexist)
-                {
-                    std::pair<MMKVTable::iterator, bool> ret = kv->insert(MMKVTable::value_type(tmpkey, Object()));
-                    //Object& value_data = const_cast<Object&>(ret.first.value());
-                    Object& value_data = ret.first->second;
-                    if (ret.second)
-                    {
-                        m_segment.AssignObjectValue(const_cast<Object&>(ret.first->first), key, false);
-//                        if (ret.second)
-//                        {
-//                            m_segment.AssignObjectValue(const_cast<Object&>(ret.first->first), key, false);
-//                        }
-//                        else
-//                        {
-//                            GenericDelValue(value_data);
-//                        }
-                        m_segment.ObjectMakeRoom(value_data, sizeof(T));
-                        value_data.type = expected_type;
-                        proxy.invoke_constructor = true;
-                        proxy.ptr = (T*) value_data.RawValue();
-                        if (NULL != created)
-                        {
-                            *created = true;
-                        }
-                    }
-                    else
-                    {
-                        if (value_data.type != expected_type)
-                        {
-                            err = ERR_INVALID_TYPE;
-                            return proxy;
-                        }
-                        proxy.ptr = (T*) (ret.first->second.RawValue());
-                        proxy.invoke_constructor = false;
-                    }
-                }
-                else
+                if (value_created)
                 {
-                    MMKVTable::iterator found = kv->find(tmpkey);
-                    if (found != kv->end())
-                    {
-                        Object& value_data = found->second;
-                        if (IsExpired(db, key, value_data))
-                        {
-                            err = ERR_ENTRY_NOT_EXIST;
-                            return proxy;
-                        }
-                        if (value_data.type == expected_type)
-                        {
-                            proxy.invoke_constructor = false;
-                            proxy.ptr = (T*) (value_data.RawValue());
-                        }
-                        else
-                        {
-                            err = ERR_INVALID_TYPE;
-                        }
-                    }
-                    else
-                    {
-                        err = ERR_ENTRY_NOT_EXIST;
-                    }
+                    m_segment.ObjectMakeRoom(*value, sizeof(T));
+                    proxy.invoke_constructor = true;
                 }
+                proxy.ptr = (T*) (value->RawValue());
                 return proxy;
             }
 
@@ -376,11 +441,15 @@ namespace mmkv
             int FlushDB(DBID db);
             int FlushAll();
             int GetAllDBInfo(DBInfoArray& dbs);
+            int64_t MemoryUsage(DBID db, const Data& key);
+            int GetProbeHistogram(DBID db, ProbeHistogram& histogram);
 
-            int Routine();
+            int Routine(int64_t max_micros = 0);
+            void GetRoutineStats(RoutineStats& stats);
 
             int Backup(const std::string& path);
-            int Restore(const std::string& from_file);
+            int BackupIncrement(const std::string& base_file, const std::string& path);
+            int Restore(const std::string& from_file, const StringArray& increments = StringArray());
             //int Restore(const std::string& backup_dir, const std::string& to_dir);
             //bool CompareDataStore(const std::string& dir);
             int EnsureWritableSpace(size_t space_size);
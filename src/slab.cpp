@@ -0,0 +1,458 @@
+/*
+ *Copyright (c) 2015-2015, yinqiwen <yinqiwen@gmail.com>
+ *All rights reserved.
+ *
+ *Redistribution and use in source and binary forms, with or without
+ *modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Redis nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ *THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "slab.hpp"
+#include "mmkv_allocator.hpp"
+#include "thread_local.hpp"
+#include <string.h>
+
+namespace mmkv
+{
+    struct SlabHeader
+    {
+            int64_t prev; //links of the partial list of the size class
+            int64_t next;
+            uint32_t size_class;
+            uint32_t capacity;
+            uint32_t used;
+            uint32_t hint; //first bitmap word which may have a free bit
+            uint32_t data_offset;
+            uint32_t bitmap_words;
+            uint64_t* Bitmap()
+            {
+                return (uint64_t*) (this + 1);
+            }
+            char* Data()
+            {
+                return (char*) this + data_offset;
+            }
+    };
+
+    static inline size_t slab_class(size_t bytes)
+    {
+        return bytes == 0 ? 0 : (bytes - 1) / kSlabClassGranularity;
+    }
+    static inline size_t slab_class_size(size_t size_class)
+    {
+        return (size_class + 1) * kSlabClassGranularity;
+    }
+    static inline SlabHeader* slab_at(char* base, int64_t offset)
+    {
+        return 0 == offset ? NULL : (SlabHeader*) (base + offset);
+    }
+    /*
+     * a frame map entry is (slab start - frame start) / 8 + 1 of the slab starting in the frame, 0 if none.
+     */
+    static inline uint16_t* slab_frame_entry(SlabArena* arena, char* base, size_t frame)
+    {
+        size_t map = frame / kSlabFramesPerMap;
+        if (map >= kSlabFrameMapCount || 0 == arena->frame_maps[map])
+        {
+            return NULL;
+        }
+        return (uint16_t*) (base + arena->frame_maps[map]) + frame % kSlabFramesPerMap;
+    }
+    static inline int64_t slab_start(SlabArena* arena, char* base, size_t frame)
+    {
+        uint16_t* entry = slab_frame_entry(arena, base, frame);
+        if (NULL == entry || 0 == *entry)
+        {
+            return -1;
+        }
+        return frame * kSlabSize + (*entry - 1) * kSlabClassGranularity;
+    }
+
+    /*
+     * slabs are not longer than a frame, so a block lives in the slab starting in its own frame or in the
+     * previous one.
+     */
+    static SlabHeader* find_slab(SlabArena* arena, char* base, void* ptr)
+    {
+        int64_t offset = (char*) ptr - base;
+        size_t frame = offset / kSlabSize;
+        int64_t start = slab_start(arena, base, frame);
+        if (start >= 0 && start <= offset)
+        {
+            return (SlabHeader*) (base + start);
+        }
+        if (frame > 0)
+        {
+            start = slab_start(arena, base, frame - 1);
+            if (start >= 0 && offset < start + (int64_t) kSlabSize)
+            {
+                return (SlabHeader*) (base + start);
+            }
+        }
+        return NULL;
+    }
+
+    static uint16_t* ensure_frame_entry(SlabArena* arena, char* base, void* msp, size_t frame)
+    {
+        size_t map = frame / kSlabFramesPerMap;
+        if (map >= kSlabFrameMapCount)
+        {
+            return NULL;
+        }
+        if (0 == arena->frame_maps[map])
+        {
+            void* buf = mspace_malloc(msp, kSlabFramesPerMap * sizeof(uint16_t));
+            if (NULL == buf)
+            {
+                return NULL;
+            }
+            memset(buf, 0, kSlabFramesPerMap * sizeof(uint16_t));
+            arena->frame_maps[map] = (char*) buf - base;
+        }
+        return slab_frame_entry(arena, base, frame);
+    }
+
+    static void link_partial(SlabArena* arena, char* base, SlabHeader* slab)
+    {
+        int64_t offset = (char*) slab - base;
+        slab->prev = 0;
+        slab->next = arena->partial[slab->size_class];
+        if (0 != slab->next)
+        {
+            slab_at(base, slab->next)->prev = offset;
+        }
+        arena->partial[slab->size_class] = offset;
+    }
+
+    static void unlink_partial(SlabArena* arena, char* base, SlabHeader* slab)
+    {
+        if (0 != slab->prev)
+        {
+            slab_at(base, slab->prev)->next = slab->next;
+        }
+        else
+        {
+            arena->partial[slab->size_class] = slab->next;
+        }
+        if (0 != slab->next)
+        {
+            slab_at(base, slab->next)->prev = slab->prev;
+        }
+        slab->prev = slab->next = 0;
+    }
+
+    static SlabHeader* new_slab(SlabArena* arena, char* base, void* msp, size_t size_class)
+    {
+        char* buf = (char*) mspace_malloc(msp, kSlabSize);
+        if (NULL == buf)
+        {
+            return NULL;
+        }
+        size_t offset = buf - base;
+        uint16_t* frame_entry = ensure_frame_entry(arena, base, msp, offset / kSlabSize);
+        if (NULL == frame_entry)
+        {
+            mspace_free(msp, buf);
+            return NULL;
+        }
+        size_t block = slab_class_size(size_class);
+        size_t capacity = (kSlabSize - sizeof(SlabHeader)) / block;
+        size_t words = (capacity + 63) / 64;
+        while (sizeof(SlabHeader) + words * sizeof(uint64_t) + capacity * block > kSlabSize)
+        {
+            capacity--;
+            words = (capacity + 63) / 64;
+        }
+        SlabHeader* slab = (SlabHeader*) buf;
+        slab->size_class = size_class;
+        slab->capacity = capacity;
+        slab->used = 0;
+        slab->hint = 0;
+        slab->bitmap_words = words;
+        slab->data_offset = sizeof(SlabHeader) + words * sizeof(uint64_t);
+        uint64_t* bitmap = slab->Bitmap();
+        memset(bitmap, 0, words * sizeof(uint64_t));
+        //bits beyond the capacity are marked used so they are never handed out
+        if (capacity % 64 != 0)
+        {
+            bitmap[words - 1] = ~0ULL << (capacity % 64);
+        }
+        *frame_entry = (offset % kSlabSize) / kSlabClassGranularity + 1;
+        link_partial(arena, base, slab);
+        arena->slab_count++;
+        return slab;
+    }
+
+    void* slab_malloc(SlabArena* arena, char* base, void* msp, size_t bytes)
+    {
+        if (bytes > kSlabMaxSize)
+        {
+            return NULL;
+        }
+        size_t size_class = slab_class(bytes);
+        SlabHeader* slab = slab_at(base, arena->partial[size_class]);
+        if (NULL == slab)
+        {
+            slab = new_slab(arena, base, msp, size_class);
+            if (NULL == slab)
+            {
+                return NULL;
+            }
+        }
+        uint64_t* bitmap = slab->Bitmap();
+        uint32_t word = slab->hint;
+        while (bitmap[word] == ~0ULL)
+        {
+            word++;
+        }
+        uint32_t bit = __builtin_ctzll(~bitmap[word]);
+        bitmap[word] |= 1ULL << bit;
+        slab->hint = word;
+        slab->used++;
+        if (slab->used == slab->capacity)
+        {
+            unlink_partial(arena, base, slab);
+        }
+        size_t block = slab_class_size(size_class);
+        arena->used_bytes += block;
+        return slab->Data() + (word * 64 + bit) * block;
+    }
+
+    bool slab_free(SlabArena* arena, char* base, void* msp, void* ptr)
+    {
+        SlabHeader* slab = find_slab(arena, base, ptr);
+        if (NULL == slab)
+        {
+            return false;
+        }
+        size_t block = slab_class_size(slab->size_class);
+        size_t index = ((char*) ptr - slab->Data()) / block;
+        uint32_t word = index / 64;
+        slab->Bitmap()[word] &= ~(1ULL << (index % 64));
+        if (word < slab->hint)
+        {
+            slab->hint = word;
+        }
+        if (slab->used == slab->capacity)
+        {
+            link_partial(arena, base, slab);
+        }
+        slab->used--;
+        arena->used_bytes -= block;
+        //empty slabs go back to the mspace unless it is the last one with free blocks of its class
+        if (0 == slab->used && (0 != slab->prev || 0 != slab->next))
+        {
+            size_t offset = (char*) slab - base;
+            unlink_partial(arena, base, slab);
+            *slab_frame_entry(arena, base, offset / kSlabSize) = 0;
+            arena->slab_count--;
+            mspace_free(msp, slab);
+        }
+        return true;
+    }
+
+    size_t slab_usable_size(SlabArena* arena, char* base, void* ptr)
+    {
+        SlabHeader* slab = find_slab(arena, base, ptr);
+        if (NULL == slab)
+        {
+            return 0;
+        }
+        return slab_class_size(slab->size_class);
+    }
+
+    void* slab_relocate(SlabArena* arena, char* base, void* msp, void* ptr)
+    {
+        SlabHeader* slab = find_slab(arena, base, ptr);
+        if (NULL == slab || slab->used == slab->capacity)
+        {
+            return NULL;
+        }
+        //the head slab is where blocks move to, slabs at least 3/4 used are not worth emptying
+        if (arena->partial[slab->size_class] == (char*) slab - base || slab->used * 4 >= slab->capacity * 3)
+        {
+            return NULL;
+        }
+        size_t block = slab_class_size(slab->size_class);
+        void* p = slab_malloc(arena, base, msp, block);
+        if (NULL == p)
+        {
+            return NULL;
+        }
+        memcpy(p, ptr, block);
+        slab_free(arena, base, msp, ptr);
+        return p;
+    }
+
+    size_t slab_free_bytes(SlabArena* arena)
+    {
+        return arena->slab_count * kSlabSize - arena->used_bytes;
+    }
+
+    struct SlabMagazine
+    {
+            uint32_t count;
+            int64_t blocks[kMaxSlabCacheBlocks]; //offsets of cached blocks, still marked used in their slabs
+    };
+    struct StoreSlabCache
+    {
+            uint64_t serial;
+            SlabMagazine magazines[kSlabClassCount];
+    };
+
+    /*
+     * returns all but the 'keep' most recently cached blocks of 'magazine' to their slabs
+     */
+    static void drain_magazine(const MSpaceCacheInfo& info, SlabMagazine& magazine, uint32_t keep)
+    {
+        if (magazine.count <= keep)
+        {
+            return;
+        }
+        SlabArena* arena = &((Meta*) info.base)->slab;
+        uint32_t drain_count = magazine.count - keep;
+        lock_mspace(info.mspace);
+        for (uint32_t i = 0; i < drain_count; i++)
+        {
+            slab_free(arena, info.base, info.mspace, info.base + magazine.blocks[i]);
+        }
+        unlock_mspace(info.mspace);
+        memmove(magazine.blocks, magazine.blocks + drain_count, keep * sizeof(int64_t));
+        magazine.count = keep;
+    }
+
+    struct ThreadSlabCache
+    {
+            StoreSlabCache* stores[kMaxMSpaceLockCount];
+            ThreadSlabCache()
+            {
+                memset(stores, 0, sizeof(stores));
+            }
+            ~ThreadSlabCache()
+            {
+                for (int i = 0; i < kMaxMSpaceLockCount; i++)
+                {
+                    if (NULL == stores[i])
+                    {
+                        continue;
+                    }
+                    MSpaceCacheInfo info;
+                    if (get_mspace_cache_slot(i, info) && info.serial == stores[i]->serial)
+                    {
+                        for (size_t j = 0; j < kSlabClassCount; j++)
+                        {
+                            drain_magazine(info, stores[i]->magazines[j], 0);
+                        }
+                    }
+                    delete stores[i];
+                }
+            }
+    };
+    static ThreadLocal<ThreadSlabCache> g_slab_cache;
+
+    static StoreSlabCache* thread_store_cache(const MSpaceCacheInfo& info)
+    {
+        StoreSlabCache*& store = g_slab_cache.GetValue().stores[info.slot];
+        if (NULL == store)
+        {
+            store = new StoreSlabCache;
+            store->serial = 0;
+        }
+        if (store->serial != info.serial)
+        {
+            //blocks cached before a fork or restore are not ours any more, drop them
+            for (size_t i = 0; i < kSlabClassCount; i++)
+            {
+                store->magazines[i].count = 0;
+            }
+            store->serial = info.serial;
+        }
+        return store;
+    }
+
+    void* slab_cache_malloc(SlabArena* arena, char* base, void* msp, size_t bytes)
+    {
+        MSpaceCacheInfo info;
+        if (bytes > kSlabMaxSize || !get_mspace_cache(msp, info))
+        {
+            return NULL;
+        }
+        SlabMagazine& magazine = thread_store_cache(info)->magazines[slab_class(bytes)];
+        if (0 == magazine.count)
+        {
+            uint32_t refill = info.blocks > 1 ? info.blocks / 2 : 1;
+            lock_mspace(msp);
+            while (magazine.count < refill)
+            {
+                void* p = slab_malloc(arena, base, msp, bytes);
+                if (NULL == p)
+                {
+                    break;
+                }
+                magazine.blocks[magazine.count++] = (char*) p - base;
+            }
+            unlock_mspace(msp);
+            if (0 == magazine.count)
+            {
+                return NULL;
+            }
+        }
+        magazine.count--;
+        return base + magazine.blocks[magazine.count];
+    }
+
+    bool slab_cache_free(SlabArena* arena, char* base, void* msp, void* ptr)
+    {
+        MSpaceCacheInfo info;
+        if (!get_mspace_cache(msp, info))
+        {
+            return false;
+        }
+        //the size class of a slab never changes while it holds used blocks, no lock needed to read it
+        SlabHeader* slab = find_slab(arena, base, ptr);
+        if (NULL == slab)
+        {
+            return false;
+        }
+        SlabMagazine& magazine = thread_store_cache(info)->magazines[slab->size_class];
+        if (magazine.count >= info.blocks)
+        {
+            drain_magazine(info, magazine, info.blocks / 2);
+        }
+        magazine.blocks[magazine.count++] = (char*) ptr - base;
+        return true;
+    }
+
+    void slab_cache_flush(void* msp)
+    {
+        MSpaceCacheInfo info;
+        if (!get_mspace_cache(msp, info))
+        {
+            return;
+        }
+        StoreSlabCache* store = thread_store_cache(info);
+        for (size_t i = 0; i < kSlabClassCount; i++)
+        {
+            drain_magazine(info, store->magazines[i], 0);
+        }
+    }
+}
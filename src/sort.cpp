@@ -94,7 +94,16 @@ namespace mmkv
             const Object* value_data = FindMMValue(table, keystr);
             if (NULL != value_data)
             {
-                if (value_data->type == V_TYPE_HASH)
+                if (value_data->type == V_TYPE_HASH && value_data->IsCompact())
+                {
+                    ListPack lp = GetListPack(*value_data);
+                    size_t pos = lp.Find(field, 2);
+                    if (pos != lp.End())
+                    {
+                        value = Object(lp.Get(lp.Next(pos)), true);
+                    }
+                }
+                else if (value_data->type == V_TYPE_HASH)
                 {
                     StringHashTable* hash = (StringHashTable*) value_data->RawValue();
                     StringHashTable::iterator it = hash->find(Object(field, true));
@@ -164,7 +173,7 @@ namespace mmkv
         std::deque<std::string> store_list;
         std::string store_tmp_str;
         {
-            RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+            DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
             MMKVTable* kv = GetMMKVTable(db, false);
             if (NULL == kv)
             {
@@ -182,6 +191,7 @@ namespace mmkv
                 nosort = true;
             }
             size_t vlen = 0;
+            std::deque<std::string> list_values;
 
             switch (value_data->type)
             {
@@ -189,17 +199,37 @@ namespace mmkv
                 {
                     StringList* data = (StringList*) value_data->RawValue();
                     vlen = data->size();
-                    StringList::iterator it = data->begin();
-                    while (it != data->end())
+                    StringList::Iterator it = data->begin();
+                    while (it.Valid())
                     {
-                        SortValue sv(*it);
+                        //entries of compressed nodes are decoded into the iterator's buffer, keep a copy
+                        Data v = it.Value();
+                        list_values.push_back(std::string(v.Value(), v.Len()));
+                        SortValue sv(Object(Data(list_values.back()), true));
                         sortvec.push_back(sv);
-                        it++;
+                        it.Next();
                     }
                     break;
                 }
                 case V_TYPE_SET:
                 {
+                    if (value_data->IsPacked())
+                    {
+                        PackedSetReader reader(*value_data);
+                        vlen = reader.Count();
+                        while (reader.Valid())
+                        {
+                            SortValue sv(reader.Member());
+                            sortvec.push_back(sv);
+                            reader.Next();
+                        }
+                        if (by.empty())
+                        {
+                            //packed set is kept sorted too
+                            nosort = true;
+                        }
+                        break;
+                    }
                     StringSet* data = (StringSet*) value_data->RawValue();
                     vlen = data->size();
                     StringSet::iterator it = data->begin();
@@ -310,11 +340,10 @@ namespace mmkv
         if (destination_key.Len() > 0)
         {
             this->Del(db, DataArray(1, destination_key));
-            RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+            DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
             EnsureWritableValueSpace();
-            ObjectAllocator alloc = m_segment.MSpaceAllocator<Object>();
             int err;
-            StringList* list = GetObject<StringList>(db, destination_key, V_TYPE_LIST, true, err)(alloc);
+            StringList* list = GetListValue(db, destination_key, true, err);
             if (0 != err)
             {
                 return err;
@@ -322,9 +351,7 @@ namespace mmkv
             std::deque<std::string>::iterator it = store_list.begin();
             while (it != store_list.end())
             {
-                Object obj;
-                m_segment.AssignObjectValue(obj, *it, true);
-                list->push_back(obj);
+                list->push_back(*it);
                 it++;
             }
             return list->size();
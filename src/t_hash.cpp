@@ -28,8 +28,114 @@
  */
 #include "lock_guard.hpp"
 #include "mmkv_impl.hpp"
+#include <algorithm>
 namespace mmkv
 {
+    /*
+     * formats a HIncrByFloat result, values of double precision stores use the shortest digits that
+     * convert back to the same double.
+     */
+    static int float2string(char* buf, size_t buf_len, long double v, bool double_precision)
+    {
+        if (!double_precision)
+        {
+            return double2string(buf, buf_len, v, true);
+        }
+        int len = snprintf(buf, buf_len, "%.15g", (double) v);
+        if (strtod(buf, NULL) != (double) v)
+        {
+            len = snprintf(buf, buf_len, "%.17g", (double) v);
+        }
+        return len;
+    }
+    Object* MMKVImpl::GetHashValue(DBID db, const Data& key, bool create_if_notexist, size_t new_entries,
+            size_t max_len, int& err)
+    {
+        bool created = false;
+        Object* value = GetValueObject(db, key, V_TYPE_HASH, create_if_notexist, err, &created);
+        if (NULL == value)
+        {
+            return NULL;
+        }
+        bool fit_compact = new_entries <= m_options.hash_max_compact_entries
+                && max_len <= m_options.hash_max_compact_value;
+        if (created)
+        {
+            if (m_options.hash_max_compact_entries > 0 && fit_compact)
+            {
+                CreatePackedValue(*value, OBJ_ENCODING_COMPACT);
+            }
+            else
+            {
+                StringMapAllocator allocator = m_segment.MSpaceAllocator<StringPair>();
+                m_segment.ObjectMakeRoom(*value, sizeof(StringHashTable));
+                ::new (value->WritableData()) StringHashTable(allocator);
+            }
+        }
+        else if (value->IsCompact()
+                && (!fit_compact || GetListPack(*value).Count() / 2 + new_entries > m_options.hash_max_compact_entries))
+        {
+            ConvertCompactHash(*value);
+        }
+        return value;
+    }
+    StringHashTable* MMKVImpl::ConvertCompactHash(Object& value)
+    {
+        ListPack lp = GetListPack(value);
+        void* buf = m_segment.Allocate(sizeof(StringHashTable));
+        StringMapAllocator allocator = m_segment.MSpaceAllocator<StringPair>();
+        StringHashTable* hash = ::new (buf) StringHashTable(allocator);
+        size_t pos = lp.Begin();
+        while (pos < lp.End())
+        {
+            Data field = lp.Get(pos);
+            pos = lp.Next(pos);
+            Data val = lp.Get(pos);
+            pos = lp.Next(pos);
+            std::pair<StringHashTable::iterator, bool> ret = hash->insert(
+                    StringHashTable::value_type(Object(field, true), Object(val, true)));
+            m_segment.AssignObjectValue(const_cast<Object&>(ret.first->first), field, true);
+            m_segment.AssignObjectValue(ret.first->second, val, true);
+        }
+        m_segment.Deallocate(value.WritableData());
+        value.SetValue(buf);
+        value.len = sizeof(StringHashTable);
+        return hash;
+    }
+    int MMKVImpl::CompactHSet(Object& value, const Data& field, const Data& val, bool nx)
+    {
+        ListPack lp = GetListPack(value);
+        size_t pos = lp.Find(field, 2);
+        if (pos != lp.End())
+        {
+            if (nx)
+            {
+                return 0;
+            }
+            size_t val_pos = lp.Next(pos);
+            size_t old_bytes = lp.Next(val_pos) - val_pos;
+            size_t new_bytes = ListPack::EntryBytes(val);
+            if (new_bytes > old_bytes)
+            {
+                CompactMakeRoom(value, lp.Bytes() + new_bytes - old_bytes);
+            }
+            GetListPack(value).Replace(val_pos, val);
+            return 0;
+        }
+        CompactMakeRoom(value, lp.Bytes() + ListPack::EntryBytes(field) + ListPack::EntryBytes(val));
+        lp = GetListPack(value);
+        lp.Insert(lp.Bytes(), field);
+        lp.Insert(lp.Bytes(), val);
+        return 1;
+    }
+    void MMKVImpl::ConvertHashIfOversized(Object& value)
+    {
+        if (value.IsCompact() && GetListPack(value).Count() / 2 > m_options.hash_max_compact_entries)
+        {
+            ConvertCompactHash(value);
+        }
+    }
+
     int MMKVImpl::HDel(DBID db, const Data& key, const DataArray& fields)
     {
         if (m_readonly)
@@ -37,8 +143,8 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, false, err)();
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetHashValue(db, key, false, 0, 0, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
@@ -48,6 +154,25 @@ namespace mmkv
             return err;
         }
         int removed = 0;
+        if (value->IsCompact())
+        {
+            ListPack lp = GetListPack(*value);
+            for (size_t i = 0; i < fields.size(); i++)
+            {
+                size_t pos = lp.Find(fields[i], 2);
+                if (pos != lp.End())
+                {
+                    lp.Erase(pos, 2);
+                    removed++;
+                }
+            }
+            if (lp.Count() == 0)
+            {
+                GenericDel(GetMMKVTable(db, false), db, Object(key, false));
+            }
+            return removed;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         for (size_t i = 0; i < fields.size(); i++)
         {
             StringHashTable::iterator found = hash->find(Object(fields[i], true));
@@ -69,8 +194,8 @@ namespace mmkv
     int MMKVImpl::HExists(DBID db, const Data& key, const Data& field)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, false, err)();
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetHashValue(db, key, false, 0, 0, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
@@ -79,19 +204,43 @@ namespace mmkv
         {
             return err;
         }
+        if (value->IsCompact())
+        {
+            ListPack lp = GetListPack(*value);
+            return lp.Find(field, 2) != lp.End();
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         StringHashTable::iterator found = hash->find(Object(field, true));
         return found != hash->end();
     }
     int MMKVImpl::HGet(DBID db, const Data& key, const Data& field, std::string& val)
+    {
+        OPTIMISTIC_READ(db, GenericHGet(db, key, field, val));
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        return GenericHGet(db, key, field, val);
+    }
+    int MMKVImpl::GenericHGet(DBID db, const Data& key, const Data& field, std::string& val)
     {
         val.clear();
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, false, err)();
-        if (NULL == hash || 0 != err)
+        Object* value = GetHashValue(db, key, false, 0, 0, err);
+        if (NULL == value || 0 != err)
         {
             return err;
         }
+        if (value->IsCompact())
+        {
+            ListPack lp = GetListPack(*value);
+            size_t pos = lp.Find(field, 2);
+            if (pos == lp.End())
+            {
+                return ERR_ENTRY_NOT_EXIST;
+            }
+            Data v = lp.Get(lp.Next(pos));
+            val.assign(v.Value(), v.Len());
+            return 0;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         StringHashTable::iterator found = hash->find(Object(field, true));
         if (found != hash->end())
         {
@@ -107,8 +256,8 @@ namespace mmkv
     int MMKVImpl::HGetAll(DBID db, const Data& key, const StringArrayResult& vals)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, false, err)();
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetHashValue(db, key, false, 0, 0, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
@@ -117,7 +266,17 @@ namespace mmkv
         {
             return err;
         }
-
+        if (value->IsCompact())
+        {
+            ListPack lp = GetListPack(*value);
+            for (size_t pos = lp.Begin(); pos < lp.End(); pos = lp.Next(pos))
+            {
+                Data v = lp.Get(pos);
+                vals.Get().assign(v.Value(), v.Len());
+            }
+            return 0;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         StringHashTable::iterator it = hash->begin();
         while (it != hash->end())
         {
@@ -138,14 +297,33 @@ namespace mmkv
         }
         int err = 0;
 
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
-        StringMapAllocator allocator = m_segment.MSpaceAllocator<StringPair>();
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, true, err)(allocator);
-        if (NULL == hash || 0 != err)
+        Object* value = GetHashValue(db, key, true, 1, field.Len(), err);
+        if (NULL == value || 0 != err)
         {
             return err;
         }
+        if (value->IsCompact())
+        {
+            ListPack lp = GetListPack(*value);
+            size_t pos = lp.Find(field, 2);
+            new_val = increment;
+            if (pos != lp.End())
+            {
+                Data v = lp.Get(lp.Next(pos));
+                long long current;
+                if (!string2ll(v.Value(), v.Len(), &current))
+                {
+                    return ERR_NOT_INTEGER;
+                }
+                new_val = current + increment;
+            }
+            CompactHSet(*value, field, Data(new_val), false);
+            ConvertHashIfOversized(*value);
+            return 0;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         std::pair<StringHashTable::iterator, bool> ret = hash->insert(
                 StringHashTable::value_type(Object(field, true), Object()));
         if (ret.second)
@@ -176,31 +354,68 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
-        StringMapAllocator allocator = m_segment.MSpaceAllocator<StringPair>();
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, true, err)(allocator);
-        if (NULL == hash || 0 != err)
+        Object* value = GetHashValue(db, key, true, 1, field.Len(), err);
+        if (NULL == value || 0 != err)
         {
             return err;
         }
+        if (value->IsCompact())
+        {
+            ListPack lp = GetListPack(*value);
+            size_t pos = lp.Find(field, 2);
+            new_val = increment;
+            if (pos != lp.End())
+            {
+                Data v = lp.Get(lp.Next(pos));
+                long long lv;
+                double dv = 0;
+                if (string2ll(v.Value(), v.Len(), &lv))
+                {
+                    new_val = lv + increment;
+                }
+                else if (string2double(v.Value(), v.Len(), &dv))
+                {
+                    new_val = dv + increment;
+                }
+                else
+                {
+                    return ERR_NOT_NUMBER;
+                }
+            }
+            new_val = StoredScore(new_val);
+            if (is_integer(new_val))
+            {
+                CompactHSet(*value, field, Data((int64_t) new_val), false);
+            }
+            else
+            {
+                char buf[256];
+                int dlen = float2string(buf, sizeof(buf), new_val, m_segment.ScorePrecision() == DOUBLE_SCORE);
+                CompactHSet(*value, field, Data(buf, dlen), false);
+            }
+            ConvertHashIfOversized(*value);
+            return 0;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         std::pair<StringHashTable::iterator, bool> ret = hash->insert(
                 StringHashTable::value_type(Object(field, true), Object()));
         if (ret.second)
         {
             m_segment.AssignObjectValue(const_cast<Object&>(ret.first->first), field, true);
-            if (is_integer(increment))
+            new_val = StoredScore(increment);
+            if (is_integer(new_val))
             {
-                ret.first->second.SetInteger((int64_t) increment);
+                ret.first->second.SetInteger((int64_t) new_val);
             }
             else
             {
                 char buf[256];
-                int dlen = double2string(buf, sizeof(buf), increment, true);
+                int dlen = float2string(buf, sizeof(buf), new_val, m_segment.ScorePrecision() == DOUBLE_SCORE);
                 Data tmp(buf, dlen);
                 m_segment.AssignObjectValue(ret.first->second, tmp, true);
             }
-            new_val = increment;
         }
         else
         {
@@ -218,6 +433,7 @@ namespace mmkv
             {
                 return ERR_NOT_NUMBER;;
             }
+            new_val = StoredScore(new_val);
             if (is_integer(new_val) && data.SetInteger((int64_t) new_val))
             {
                 //do nothing
@@ -226,7 +442,7 @@ namespace mmkv
             {
                 DestroyObjectContent(data);
                 char buf[256];
-                int dlen = double2string(buf, sizeof(buf), new_val, true);
+                int dlen = float2string(buf, sizeof(buf), new_val, m_segment.ScorePrecision() == DOUBLE_SCORE);
                 m_segment.AssignObjectValue(data, Data(buf, dlen), false);
             }
         }
@@ -235,8 +451,8 @@ namespace mmkv
     int MMKVImpl::HKeys(DBID db, const Data& key, const StringArrayResult& fields)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, false, err)();
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetHashValue(db, key, false, 0, 0, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
@@ -245,6 +461,17 @@ namespace mmkv
         {
             return err;
         }
+        if (value->IsCompact())
+        {
+            ListPack lp = GetListPack(*value);
+            for (size_t pos = lp.Begin(); pos < lp.End(); pos = lp.Next(lp.Next(pos)))
+            {
+                Data v = lp.Get(pos);
+                fields.Get().assign(v.Value(), v.Len());
+            }
+            return 0;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         StringHashTable::iterator it = hash->begin();
         while (it != hash->end())
         {
@@ -259,24 +486,29 @@ namespace mmkv
     int MMKVImpl::HLen(DBID db, const Data& key)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, false, err)();
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetHashValue(db, key, false, 0, 0, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
         }
-        if (NULL == hash || 0 != err)
+        if (NULL == value || 0 != err)
         {
             return err;
         }
+        if (value->IsCompact())
+        {
+            return GetListPack(*value).Count() / 2;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         return hash->size();
     }
     int MMKVImpl::HMGet(DBID db, const Data& key, const DataArray& fields, const StringArrayResult& vals,
             BooleanArray* get_flags)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, false, err)();
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetHashValue(db, key, false, 0, 0, err);
         if (0 != err && !IS_NOT_EXISTS(err))
         {
             return err;
@@ -285,6 +517,11 @@ namespace mmkv
         {
             get_flags->resize(fields.size());
         }
+        StringHashTable* hash = NULL;
+        if (NULL != value && !value->IsCompact())
+        {
+            hash = (StringHashTable*) value->RawValue();
+        }
         for (size_t i = 0; i < fields.size(); i++)
         {
             std::string& val = vals.Get();
@@ -300,6 +537,20 @@ namespace mmkv
                     }
                 }
             }
+            else if (NULL != value)
+            {
+                ListPack lp = GetListPack(*value);
+                size_t pos = lp.Find(fields[i], 2);
+                if (pos != lp.End())
+                {
+                    Data v = lp.Get(lp.Next(pos));
+                    val.assign(v.Value(), v.Len());
+                    if (NULL != get_flags)
+                    {
+                        (*get_flags)[i] = true;
+                    }
+                }
+            }
         }
         return 0;
     }
@@ -311,14 +562,28 @@ namespace mmkv
         }
         int err = 0;
 
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
-        StringMapAllocator allocator = m_segment.MSpaceAllocator<StringPair>();
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, true, err)(allocator);
-        if (NULL == hash || 0 != err)
+        size_t max_len = 0;
+        for (size_t i = 0; i < field_vals.size(); i++)
+        {
+            max_len = std::max(max_len, std::max(field_vals[i].first.Len(), field_vals[i].second.Len()));
+        }
+        Object* value = GetHashValue(db, key, true, field_vals.size(), max_len, err);
+        if (NULL == value || 0 != err)
         {
             return err;
         }
+        if (value->IsCompact())
+        {
+            for (size_t i = 0; i < field_vals.size(); i++)
+            {
+                CompactHSet(*value, field_vals[i].first, field_vals[i].second, false);
+            }
+            ConvertHashIfOversized(*value);
+            return 0;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         for (size_t i = 0; i < field_vals.size(); i++)
         {
             Object tmpk(field_vals[i].first, true);
@@ -339,14 +604,45 @@ namespace mmkv
     int64_t MMKVImpl::HScan(DBID db, const Data& key, int64_t cursor, const std::string& pattern, int32_t limit_count,
             const StringArrayResult& results)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         int err;
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, false, err)();
-        if (NULL == hash || 0 != err)
+        Object* value = GetHashValue(db, key, false, 0, 0, err);
+        if (NULL == value || 0 != err)
         {
             return err;
         }
         int match_count = 0;
+        if (value->IsCompact())
+        {
+            ListPack lp = GetListPack(*value);
+            int size = lp.Count() / 2;
+            int pos = cursor >= size ? size : cursor;
+            size_t offset = lp.Begin();
+            for (int i = 0; i < pos; i++)
+            {
+                offset = lp.Next(lp.Next(offset));
+            }
+            while (offset < lp.End())
+            {
+                Data field = lp.Get(offset);
+                std::string key_str(field.Value(), field.Len());
+                if (pattern == ""
+                        || stringmatchlen(pattern.c_str(), pattern.size(), key_str.c_str(), key_str.size(), 0) == 1)
+                {
+                    std::string& ss = results.Get();
+                    ss = key_str;
+                    match_count++;
+                    if (limit_count > 0 && match_count >= limit_count)
+                    {
+                        break;
+                    }
+                }
+                pos++;
+                offset = lp.Next(lp.Next(offset));
+            }
+            return pos == size ? 0 : pos;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         int pos = cursor >= hash->size() ? hash->size() : cursor;
         StringHashTable::iterator it = hash->begin();
         it.increment_by(pos);
@@ -377,14 +673,20 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
-        StringMapAllocator allocator = m_segment.MSpaceAllocator<StringPair>();
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, true, err)(allocator);
-        if (NULL == hash || 0 != err)
+        Object* value = GetHashValue(db, key, true, 1, std::max(field.Len(), val.Len()), err);
+        if (NULL == value || 0 != err)
         {
             return err;
         }
+        if (value->IsCompact())
+        {
+            int ret = CompactHSet(*value, field, val, nx);
+            ConvertHashIfOversized(*value);
+            return ret;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         Object tmpk(field, true);
         Object tmpv(val, true);
         std::pair<StringHashTable::iterator, bool> ret = hash->insert(StringHashTable::value_type(tmpk, tmpv));
@@ -406,16 +708,23 @@ namespace mmkv
     int MMKVImpl::HStrlen(DBID db, const Data& key, const Data& field)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, false, err)();
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetHashValue(db, key, false, 0, 0, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
         }
-        if (NULL == hash || 0 != err)
+        if (NULL == value || 0 != err)
         {
             return err;
         }
+        if (value->IsCompact())
+        {
+            ListPack lp = GetListPack(*value);
+            size_t pos = lp.Find(field, 2);
+            return pos != lp.End() ? lp.Get(lp.Next(pos)).Len() : 0;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         StringHashTable::iterator found = hash->find(Object(field, true));
         if (found != hash->end())
         {
@@ -426,8 +735,8 @@ namespace mmkv
     int MMKVImpl::HVals(DBID db, const Data& key, const StringArrayResult& vals)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringHashTable* hash = GetObject<StringHashTable>(db, key, V_TYPE_HASH, false, err)();
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetHashValue(db, key, false, 0, 0, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
@@ -436,6 +745,17 @@ namespace mmkv
         {
             return err;
         }
+        if (value->IsCompact())
+        {
+            ListPack lp = GetListPack(*value);
+            for (size_t pos = lp.Next(lp.Begin()); pos < lp.End(); pos = lp.Next(lp.Next(pos)))
+            {
+                Data v = lp.Get(pos);
+                vals.Get().assign(v.Value(), v.Len());
+            }
+            return 0;
+        }
+        StringHashTable* hash = (StringHashTable*) value->RawValue();
         StringHashTable::iterator it = hash->begin();
         while (it != hash->end())
         {
@@ -445,4 +765,3 @@ namespace mmkv
         return 0;
     }
 }
-
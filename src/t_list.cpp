@@ -30,11 +30,17 @@
 #include "mmkv_impl.hpp"
 namespace mmkv
 {
+    StringList* MMKVImpl::GetListValue(DBID db, const Data& key, bool create_if_notexist, int& err)
+    {
+        ObjectAllocator alloc = m_segment.MSpaceAllocator<Object>();
+        return GetObject<StringList>(db, key, V_TYPE_LIST, create_if_notexist, err)(alloc,
+                m_options.list_max_node_bytes, m_options.list_compress_depth);
+    }
     int MMKVImpl::LIndex(DBID db, const Data& key, int index, std::string& val)
     {
         val.clear();
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         StringList* list = GetObject<StringList>(db, key, V_TYPE_LIST, false, err)();
         if (NULL == list || 0 != err)
         {
@@ -48,8 +54,7 @@ namespace mmkv
         {
             return ERR_OFFSET_OUTRANGE;
         }
-        Object& ptr = list->at(index);
-        ptr.ToString(val);
+        list->get(index, val);
         return 0;
     }
     int MMKVImpl::LInsert(DBID db, const Data& key, bool before_ot_after, const Data& pivot, const Data& val)
@@ -59,7 +64,7 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         StringList* list = GetObject<StringList>(db, key, V_TYPE_LIST, false, err)();
         if (NULL == list)
@@ -70,31 +75,18 @@ namespace mmkv
             }
             return err;
         }
-        bool found = false;
-        Object pivot_str(pivot, true);
-        StringList::iterator it = list->begin();
-        while (it != list->end())
+        int64_t index = list->find(pivot);
+        if (index < 0)
         {
-            const Object& data = *it;
-            if (data == pivot_str)
-            {
-                found = true;
-                if (!before_ot_after)
-                {
-                    it++;
-                }
-                Object& inserted = *(list->insert(it, Object()));
-                m_segment.AssignObjectValue(inserted, val, true);
-                break;
-            }
-            it++;
+            return -1;
         }
-        return found ? (int) list->size() : -1;
+        list->insert(before_ot_after ? index : index + 1, val);
+        return list->size();
     }
     int MMKVImpl::LLen(DBID db, const Data& key)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         StringList* list = GetObject<StringList>(db, key, V_TYPE_LIST, false, err)();
         if (NULL != list)
         {
@@ -110,21 +102,17 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         StringList* list = GetObject<StringList>(db, key, V_TYPE_LIST, false, err)();
         if (0 != err)
         {
             return err;
         }
-        if (list->empty())
+        if (!list->pop_front(val))
         {
             return ERR_ENTRY_NOT_EXIST;
         }
-        Object& str = list->front();
-        str.ToString(val);
-        DestroyObjectContent(str);
-        list->pop_front();
         if (list->empty())
         {
             GenericDel(GetMMKVTable(db, false), db, Object(key, false));
@@ -140,10 +128,9 @@ namespace mmkv
         }
         int err = 0;
 
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
-        ObjectAllocator alloc = m_segment.MSpaceAllocator<Object>();
-        StringList* list = GetObject<StringList>(db, key, V_TYPE_LIST, nx ? false : true, err)(alloc);
+        StringList* list = GetListValue(db, key, nx ? false : true, err);
         if (0 != err)
         {
             if (nx && IS_NOT_EXISTS(err))
@@ -154,15 +141,14 @@ namespace mmkv
         }
         for (size_t i = 0; i < vals.size(); i++)
         {
-            list->push_front(Object());
-            m_segment.AssignObjectValue(list->at(0), vals[i], true);
+            list->push_front(vals[i]);
         }
         return list->size();
     }
     int MMKVImpl::LRange(DBID db, const Data& key, int start, int end, const StringArrayResult& vals)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         StringList* list = GetObject<StringList>(db, key, V_TYPE_LIST, false, err)();
         if (NULL == list || list->empty())
         {
@@ -183,9 +169,12 @@ namespace mmkv
         {
             return ERR_OFFSET_OUTRANGE;
         }
-        for (int i = start; i <= end && (size_t) i < list->size(); i++)
+        //walk the packed nodes sequentially instead of indexing every entry
+        StringList::Iterator it = list->begin(start);
+        for (int i = start; i <= end && it.Valid(); i++, it.Next())
         {
-            list->at(i).ToString(vals.Get());
+            Data v = it.Value();
+            vals.Get().assign(v.Value(), v.Len());
         }
         return 0;
     }
@@ -196,57 +185,18 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         StringList* list = GetObject<StringList>(db, key, V_TYPE_LIST, false, err)();
         if (NULL == list)
         {
             return err;
         }
-        Object val_obj(val, true);
-        int actual_removed = 0;
-        if(count == 0)
+        if (count == 0)
         {
             count = list->size();
         }
-        if (count >= 0)
-        {
-            StringList::iterator it = list->begin();
-            while (it != list->end() && count > 0)
-            {
-                const Object& data = *it;
-                if (data == val_obj)
-                {
-                    DestroyObjectContent(data);
-                    it = list->erase(it);
-                    count--;
-                    actual_removed++;
-                }
-                else
-                {
-                    it++;
-                }
-            }
-        }
-        else
-        {
-            StringList::reverse_iterator it = list->rbegin();
-            while (it != list->rend() && count < 0)
-            {
-                const Object& data = *it;
-                if (data == val_obj)
-                {
-                    DestroyObjectContent(data);
-                    it = StringList::reverse_iterator(list->erase(--it.base()));
-                    count++;
-                    actual_removed++;
-                }
-                else
-                {
-                    it++;
-                }
-            }
-        }
+        int actual_removed = list->remove(val, std::abs(count), count < 0);
         if (list->empty())
         {
             GenericDel(GetMMKVTable(db, false), db, Object(key, false));
@@ -260,7 +210,7 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         //EnsureWritableValueSpace();
         StringList* list = GetObject<StringList>(db, key, V_TYPE_LIST, false, err)();
         if (NULL == list || 0 != err)
@@ -275,9 +225,7 @@ namespace mmkv
         {
             return ERR_OFFSET_OUTRANGE;
         }
-        Object& data = list->at(index);
-        DestroyObjectContent(data);
-        m_segment.AssignObjectValue(data, val, true);
+        list->set(index, val);
         return 0;
     }
     int MMKVImpl::LTrim(DBID db, const Data& key, int start, int end)
@@ -287,7 +235,7 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         StringList* list = GetObject<StringList>(db, key, V_TYPE_LIST, false, err)();
         if (0 != err)
@@ -313,27 +261,13 @@ namespace mmkv
         {
             /* Out of range start or start > end result in empty list */
             GenericDel(GetMMKVTable(db, false), db, Object(key, true));
+            return 0;
         }
-        else
-        {
-            if (end >= llen)
-                end = llen - 1;
-        }
-        int front_pop_count = 0, back_pop_count = 0;
-        while (front_pop_count < start && !list->empty())
-        {
-            Object& data = list->front();
-            DestroyObjectContent(data);
-            list->pop_front();
-            front_pop_count++;
-        }
-        while (back_pop_count < (llen - 1 - end) && !list->empty())
-        {
-            Object& data = list->back();
-            DestroyObjectContent(data);
-            list->pop_back();
-            back_pop_count++;
-        }
+        if (end >= llen)
+            end = llen - 1;
+        //whole nodes out of range are dropped without touching their entries
+        list->erase_front(start);
+        list->erase_back(llen - 1 - end);
         if (list->empty())
         {
             GenericDel(GetMMKVTable(db, false), db, Object(key, false));
@@ -349,21 +283,17 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         StringList* list = GetObject<StringList>(db, key, V_TYPE_LIST, false, err)();
         if (0 != err)
         {
             return err;
         }
-        if (list->empty())
+        if (!list->pop_back(val))
         {
             return ERR_ENTRY_NOT_EXIST;
         }
-        Object& data = list->back();
-        data.ToString(val);
-        DestroyObjectContent(data);
-        list->pop_back();
         if (list->empty())
         {
             GenericDel(GetMMKVTable(db, false), db, Object(key, false));
@@ -379,28 +309,23 @@ namespace mmkv
         }
 
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
-        ObjectAllocator alloc = m_segment.MSpaceAllocator<Object>();
         StringList* src_list = GetObject<StringList>(db, source, V_TYPE_LIST, false, err)();
         if (0 != err)
         {
             return err;
         }
-        StringList* dst_list = GetObject<StringList>(db, destination, V_TYPE_LIST, true, err)(alloc);
+        StringList* dst_list = GetListValue(db, destination, true, err);
         if (0 != err)
         {
             return err;
         }
-        if (src_list->empty())
+        if (!src_list->pop_back(pop_value))
         {
             return ERR_ENTRY_NOT_EXIST;
         }
-
-        Object& data = src_list->back();
-        data.ToString(pop_value);
-        dst_list->push_front(data);
-        src_list->pop_back();
+        dst_list->push_front(pop_value);
         if (src_list->empty())
         {
             GenericDel(GetMMKVTable(db, false), db, Object(source, false));
@@ -415,10 +340,9 @@ namespace mmkv
         }
 
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
-        ObjectAllocator alloc = m_segment.MSpaceAllocator<Object>();
-        StringList* list = GetObject<StringList>(db, key, V_TYPE_LIST, nx ? false : true, err)(alloc);
+        StringList* list = GetListValue(db, key, nx ? false : true, err);
         if (0 != err)
         {
             if (nx && IS_NOT_EXISTS(err))
@@ -427,15 +351,10 @@ namespace mmkv
             }
             return err;
         }
-        size_t old_size = list->size();
-        list->resize(list->size() + vals.size());
         for (size_t i = 0; i < vals.size(); i++)
         {
-            Object& data = list->at(old_size + i);
-            data.Clear();
-            m_segment.AssignObjectValue(data, vals[i], true);
+            list->push_back(vals[i]);
         }
         return list->size();
     }
 }
-
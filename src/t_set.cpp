@@ -37,6 +37,331 @@
 #define OP_INTER 3
 namespace mmkv
 {
+    /*
+     * operand of set operations, a btree set or a packed set copied into 'StdObjectSet'
+     */
+    struct SetOperand
+    {
+            StringSet* set;
+            StdObjectSet* objs;
+            SetOperand(StringSet* s = NULL, StdObjectSet* o = NULL) :
+                    set(s), objs(o)
+            {
+            }
+            bool empty() const
+            {
+                return NULL != set ? set->empty() : objs->empty();
+            }
+    };
+
+    template<typename A, typename B>
+    static void set_operation(int op, A& a, B& b, StdObjectSet& result)
+    {
+        switch (op)
+        {
+            case OP_DIFF:
+            {
+                std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::inserter(result, result.end()),
+                        std::less<Object>());
+                break;
+            }
+            case OP_INTER:
+            {
+                std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::inserter(result, result.end()),
+                        std::less<Object>());
+                break;
+            }
+            case OP_UNION:
+            {
+                std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::inserter(result, result.end()),
+                        std::less<Object>());
+                break;
+            }
+        }
+    }
+
+    static void set_operation(int op, const SetOperand& a, const SetOperand& b, StdObjectSet& result)
+    {
+        if (NULL != a.set)
+        {
+            if (NULL != b.set)
+            {
+                set_operation(op, *a.set, *b.set, result);
+            }
+            else
+            {
+                set_operation(op, *a.set, *b.objs, result);
+            }
+        }
+        else
+        {
+            if (NULL != b.set)
+            {
+                set_operation(op, *a.objs, *b.set, result);
+            }
+            else
+            {
+                set_operation(op, *a.objs, *b.objs, result);
+            }
+        }
+    }
+
+    /*
+     * text length of an integer member
+     */
+    static size_t integer_len(int64_t v)
+    {
+        Object obj;
+        obj.SetInteger(v);
+        return obj.len;
+    }
+
+    void MMKVImpl::CreateSetValue(Object& value, size_t entries, size_t max_len, bool integers)
+    {
+        if (integers && m_options.set_max_intset_entries > 0 && entries <= m_options.set_max_intset_entries)
+        {
+            CreatePackedValue(value, OBJ_ENCODING_INTSET);
+        }
+        else if (m_options.set_max_compact_entries > 0 && entries <= m_options.set_max_compact_entries
+                && max_len <= m_options.set_max_compact_value)
+        {
+            CreatePackedValue(value, OBJ_ENCODING_COMPACT);
+        }
+        else
+        {
+            ObjectAllocator allocator = m_segment.MSpaceAllocator<Object>();
+            m_segment.ObjectMakeRoom(value, sizeof(StringSet));
+            ::new (value.WritableData()) StringSet(std::less<Object>(), allocator);
+        }
+    }
+    Object* MMKVImpl::GetSetValue(DBID db, const Data& key, bool create_if_notexist, size_t new_entries,
+            size_t max_len, bool integers, int& err)
+    {
+        bool created = false;
+        Object* value = GetValueObject(db, key, V_TYPE_SET, create_if_notexist, err, &created);
+        if (NULL == value)
+        {
+            return NULL;
+        }
+        if (created)
+        {
+            CreateSetValue(*value, new_entries, max_len, integers);
+            return value;
+        }
+        if (value->IsIntSet())
+        {
+            if (!integers)
+            {
+                ConvertIntSet(*value, new_entries, max_len);
+            }
+            else if (GetIntSet(*value).Count() + new_entries > m_options.set_max_intset_entries)
+            {
+                ConvertPackedSet(*value);
+            }
+        }
+        else if (value->IsCompact()
+                && (max_len > m_options.set_max_compact_value
+                        || GetListPack(*value).Count() + new_entries > m_options.set_max_compact_entries))
+        {
+            ConvertPackedSet(*value);
+        }
+        return value;
+    }
+    StringSet* MMKVImpl::ConvertPackedSet(Object& value)
+    {
+        void* buf = m_segment.Allocate(sizeof(StringSet));
+        ObjectAllocator allocator = m_segment.MSpaceAllocator<Object>();
+        StringSet* set = ::new (buf) StringSet(std::less<Object>(), allocator);
+        PackedSetReader reader(value);
+        while (reader.Valid())
+        {
+            Object member = reader.Member();
+            std::pair<StringSet::iterator, bool> ret = set->insert(member);
+            //integer members are kept as they are, text members are copied out of the packed buffer
+            m_segment.AssignObjectValue(*(ret.first), Data(member.RawValue(), member.len), true);
+            reader.Next();
+        }
+        m_segment.Deallocate(value.WritableData());
+        value.SetValue(buf);
+        value.len = sizeof(StringSet);
+        return set;
+    }
+    void MMKVImpl::ConvertIntSet(Object& value, size_t new_entries, size_t max_len)
+    {
+        IntSet ints = GetIntSet(value);
+        size_t count = ints.Count();
+        if (count > 0)
+        {
+            max_len = std::max(max_len, std::max(integer_len(ints.Get(0)), integer_len(ints.Get(count - 1))));
+        }
+        if (m_options.set_max_compact_entries == 0 || count + new_entries > m_options.set_max_compact_entries
+                || max_len > m_options.set_max_compact_value)
+        {
+            ConvertPackedSet(value);
+            return;
+        }
+        //integers are less than text members, so the numeric order is kept in list pack
+        size_t bytes = ListPack::EmptyBytes();
+        for (size_t i = 0; i < count; i++)
+        {
+            bytes += ListPack::EntryBytes(Data(ints.Get(i)));
+        }
+        Object packed;
+        CreatePackedValue(packed, OBJ_ENCODING_COMPACT);
+        CompactMakeRoom(packed, bytes);
+        ListPack lp = GetListPack(packed);
+        for (size_t i = 0; i < count; i++)
+        {
+            lp.Insert(lp.End(), Data(ints.Get(i)));
+        }
+        m_segment.Deallocate(value.WritableData());
+        value.SetValue(packed.RawValue());
+        value.encoding = OBJ_ENCODING_COMPACT;
+        value.len = packed.len;
+    }
+    int MMKVImpl::SetAddMember(Object& value, const Data& member)
+    {
+        if (value.IsIntSet())
+        {
+            Object obj(member, true);
+            if (obj.IsInteger())
+            {
+                size_t idx = 0;
+                if (GetIntSet(value).Find(obj.IntegerValue(), idx))
+                {
+                    return 0;
+                }
+                CompactMakeRoom(value, GetIntSet(value).BytesAfterInsert(obj.IntegerValue()));
+                GetIntSet(value).Insert(idx, obj.IntegerValue());
+                return 1;
+            }
+            ConvertIntSet(value, 1, member.Len());
+        }
+        if (value.IsCompact())
+        {
+            ListPack lp = GetListPack(value);
+            bool found = false;
+            size_t pos = lp.LowerBound(Object(member, true), found);
+            if (found)
+            {
+                return 0;
+            }
+            CompactMakeRoom(value, lp.Bytes() + ListPack::EntryBytes(member));
+            GetListPack(value).Insert(pos, member);
+            return 1;
+        }
+        StringSet* set = (StringSet*) value.RawValue();
+        std::pair<StringSet::iterator, bool> ret = set->insert(Object(member, true));
+        if (ret.second)
+        {
+            m_segment.AssignObjectValue(*(ret.first), member, true);
+            return 1;
+        }
+        return 0;
+    }
+    int MMKVImpl::SetRemoveMember(Object& value, const Data& member)
+    {
+        if (value.IsIntSet())
+        {
+            Object obj(member, true);
+            IntSet ints = GetIntSet(value);
+            size_t idx = 0;
+            if (obj.IsInteger() && ints.Find(obj.IntegerValue(), idx))
+            {
+                ints.Erase(idx);
+                return 1;
+            }
+            return 0;
+        }
+        if (value.IsCompact())
+        {
+            ListPack lp = GetListPack(value);
+            size_t pos = lp.Find(member);
+            if (pos != lp.End())
+            {
+                lp.Erase(pos, 1);
+                return 1;
+            }
+            return 0;
+        }
+        StringSet* set = (StringSet*) value.RawValue();
+        StringSet::iterator found = set->find(Object(member, true));
+        if (found != set->end())
+        {
+            Object cc = *found;
+            set->erase(found);
+            DestroyObjectContent(cc);
+            return 1;
+        }
+        return 0;
+    }
+    bool MMKVImpl::SetIsMember(const Object& value, const Data& member)
+    {
+        if (value.IsIntSet())
+        {
+            Object obj(member, true);
+            size_t idx = 0;
+            return obj.IsInteger() && GetIntSet(value).Find(obj.IntegerValue(), idx);
+        }
+        if (value.IsCompact())
+        {
+            ListPack lp = GetListPack(value);
+            return lp.Find(member) != lp.End();
+        }
+        StringSet* set = (StringSet*) value.RawValue();
+        return set->find(Object(member, true)) != set->end();
+    }
+    size_t MMKVImpl::SetSize(const Object& value)
+    {
+        if (value.IsIntSet())
+        {
+            return GetIntSet(value).Count();
+        }
+        if (value.IsCompact())
+        {
+            return GetListPack(value).Count();
+        }
+        StringSet* set = (StringSet*) value.RawValue();
+        return set->size();
+    }
+    void MMKVImpl::ConvertSetIfOversized(Object& value)
+    {
+        if ((value.IsIntSet() && GetIntSet(value).Count() > m_options.set_max_intset_entries)
+                || (value.IsCompact() && GetListPack(value).Count() > m_options.set_max_compact_entries))
+        {
+            ConvertPackedSet(value);
+        }
+    }
+    int MMKVImpl::StoreSetMembers(DBID db, const Data& dest, const StringArray& members, bool integers)
+    {
+        int err = 0;
+        bool created = false;
+        size_t max_len = 0;
+        for (size_t i = 0; i < members.size(); i++)
+        {
+            max_len = std::max(max_len, members[i].size());
+        }
+        Object* destvalue = GetValueObject(db, dest, V_TYPE_SET, true, err, &created);
+        if (NULL == destvalue)
+        {
+            return err;
+        }
+        if (!created)
+        {
+            bool hasttl = destvalue->hasttl;
+            GenericDelValue(*destvalue);
+            destvalue->Clear();
+            destvalue->type = V_TYPE_SET;
+            destvalue->hasttl = hasttl;
+        }
+        CreateSetValue(*destvalue, members.size(), max_len, integers);
+        for (size_t i = 0; i < members.size(); i++)
+        {
+            SetAddMember(*destvalue, members[i]);
+        }
+        return SetSize(*destvalue);
+    }
+
     int MMKVImpl::SAdd(DBID db, const Data& key, const DataArray& elements)
     {
         if (m_readonly)
@@ -45,10 +370,16 @@ namespace mmkv
         }
         int err = 0;
 
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
-        ObjectAllocator allocator = m_segment.MSpaceAllocator<Object>();
-        StringSet* set = GetObject<StringSet>(db, key, V_TYPE_SET, true, err)(std::less<Object>(), allocator);
+        size_t max_len = 0;
+        bool integers = true;
+        for (size_t i = 0; i < elements.size(); i++)
+        {
+            max_len = std::max(max_len, elements[i].Len());
+            integers = integers && Object(elements[i], true).IsInteger();
+        }
+        Object* value = GetSetValue(db, key, true, elements.size(), max_len, integers, err);
         if (0 != err)
         {
             return err;
@@ -56,20 +387,16 @@ namespace mmkv
         int inserted = 0;
         for (size_t i = 0; i < elements.size(); i++)
         {
-            std::pair<StringSet::iterator, bool> ret = set->insert(Object(elements[i], true));
-            if (ret.second)
-            {
-                m_segment.AssignObjectValue(*(ret.first), elements[i], true);
-                inserted++;
-            }
+            inserted += SetAddMember(*value, elements[i]);
         }
+        ConvertSetIfOversized(*value);
         return inserted;
     }
     int MMKVImpl::SCard(DBID db, const Data& key)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringSet* set = GetObject<StringSet>(db, key, V_TYPE_SET, false, err)();
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetSetValue(db, key, false, 0, 0, true, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
@@ -78,72 +405,159 @@ namespace mmkv
         {
             return err;
         }
-        return set->size();
+        return SetSize(*value);
     }
 
-    int MMKVImpl::GenericSInterDiffUnion(DBID db, int op, const DataArray& keys, const Data* dest,
+    template<typename T>
+    static void integer_set_operation(int op, const T& a, const T& b, T& result)
+    {
+        switch (op)
+        {
+            case OP_DIFF:
+            {
+                std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+                break;
+            }
+            case OP_INTER:
+            {
+                std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+                break;
+            }
+            case OP_UNION:
+            {
+                std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+                break;
+            }
+        }
+    }
+
+    /*
+     * all operands are integer sets(or not exist), merge the sorted integer arrays directly
+     */
+    int MMKVImpl::GenericIntSetInterDiffUnion(DBID db, int op, const DataArray& keys, const Data* dest,
             const StringArrayResult* res)
     {
-        StdObjectSet results[2];
-        int result_index = 0;
-        StringSetArray sets;
+        typedef std::vector<int64_t> IntegerArray;
+        std::vector<IntegerArray> sets;
         sets.resize(keys.size());
         int err = 0;
-        size_t start_index = 0;
-        StringSet* destset = NULL;
-        StdObjectSet* result = NULL;
-        StdObjectSet* cmp = NULL;
-        int current_result_index = 0;
-        ObjectAllocator allocator = m_segment.MSpaceAllocator<Object>();
-        StringSet empty_set(std::less<Object>(), allocator);
-
         for (size_t i = 0; i < keys.size(); i++)
         {
-            StringSet* set = GetObject<StringSet>(db, keys[i], V_TYPE_SET, false, err)();
+            Object* value = GetSetValue(db, keys[i], false, 0, 0, true, err);
             if (IS_NOT_EXISTS(err))
             {
-                sets[i] = &empty_set;
                 continue;
             }
             if (0 != err)
             {
                 return err;
             }
-            sets[i] = set;
+            IntSet ints = GetIntSet(*value);
+            sets[i].resize(ints.Count());
+            for (size_t j = 0; j < ints.Count(); j++)
+            {
+                sets[i][j] = ints.Get(j);
+            }
         }
-
-        if (NULL != dest)
+        IntegerArray result, tmp;
+        //same as generic operation, a single key gives empty result
+        for (size_t i = 1; i < keys.size(); i++)
         {
-            ObjectAllocator allocator = m_segment.MSpaceAllocator<Object>();
-            destset = GetObject<StringSet>(db, *dest, V_TYPE_SET, true, err)(std::less<Object>(), allocator);
-            if (0 != err)
+            if (sets[i].empty() && op == OP_INTER)
             {
-                return err;
+                result.clear();
+                break;
+            }
+            tmp.clear();
+            integer_set_operation(op, i == 1 ? sets[0] : result, sets[i], tmp);
+            result.swap(tmp);
+            if (op != OP_UNION && result.empty())
+            {
+                break;
             }
         }
-
-        if (NULL == sets[0])
+        if (NULL != res)
         {
-            if (op == OP_DIFF || op == OP_INTER)
+            for (size_t i = 0; i < result.size(); i++)
             {
-                result_index = 0;
-                goto _end;
+                Object obj;
+                obj.SetInteger(result[i]);
+                obj.ToString(res->Get());
             }
         }
+        if (NULL != dest)
+        {
+            StringArray members;
+            members.resize(result.size());
+            for (size_t i = 0; i < result.size(); i++)
+            {
+                Object obj;
+                obj.SetInteger(result[i]);
+                obj.ToString(members[i]);
+            }
+            return StoreSetMembers(db, *dest, members, true);
+        }
+        return 0;
+    }
 
+    int MMKVImpl::GenericSInterDiffUnion(DBID db, int op, const DataArray& keys, const Data* dest,
+            const StringArrayResult* res)
+    {
+        StdObjectSet results[2];
+        int result_index = 0;
+        std::vector<SetOperand> sets;
+        sets.resize(keys.size());
+        std::vector<StdObjectSet> packed_sets;
+        packed_sets.resize(keys.size());
+        StdObjectSet empty_set;
+        int err = 0;
+        StdObjectSet* result = NULL;
+        StdObjectSet* cmp = NULL;
+        int current_result_index = 0;
+        bool all_intsets = true;
+
+        for (size_t i = 0; i < keys.size() && all_intsets; i++)
+        {
+            Object* value = GetSetValue(db, keys[i], false, 0, 0, true, err);
+            all_intsets = NULL == value || value->IsIntSet();
+        }
+        if (all_intsets)
+        {
+            return GenericIntSetInterDiffUnion(db, op, keys, dest, res);
+        }
         for (size_t i = 0; i < keys.size(); i++)
         {
-            if (sets[i] != NULL)
+            Object* value = GetSetValue(db, keys[i], false, 0, 0, true, err);
+            if (IS_NOT_EXISTS(err))
             {
-                start_index = i;
-                break;
+                sets[i] = SetOperand(NULL, &empty_set);
+                continue;
+            }
+            if (0 != err)
+            {
+                return err;
+            }
+            if (value->IsPacked())
+            {
+                //packed members are already sorted
+                PackedSetReader reader(*value);
+                while (reader.Valid())
+                {
+                    packed_sets[i].insert(packed_sets[i].end(), reader.Member());
+                    reader.Next();
+                }
+                sets[i] = SetOperand(NULL, &packed_sets[i]);
+            }
+            else
+            {
+                sets[i] = SetOperand((StringSet*) value->RawValue(), NULL);
             }
         }
 
-        for (size_t i = start_index + 1; i < keys.size(); i++)
+        for (size_t i = 1; i < keys.size(); i++)
         {
             result = results + current_result_index;
-            if (sets[i]->empty())
+            if (sets[i].empty())
             {
                 if (op == OP_INTER)
                 {
@@ -153,61 +567,11 @@ namespace mmkv
                 }
             }
             result->clear();
-            switch (op)
+            set_operation(op, NULL == cmp ? sets[0] : SetOperand(NULL, cmp), sets[i], *result);
+            if (op != OP_UNION && result->empty())
             {
-                case OP_DIFF:
-                {
-                    if (cmp == NULL)
-                    {
-                        std::set_difference(sets[start_index]->begin(), sets[start_index]->end(), sets[i]->begin(),
-                                sets[i]->end(), std::inserter(*result, result->end()), std::less<Object>());
-                    }
-                    else
-                    {
-                        std::set_difference(cmp->begin(), cmp->end(), sets[i]->begin(), sets[i]->end(),
-                                std::inserter(*result, result->end()), std::less<Object>());
-                    }
-                    if (result->empty())
-                    {
-                        result_index = current_result_index;
-                        goto _end;
-                    }
-                    break;
-                }
-                case OP_INTER:
-                {
-                    if (cmp == NULL)
-                    {
-                        std::set_intersection(sets[start_index]->begin(), sets[start_index]->end(), sets[i]->begin(),
-                                sets[i]->end(), std::inserter(*result, result->end()), std::less<Object>());
-                    }
-                    else
-                    {
-                        std::set_intersection(cmp->begin(), cmp->end(), sets[i]->begin(), sets[i]->end(),
-                                std::inserter(*result, result->end()), std::less<Object>());
-                    }
-
-                    if (result->empty())
-                    {
-                        result_index = current_result_index;
-                        goto _end;
-                    }
-                    break;
-                }
-                case OP_UNION:
-                {
-                    if (cmp == NULL)
-                    {
-                        std::set_union(sets[start_index]->begin(), sets[start_index]->end(), sets[i]->begin(),
-                                sets[i]->end(), std::inserter(*result, result->end()), std::less<Object>());
-                    }
-                    else
-                    {
-                        std::set_union(cmp->begin(), cmp->end(), sets[i]->begin(), sets[i]->end(),
-                                std::inserter(*result, result->end()), std::less<Object>());
-                    }
-                    break;
-                }
+                result_index = current_result_index;
+                goto _end;
             }
             current_result_index = 1 - current_result_index;
             cmp = result;
@@ -222,35 +586,20 @@ namespace mmkv
                 it++;
             }
         }
-        if (NULL != destset)
+        if (NULL != dest)
         {
-            //remove elements not in dest set
-            StringSet::iterator it = destset->begin();
-            while (it != destset->end())
-            {
-                Object element = *it;
-                StdObjectSet::iterator cit = results[result_index].find(element);
-                if (cit != results[result_index].end()) //remove elements from results which already in dest set
-                {
-                    results[result_index].erase(cit);
-                    it++;
-                }
-                else
-                {
-                    it = destset->erase(it);
-                    DestroyObjectContent(element);
-                }
-            }
-
-            //insert rest elements
-            StdObjectSet::iterator cit = results[result_index].begin();
-            while (cit != results[result_index].end())
+            //copy results out first, they may refer to the packed members of dest itself
+            StringArray members;
+            bool integers = true;
+            StdObjectSet::iterator it = results[result_index].begin();
+            while (it != results[result_index].end())
             {
-                Object clone = CloneStrObject(*cit);
-                destset->insert(clone);
-                cit++;
+                members.push_back(std::string());
+                it->ToString(members.back());
+                integers = integers && it->IsInteger();
+                it++;
             }
-            return destset->size();
+            return StoreSetMembers(db, *dest, members, integers);
         }
         return 0;
     }
@@ -261,7 +610,7 @@ namespace mmkv
         {
             return ERR_INVALID_TYPE;
         }
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         return GenericSInterDiffUnion(db, OP_DIFF, keys, NULL, &diffs);
     }
     int MMKVImpl::SDiffStore(DBID db, const Data& destination, const DataArray& keys)
@@ -274,7 +623,7 @@ namespace mmkv
     }
     int MMKVImpl::SInter(DBID db, const DataArray& keys, const StringArrayResult& inters)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         return GenericSInterDiffUnion(db, OP_INTER, keys, NULL, &inters);
     }
     int MMKVImpl::SInterStore(DBID db, const Data& destination, const DataArray& keys)
@@ -283,34 +632,45 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         return GenericSInterDiffUnion(db, OP_INTER, keys, &destination, NULL);
     }
     int MMKVImpl::SIsMember(DBID db, const Data& key, const Data& member)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringSet* set = GetObject<StringSet>(db, key, V_TYPE_SET, false, err)();
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetSetValue(db, key, false, 0, 0, true, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
         }
-        if (NULL == set || 0 != err)
+        if (NULL == value || 0 != err)
         {
             return err;
         }
-        return set->find(Object(member, true)) != set->end();
+        return SetIsMember(*value, member);
     }
     int MMKVImpl::SMembers(DBID db, const Data& key, const StringArrayResult& members)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringSet* set = GetObject<StringSet>(db, key, V_TYPE_SET, false, err)();
-        if (NULL == set || 0 != err)
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetSetValue(db, key, false, 0, 0, true, err);
+        if (NULL == value || 0 != err)
         {
             return err;
         }
+        if (value->IsPacked())
+        {
+            PackedSetReader reader(*value);
+            while (reader.Valid())
+            {
+                reader.Member().ToString(members.Get());
+                reader.Next();
+            }
+            return 0;
+        }
+        StringSet* set = (StringSet*) value->RawValue();
         StringSet::iterator it = set->begin();
         while (it != set->end())
         {
@@ -326,39 +686,33 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
-        StringSet* set1 = GetObject<StringSet>(db, source, V_TYPE_SET, false, err)();
-        if (NULL == set1 || 0 != err)
+        Object* src = GetSetValue(db, source, false, 0, 0, true, err);
+        if (NULL == src || 0 != err)
         {
             return err;
         }
-        ObjectAllocator allocator = m_segment.MSpaceAllocator<Object>();
-        StringSet* set2 = GetObject<StringSet>(db, destination, V_TYPE_SET, true, err)(std::less<Object>(), allocator);
-        if (NULL == set2 || 0 != err)
+        bool found = SetIsMember(*src, member);
+        if (source == destination || !found)
         {
-            return err;
+            return found ? 1 : 0;
         }
-        StringSet::iterator found = set1->find(Object(member, true));
-        if (set1 == set2)
+        Object* dst = GetSetValue(db, destination, true, 1, member.Len(), Object(member, true).IsInteger(), err);
+        if (NULL == dst || 0 != err)
         {
-            return found != set1->end() ? 1 : 0;
+            return err;
         }
-        if (found != set1->end())
+        SetAddMember(*dst, member);
+        ConvertSetIfOversized(*dst);
+        //creating destination may move entries of the key table, look source up again
+        src = GetSetValue(db, source, false, 0, 0, true, err);
+        SetRemoveMember(*src, member);
+        if (SetSize(*src) == 0)
         {
-            Object val = *found;
-            set1->erase(found);
-            if (!set2->insert(val).second)
-            {
-                DestroyObjectContent(val);
-            }
-            if (set1->empty())
-            {
-                GenericDel(GetMMKVTable(db, false),db, Object(source, false));
-            }
-            return 1;
+            GenericDel(GetMMKVTable(db, false), db, Object(source, false));
         }
-        return 0;
+        return 1;
     }
     int MMKVImpl::SPop(DBID db, const Data& key, const StringArrayResult& members, int count)
     {
@@ -371,9 +725,9 @@ namespace mmkv
             return ERR_OFFSET_OUTRANGE;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
-        StringSet* set = GetObject<StringSet>(db, key, V_TYPE_SET, false, err)();
+        Object* value = GetSetValue(db, key, false, 0, 0, true, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
@@ -382,6 +736,21 @@ namespace mmkv
         {
             return err;
         }
+        if (value->IsPacked())
+        {
+            for (int i = 0; i < count && SetSize(*value) > 0; i++)
+            {
+                std::string& member = members.Get();
+                PackedSetReader(*value).Member().ToString(member);
+                SetRemoveMember(*value, member);
+            }
+            if (SetSize(*value) == 0)
+            {
+                GenericDel(GetMMKVTable(db, false), db, Object(key, false));
+            }
+            return 0;
+        }
+        StringSet* set = (StringSet*) value->RawValue();
         if (set->empty())
         {
             return 0;
@@ -403,8 +772,8 @@ namespace mmkv
     int MMKVImpl::SRandMember(DBID db, const Data& key, const StringArrayResult& members, int count)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringSet* set = GetObject<StringSet>(db, key, V_TYPE_SET, false, err)();
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetSetValue(db, key, false, 0, 0, true, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
@@ -413,14 +782,26 @@ namespace mmkv
         {
             return err;
         }
-        if (set->empty())
+        StringSet* set = value->IsPacked() ? NULL : (StringSet*) value->RawValue();
+        int size = SetSize(*value);
+        if (size == 0)
         {
             return 0;
         }
 
         //return whole set
-        if (count > 0 && count > set->size())
+        if (count > 0 && count > size)
         {
+            if (NULL == set)
+            {
+                PackedSetReader reader(*value);
+                while (reader.Valid())
+                {
+                    reader.Member().ToString(members.Get());
+                    reader.Next();
+                }
+                return 0;
+            }
             StringSet::iterator it = set->begin();
             while (it != set->end())
             {
@@ -437,20 +818,27 @@ namespace mmkv
             {
                 if (i == 0)
                 {
-                    rand = random_between_int32(0, set->size() - 1);
+                    rand = random_between_int32(0, size - 1);
                 }
                 else
                 {
                     rand += i;
-                    if (rand >= set->size())
+                    if (rand >= size)
                     {
-                        rand -= set->size();
+                        rand -= size;
                     }
                 }
             }
             else
             {
-                rand = random_between_int32(0, set->size() - 1);
+                rand = random_between_int32(0, size - 1);
+            }
+            if (NULL == set)
+            {
+                PackedSetReader reader(*value);
+                reader.Skip(rand);
+                reader.Member().ToString(members.Get());
+                continue;
             }
             StringSet::iterator it = set->begin();
             it.increment_by(rand);
@@ -465,32 +853,25 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
-        StringSet* set = GetObject<StringSet>(db, key, V_TYPE_SET, false, err)();
+        Object* value = GetSetValue(db, key, false, 0, 0, true, err);
         if (IS_NOT_EXISTS(err))
         {
             return 0;
         }
-        if (NULL == set || 0 != err)
+        if (NULL == value || 0 != err)
         {
             return err;
         }
         int removed = 0;
         for (size_t i = 0; i < members.size(); i++)
         {
-            StringSet::iterator found = set->find(Object(members[i], true));
-            if (found != set->end())
-            {
-                Object cc = *found;
-                set->erase(found);
-                DestroyObjectContent(cc);
-                removed++;
-            }
+            removed += SetRemoveMember(*value, members[i]);
         }
-        if (set->empty())
+        if (SetSize(*value) == 0)
         {
-            GenericDel(GetMMKVTable(db, false),db, Object(key, false));
+            GenericDel(GetMMKVTable(db, false), db, Object(key, false));
         }
         return removed;
     }
@@ -498,19 +879,48 @@ namespace mmkv
             const StringArrayResult& results)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
-        StringSet* set = GetObject<StringSet>(db, key, V_TYPE_SET, false, err)();
-        if (NULL == set || 0 != err)
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        Object* value = GetSetValue(db, key, false, 0, 0, true, err);
+        if (NULL == value || 0 != err)
         {
             return err;
         }
+        int match_count = 0;
+        if (value->IsPacked())
+        {
+            PackedSetReader reader(*value);
+            if (cursor >= (int64_t) reader.Count())
+            {
+                return 0;
+            }
+            reader.Skip(cursor);
+            while (reader.Valid())
+            {
+                std::string key_str;
+                reader.Member().ToString(key_str);
+                if (pattern == ""
+                        || stringmatchlen(pattern.c_str(), pattern.size(), key_str.c_str(), key_str.size(), 0) == 1)
+                {
+                    std::string& ss = results.Get();
+                    ss = key_str;
+                    match_count++;
+                    if (limit_count > 0 && match_count >= limit_count)
+                    {
+                        break;
+                    }
+                }
+                cursor++;
+                reader.Next();
+            }
+            return reader.Valid() ? cursor : 0;
+        }
+        StringSet* set = (StringSet*) value->RawValue();
         StringSet::iterator it = set->begin();
         if (cursor >= set->size())
         {
             return 0;
         }
         it.increment_by(cursor);
-        int match_count = 0;
         while (it != set->end())
         {
             std::string key_str;
@@ -533,7 +943,7 @@ namespace mmkv
     }
     int MMKVImpl::SUnion(DBID db, const DataArray& keys, const StringArrayResult& unions)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         return GenericSInterDiffUnion(db, OP_UNION, keys, NULL, &unions);;
     }
     int MMKVImpl::SUnionStore(DBID db, const Data& destination, const DataArray& keys)
@@ -542,7 +952,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         return GenericSInterDiffUnion(db, OP_UNION, keys, &destination, NULL);
     }
@@ -39,6 +39,7 @@ namespace mmkv
         Object tmpkey(key, false);
         std::pair<MMKVTable::iterator, bool> ret = table->insert(MMKVTable::value_type(tmpkey, Object()));
         Object& value_data = ret.first->second;
+        ChargeMemory(V_TYPE_STRING);
         if (ret.second)
         {
             m_segment.AssignObjectValue(value_data, create_base_value, false);
@@ -48,6 +49,7 @@ namespace mmkv
         else
         {
             created = false;
+            TouchValue(ret.first->second);
         }
         return value_data;
     }
@@ -83,12 +85,15 @@ namespace mmkv
             {
                 return ERR_INVALID_TYPE;
             }
+            TouchValue(ret.first->second);
             ClearTTL(db, kk, value_data);
             if(value_data == tmpv && ttl == 0)
             {
                 return 0;
             }
+            ChargeMemory(value_data.type);
             GenericDelValue(value_data);
+            ChargeMemory(V_TYPE_STRING);
         }
         else
         {
@@ -97,6 +102,7 @@ namespace mmkv
                 table->erase(ret.first);
                 return ERR_ENTRY_NOT_EXIST;
             }
+            ChargeMemory(V_TYPE_STRING);
             m_segment.AssignObjectValue(const_cast<Object&>(kk), key, false);
         }
         m_segment.AssignObjectValue(value_data, value, true);
@@ -114,7 +120,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, true);
         if (NULL == kv)
@@ -137,6 +143,7 @@ namespace mmkv
         {
             return ERR_INVALID_TYPE;
         }
+        TouchValue(found->second);
 //        if (IsExpired(db, key, value_data))
 //        {
 //            return 0;
@@ -145,9 +152,8 @@ namespace mmkv
         return 0;
     }
 
-    int MMKVImpl::Get(DBID db, const Data& key, std::string& value)
+    int MMKVImpl::GenericGet(DBID db, const Data& key, std::string& value)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -156,13 +162,20 @@ namespace mmkv
         return GenericGet(kv, db, key, value);
     }
 
+    int MMKVImpl::Get(DBID db, const Data& key, std::string& value)
+    {
+        OPTIMISTIC_READ(db, GenericGet(db, key, value));
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        return GenericGet(db, key, value);
+    }
+
     int MMKVImpl::Append(DBID db, const Data& key, const Data& value)
     {
         if (m_readonly)
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, true);
         if (NULL == kv)
@@ -201,7 +214,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, true);
         if (NULL == kv)
@@ -232,7 +245,7 @@ namespace mmkv
 
     int MMKVImpl::Strlen(DBID db, const Data& key)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL == kv)
         {
@@ -264,7 +277,7 @@ namespace mmkv
     {
         std::string vv;
         {
-            RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+            DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
             MMKVTable* kv = GetMMKVTable(db, false);
             if (NULL == kv)
             {
@@ -307,7 +320,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, true);
         if (NULL == kv)
@@ -318,6 +331,7 @@ namespace mmkv
         std::pair<MMKVTable::iterator, bool> ret = kv->insert(MMKVTable::value_type(tmpkey, Object()));
         const Object& kk = ret.first->first;
         Object& value_data = ret.first->second;
+        ChargeMemory(V_TYPE_STRING);
         if (!ret.second)
         {
             if (value_data.type != V_TYPE_STRING)
@@ -350,7 +364,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, true);
         if (NULL == kv)
@@ -361,6 +375,7 @@ namespace mmkv
         std::pair<MMKVTable::iterator, bool> ret = kv->insert(MMKVTable::value_type(tmpkey, Object()));
         const Object& kk = ret.first->first;
         Object& value_data = ret.first->second;
+        ChargeMemory(V_TYPE_STRING);
         if (!ret.second)
         {
             if (value_data.type != V_TYPE_STRING)
@@ -413,24 +428,52 @@ namespace mmkv
     }
     int MMKVImpl::MGet(DBID db, const DataArray& keys, const StringArrayResult& vals, BooleanArray* get_flags)
     {
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         MMKVTable* kv = GetMMKVTable(db, false);
         if (NULL != get_flags)
         {
             get_flags->resize(keys.size());
         }
-        for (size_t i = 0; i < keys.size(); i++)
+        if (NULL == kv)
         {
-            if (NULL == kv)
+            for (size_t i = 0; i < keys.size(); i++)
             {
                 vals.Get();
             }
-            else
+            return 0;
+        }
+        Object tmpkeys[kLookupBatchSize];
+        size_t hashcodes[kLookupBatchSize];
+        for (size_t i = 0; i < keys.size(); i += kLookupBatchSize)
+        {
+            size_t batch = keys.size() - i;
+            if (batch > kLookupBatchSize)
+            {
+                batch = kLookupBatchSize;
+            }
+            for (size_t j = 0; j < batch; j++)
+            {
+                tmpkeys[j] = Object(keys[i + j], false);
+                hashcodes[j] = kv->hash_code(tmpkeys[j]);
+                kv->prefetch(hashcodes[j]);
+            }
+            for (size_t j = 0; j < batch; j++)
             {
-                int err = GenericGet(kv, db, keys[i], vals.Get());
-                if (NULL != get_flags && 0 == err)
+                kv->prefetch_entry(hashcodes[j]);
+            }
+            for (size_t j = 0; j < batch; j++)
+            {
+                std::string& value = vals.Get();
+                MMKVTable::iterator found = kv->find(tmpkeys[j], hashcodes[j]);
+                if (found == kv->end() || found->second.type != V_TYPE_STRING)
+                {
+                    continue;
+                }
+                TouchValue(found->second);
+                found->second.ToString(value);
+                if (NULL != get_flags)
                 {
-                    (*get_flags)[i] = true;
+                    (*get_flags)[i + j] = true;
                 }
             }
         }
@@ -442,7 +485,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, true);
         if (NULL == kv)
@@ -461,7 +504,7 @@ namespace mmkv
         {
             return ERR_PERMISSION_DENIED;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, true);
         if (NULL == kv)
@@ -504,7 +547,7 @@ namespace mmkv
         {
             return ERR_OFFSET_OUTRANGE;
         }
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         MMKVTable* kv = GetMMKVTable(db, true);
         if (NULL == kv)
@@ -515,6 +558,7 @@ namespace mmkv
         std::pair<MMKVTable::iterator, bool> ret = kv->insert(MMKVTable::value_type(tmpkey, Object()));
         const Object& kk = ret.first->first;
         Object& value_data = ret.first->second;
+        ChargeMemory(V_TYPE_STRING);
         std::string strvalue;
         if (!ret.second)
         {
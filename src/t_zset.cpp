@@ -41,26 +41,95 @@
 #define AGGREGATE_MAX 3
 namespace mmkv
 {
-    void MMKVImpl::AssignScoreValue(ScoreValue& sv, long double score, const Data& value)
+    /*
+     * string object of a zset member for lookups in the member index, an integer 'Data' is formatted into 'buf'
+     */
+    static inline Object zset_member(const Data& member, char* buf, size_t buf_len)
     {
-        m_segment.AssignObjectValue(sv.value, value, true);
-        sv.score = score;
-        return;
+        if (NULL == member.Value())
+        {
+            return Object(Data(buf, ll2string(buf, buf_len, (int64_t) member.Len())), false);
+        }
+        return Object(member, false);
+    }
+    /*
+     * looks up the element of 'member' in the member index of 'zset'
+     */
+    static inline bool zset_find(ZSet& zset, const Data& member, ScoreValue& sv)
+    {
+        char tmp[32];
+        ZSetMemberTable::iterator found = zset.members.find(zset_member(member, tmp, sizeof(tmp)));
+        if (found == zset.members.end())
+        {
+            return false;
+        }
+        sv.value = *found;
+        return true;
+    }
+    void MMKVImpl::CreateScoreValue(ScoreValue& sv, long double score, const Data& member)
+    {
+        char tmp[32];
+        Object member_obj = zset_member(member, tmp, sizeof(tmp));
+        sv.value.Clear();
+        sv.value.hasttl = m_segment.ScorePrecision() == DOUBLE_SCORE;
+        size_t score_bytes = sv.ScoreBytes();
+        char* buf = (char*) m_segment.Allocate(score_bytes + member_obj.len);
+        memcpy(buf + score_bytes, member_obj.RawValue(), member_obj.len);
+        sv.value.len = member_obj.len;
+        sv.value.SetValue(buf + score_bytes);
+        sv.SetScore(score);
     }
-    int MMKVImpl::UpdateZSetScore(ZSet& zset, const Object& value, long double score, long double new_score)
+    void MMKVImpl::DestroyScoreValue(const ScoreValue& sv)
     {
-        ScoreValue tmp;
-        tmp.value = value;
-        tmp.score = score;
-        SortedSet::iterator found = zset.set.find(tmp);
+        m_segment.Deallocate(const_cast<char*>(sv.value.RawValue()) - sv.ScoreBytes());
+    }
+    long double MMKVImpl::StoredScore(long double score)
+    {
+        if (m_segment.ScorePrecision() == DOUBLE_SCORE)
+        {
+            return (double) score;
+        }
+        return score;
+    }
+    void MMKVImpl::UpdateZSetScore(ZSet& zset, ScoreValue sv, long double new_score)
+    {
+        SortedSet::iterator found = zset.set.find(sv);
         if (found == zset.set.end())
         {
-            return -1;
+            ABORT("Can not replace old zset element score.");
         }
-        ScoreValue old_value = *found;
         zset.set.erase(found);
-        old_value.score = new_score;
-        zset.set.insert(old_value);
+        sv.SetScore(new_score);
+        zset.set.insert(sv);
+    }
+    int MMKVImpl::GenericZAdd(ZSet& zset, const Data& member, long double score, bool nx, bool xx, bool incr,
+            long double& new_score)
+    {
+        ScoreValue sv;
+        if (!zset_find(zset, member, sv))
+        {
+            if (xx)
+            {
+                return -1;
+            }
+            CreateScoreValue(sv, score, member);
+            zset.members.insert(sv.value);
+            zset.set.insert(sv);
+            new_score = sv.Score();
+            return 1;
+        }
+        long double old_score = sv.Score();
+        new_score = old_score;
+        if (nx)
+        {
+            return -1;
+        }
+        new_score = StoredScore(incr ? old_score + score : score);
+        if (new_score == old_score)
+        {
+            return -1;
+        }
+        UpdateZSetScore(zset, sv, new_score);
         return 0;
     }
 
@@ -72,7 +141,7 @@ namespace mmkv
         }
         int err = 0;
 
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         Allocator<char> allocator = m_segment.MSpaceAllocator<char>();
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, xx ? false : true, err)(allocator);
@@ -87,61 +156,19 @@ namespace mmkv
         int modified = 0;
         for (size_t i = 0; i < vals.size(); i++)
         {
-            Object tmpk(vals[i].value, true);
-            std::pair<StringDoubleTable::iterator, bool> ret = zset->scores.insert(
-                    StringDoubleTable::value_type(tmpk, vals[i].score));
-            if (ret.second)
+            long double new_score;
+            int ret = GenericZAdd(*zset, vals[i].value, vals[i].score, nx, xx, incr, new_score);
+            if (ret == 1 || (ret == 0 && ch))
             {
-                if (xx)
-                {
-                    zset->scores.erase(ret.first);
-                    continue;
-                }
-                ScoreValue fv;
-                AssignScoreValue(fv, vals[i].score, vals[i].value);
-                const_cast<Object&>(ret.first->first) = fv.value;
-                zset->set.insert(fv);
                 modified++;
             }
-            else
-            {
-                if (nx)
-                {
-                    continue;
-                }
-                long double new_score = vals[i].score;
-                if (incr)
-                {
-                    new_score += ret.first->second;
-                }
-                else
-                {
-                    if (ret.first->second == vals[i].score)
-                    {
-                        continue;
-                    }
-                }
-
-                if (ch)
-                {
-                    modified++;
-                }
-                if (0 == UpdateZSetScore(*zset, Object(vals[i].value, true), ret.first->second, new_score))
-                {
-                    ret.first->second = new_score;
-                }
-                else
-                {
-                    ABORT("Can not replace old zset element score.");
-                }
-            }
         }
         return modified;
     }
     int MMKVImpl::ZCard(DBID db, const Data& key)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         SortedSet* zset = GetObject<SortedSet>(db, key, V_TYPE_ZSET, false, err)();
         if (NULL == zset || 0 != err)
         {
@@ -213,42 +240,7 @@ namespace mmkv
         {
             return set.size() - 1;
         }
-        if (it == set.begin())
-        {
-            return 0;
-        }
-        ScoreValue& match_value = *it;
-        size_t rank = 0;
-        if (set.size() <= 32)
-        {
-            SortedSet::iterator bit = set.begin();
-            while (bit != it)
-            {
-                bit++;
-                rank++;
-            }
-        }
-        else
-        {
-            size_t low = 0;
-            size_t high = set.size() - 1;
-            SortedSet::iterator last_it = set.end();
-            while (low <= high)
-            {
-                size_t mid = low + (high - low) / 2;
-                SortedSet::iterator cit = set.begin();
-                cit.increment_by(mid);
-                ScoreValue& tmp = *cit;
-                int cmpret = tmp.Compare(match_value);
-                if (cmpret == 0)
-                    return mid;
-                else if (cmpret > 0)
-                    high = mid - 1;
-                else
-                    low = mid + 1;
-            }
-        }
-        return rank;
+        return it.rank();
     }
     int MMKVImpl::ZCount(DBID db, const Data& key, const std::string& min, const std::string& max)
     {
@@ -258,7 +250,7 @@ namespace mmkv
         {
             return err;
         }
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
         {
@@ -268,14 +260,12 @@ namespace mmkv
         {
             return err;
         }
-        ScoreValue min_sv, max_sv;
-        min_sv.score = spec.min;
-        max_sv.score = spec.max;
-        SortedSet::iterator min_it = zset->set.lower_bound(min_sv);
-        SortedSet::iterator max_it = zset->set.lower_bound(max_sv);
+        ScoreValueKey min_sv(spec.min), max_sv(spec.max);
+        SortedSet::iterator min_it = zset->set.lower_bound(min_sv.Get());
+        SortedSet::iterator max_it = zset->set.lower_bound(max_sv.Get());
         while (spec.minex && min_it != zset->set.end())
         {
-            if (min_it->score == spec.min)
+            if (min_it->Score() == spec.min)
             {
                 min_it++;
             }
@@ -286,7 +276,7 @@ namespace mmkv
         }
         while (spec.maxex && max_it != zset->set.end())
         {
-            if (max_it->score == spec.max)
+            if (max_it->Score() == spec.max)
             {
                 max_it--;
             }
@@ -312,7 +302,7 @@ namespace mmkv
         int err = 0;
         new_score = 0;
 
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         Allocator<char> allocator = m_segment.MSpaceAllocator<char>();
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, true, err)(allocator);
@@ -320,23 +310,7 @@ namespace mmkv
         {
             return err;
         }
-        Object tmpk(member, true);
-        std::pair<StringDoubleTable::iterator, bool> ret = zset->scores.insert(
-                StringDoubleTable::value_type(tmpk, increment));
-        if (ret.second)
-        {
-            ScoreValue fv;
-            AssignScoreValue(fv, increment, member);
-            const_cast<Object&>(ret.first->first) = fv.value;
-            zset->set.insert(fv);
-            new_score = increment;
-        }
-        else
-        {
-            UpdateZSetScore(*zset, tmpk, ret.first->second, ret.first->second + increment);
-            ret.first->second = ret.first->second + increment;
-            new_score = ret.first->second;
-        }
+        GenericZAdd(*zset, member, increment, false, false, true, new_score);
         return 0;
     }
     /* Struct to hold an inclusive/exclusive range spec by lexicographic comparison. */
@@ -434,7 +408,7 @@ namespace mmkv
         {
             return err;
         }
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (NULL == zset || 0 != err)
         {
@@ -444,12 +418,12 @@ namespace mmkv
         {
             return 0;
         }
-        ScoreValue sv;
-        sv.score = zset->set.begin()->score;
+        long double lex_score = zset->set.begin()->Score();
         Object min_cstr(range.min, false);
         Object max_cstr(range.max, false);
-        sv.value = min_cstr;
-        SortedSet::iterator min_it = range.min_empty_type == -1 ? zset->set.begin() : zset->set.lower_bound(sv);
+        ScoreValueKey min_sv(lex_score, min_cstr), max_sv(lex_score, max_cstr);
+        SortedSet::iterator min_it =
+                range.min_empty_type == -1 ? zset->set.begin() : zset->set.lower_bound(min_sv.Get());
         while (min_it != zset->set.end())
         {
             ScoreValue& tmp = *min_it;
@@ -462,8 +436,8 @@ namespace mmkv
                 break;
             }
         }
-        sv.value = max_cstr;
-        SortedSet::iterator max_it = range.max_empty_type == 1 ? zset->set.end() : zset->set.lower_bound(sv);
+        SortedSet::iterator max_it =
+                range.max_empty_type == 1 ? zset->set.end() : zset->set.lower_bound(max_sv.Get());
         if (max_it == zset->set.end())
         {
             max_it--;
@@ -488,7 +462,7 @@ namespace mmkv
     int MMKVImpl::ZRange(DBID db, const Data& key, int start, int end, bool with_scores, const StringArrayResult& vals)
     {
         int err;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
         {
@@ -527,7 +501,7 @@ namespace mmkv
             {
                 std::string& ss = vals.Get();
                 char buf[256];
-                snprintf(buf, sizeof(buf), "%.17Lg", sv.score);
+                snprintf(buf, sizeof(buf), "%.17Lg", sv.Score());
                 ss = buf;
             }
         }
@@ -543,7 +517,7 @@ namespace mmkv
         {
             return err;
         }
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
         {
@@ -557,12 +531,12 @@ namespace mmkv
         {
             return 0;
         }
-        ScoreValue sv;
-        sv.score = zset->set.begin()->score;
+        long double lex_score = zset->set.begin()->Score();
         Object min_cstr(range.min, false);
         Object max_cstr(range.max, false);
-        sv.value = min_cstr;
-        SortedSet::iterator min_it = range.min_empty_type == -1 ? zset->set.begin() : zset->set.lower_bound(sv);
+        ScoreValueKey min_sv(lex_score, min_cstr), max_sv(lex_score, max_cstr);
+        SortedSet::iterator min_it =
+                range.min_empty_type == -1 ? zset->set.begin() : zset->set.lower_bound(min_sv.Get());
         if(min_it == zset->set.end())
         {
             return 0;
@@ -575,8 +549,8 @@ namespace mmkv
         {
             return 0;
         }
-        sv.value = max_cstr;
-        SortedSet::iterator max_it = range.max_empty_type == 1 ? zset->set.end() : zset->set.lower_bound(sv);
+        SortedSet::iterator max_it =
+                range.max_empty_type == 1 ? zset->set.end() : zset->set.lower_bound(max_sv.Get());
         if (limit_offset > 0)
         {
             min_it.increment_by(limit_offset);
@@ -612,7 +586,7 @@ namespace mmkv
         {
             return err;
         }
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
         {
@@ -622,12 +596,11 @@ namespace mmkv
         {
             return err;
         }
-        ScoreValue min_sv;
-        min_sv.score = spec.min;
-        SortedSet::iterator min_it = zset->set.lower_bound(min_sv);
+        ScoreValueKey min_sv(spec.min);
+        SortedSet::iterator min_it = zset->set.lower_bound(min_sv.Get());
         while (spec.minex && min_it != zset->set.end())
         {
-            if (min_it->score == spec.min)
+            if (min_it->Score() == spec.min)
             {
                 min_it++;
             }
@@ -648,7 +621,7 @@ namespace mmkv
                 break;
             }
             ScoreValue& sv = *min_it;
-            if (sv.score > spec.max || (spec.maxex && sv.score == spec.max))
+            if (sv.Score() > spec.max || (spec.maxex && sv.Score() == spec.max))
             {
                 break;
             }
@@ -657,7 +630,7 @@ namespace mmkv
             if (with_scores)
             {
                 char buf[256];
-                snprintf(buf, sizeof(buf), "%.17Lg", sv.score);
+                snprintf(buf, sizeof(buf), "%.17Lg", sv.Score());
                 std::string& ss = vals.Get();
                 ss = buf;
             }
@@ -669,21 +642,17 @@ namespace mmkv
     int MMKVImpl::ZRank(DBID db, const Data& key, const Data& member)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (0 != err)
         {
             return err;
         }
-        Object member_obj(member, true);
-        StringDoubleTable::iterator found = zset->scores.find(member_obj);
-        if (found == zset->scores.end())
+        ScoreValue sv;
+        if (!zset_find(*zset, member, sv))
         {
             return ERR_ENTRY_NOT_EXIST;
         }
-        ScoreValue sv;
-        sv.value = member_obj;
-        sv.score = found->second;
         SortedSet::iterator fit = zset->set.find(sv);
         if (fit == zset->set.end())
         {
@@ -698,7 +667,7 @@ namespace mmkv
             return ERR_PERMISSION_DENIED;
         }
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
@@ -712,24 +681,19 @@ namespace mmkv
         size_t removed = 0;
         for (size_t i = 0; i < members.size(); i++)
         {
-            Object mem_obj(members[i], true);
-            StringDoubleTable::iterator found = zset->scores.find(mem_obj);
-            if (found == zset->scores.end())
+            ScoreValue sv;
+            if (!zset_find(*zset, members[i], sv))
             {
                 continue;
             }
-            ScoreValue tmp;
-            tmp.score = found->second;
-            tmp.value = mem_obj;
-            SortedSet::iterator fit = zset->set.find(tmp);
+            SortedSet::iterator fit = zset->set.find(sv);
             if (fit == zset->set.end())
             {
                 ABORT("No zset element found.");
             }
-            ScoreValue sv = *fit;
             zset->set.erase(fit);
-            zset->scores.erase(found);
-            DestroyObjectContent(sv.value);
+            zset->members.erase(sv.value);
+            DestroyScoreValue(sv);
             removed++;
         }
         if (zset->set.empty())
@@ -751,7 +715,7 @@ namespace mmkv
         {
             return err;
         }
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
         {
@@ -765,12 +729,11 @@ namespace mmkv
         {
             return 0;
         }
-        ScoreValue sv;
-        sv.score = zset->set.begin()->score;
         Object min_cstr(range.min, false);
         Object max_cstr(range.max, false);
-        sv.value = min_cstr;
-        SortedSet::iterator min_it = range.min_empty_type == -1 ? zset->set.begin() : zset->set.lower_bound(sv);
+        ScoreValueKey min_sv(zset->set.begin()->Score(), min_cstr);
+        SortedSet::iterator min_it =
+                range.min_empty_type == -1 ? zset->set.begin() : zset->set.lower_bound(min_sv.Get());
         size_t removed = 0;
         while (min_it != zset->set.end())
         {
@@ -788,9 +751,9 @@ namespace mmkv
                 }
                 else
                 {
-                    zset->scores.erase(tmp.value);
+                    zset->members.erase(tmp.value);
                     min_it = zset->set.erase(min_it);
-                    DestroyObjectContent(tmp.value);
+                    DestroyScoreValue(tmp);
                     removed++;
                 }
             }
@@ -804,7 +767,7 @@ namespace mmkv
     int MMKVImpl::ZRemRangeByRank(DBID db, const Data& key, int start, int end)
     {
         int err;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
@@ -839,9 +802,9 @@ namespace mmkv
         for (int i = start; i <= end; i++)
         {
             ScoreValue sv = *it;
-            zset->scores.erase(sv.value);
+            zset->members.erase(sv.value);
             it = zset->set.erase(it);
-            DestroyObjectContent(sv.value);
+            DestroyScoreValue(sv);
         }
         if (zset->set.empty())
         {
@@ -861,7 +824,7 @@ namespace mmkv
         {
             return err;
         }
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
         {
@@ -871,13 +834,12 @@ namespace mmkv
         {
             return err;
         }
-        ScoreValue min_sv;
-        min_sv.score = spec.min;
-        SortedSet::iterator min_it = zset->set.lower_bound(min_sv);
+        ScoreValueKey min_sv(spec.min);
+        SortedSet::iterator min_it = zset->set.lower_bound(min_sv.Get());
 
         while (spec.minex && min_it != zset->set.end())
         {
-            if (min_it->score == spec.min)
+            if (min_it->Score() == spec.min)
             {
                 min_it++;
             }
@@ -890,13 +852,13 @@ namespace mmkv
         while (min_it != zset->set.end())
         {
             ScoreValue sv = *min_it;
-            if (sv.score > spec.max || (spec.maxex && sv.score == spec.max))
+            if (sv.Score() > spec.max || (spec.maxex && sv.Score() == spec.max))
             {
                 break;
             }
-            zset->scores.erase(sv.value);
+            zset->members.erase(sv.value);
             min_it = zset->set.erase(min_it);
-            DestroyObjectContent(sv.value);
+            DestroyScoreValue(sv);
             remove_count++;
         }
         if (zset->set.empty())
@@ -909,7 +871,7 @@ namespace mmkv
             const StringArrayResult& vals)
     {
         int err;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
         {
@@ -951,7 +913,7 @@ namespace mmkv
             if (with_scores)
             {
                 char buf[256];
-                snprintf(buf, sizeof(buf), "%.17Lg", sv.score);
+                snprintf(buf, sizeof(buf), "%.17Lg", sv.Score());
                 std::string& ss = vals.Get();
                 ss = buf;
             }
@@ -968,7 +930,7 @@ namespace mmkv
         {
             return err;
         }
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
         {
@@ -982,13 +944,11 @@ namespace mmkv
         {
             return 0;
         }
-        ScoreValue sv;
-        sv.score = zset->set.begin()->score;
-        Object min_cstr(range.min, true);
-        Object max_cstr(range.max, true);
-        sv.value = max_cstr;
-
-        SortedSet::iterator max_it = range.max_empty_type == 1 ? zset->set.end() : zset->set.lower_bound(sv);
+        Object min_cstr(range.min, false);
+        Object max_cstr(range.max, false);
+        ScoreValueKey max_sv(zset->set.begin()->Score(), max_cstr);
+        SortedSet::iterator max_it =
+                range.max_empty_type == 1 ? zset->set.end() : zset->set.lower_bound(max_sv.Get());
         if (max_it == zset->set.end())
         {
             max_it--;
@@ -1051,7 +1011,7 @@ namespace mmkv
         {
             return err;
         }
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (IS_NOT_EXISTS(err))
         {
@@ -1061,20 +1021,19 @@ namespace mmkv
         {
             return err;
         }
-        if (zset->scores.size() == 0)
+        if (zset->members.size() == 0)
         {
             return 0;
         }
-        ScoreValue max_sv;
-        max_sv.score = spec.max;
-        SortedSet::iterator max_it = zset->set.lower_bound(max_sv);
+        ScoreValueKey max_sv(spec.max);
+        SortedSet::iterator max_it = zset->set.lower_bound(max_sv.Get());
         if (max_it == zset->set.end())
         {
             max_it--;
         }
         while (spec.maxex)
         {
-            if (max_it->score == spec.max && max_it != zset->set.begin())
+            if (max_it->Score() == spec.max && max_it != zset->set.begin())
             {
                 max_it--;
             }
@@ -1106,7 +1065,7 @@ namespace mmkv
                 break;
             }
             ScoreValue& sv = *sit;
-            if (sv.score < spec.min || (spec.minex && sv.score == spec.min))
+            if (sv.Score() < spec.min || (spec.minex && sv.Score() == spec.min))
             {
                 break;
             }
@@ -1116,7 +1075,7 @@ namespace mmkv
             if (with_scores)
             {
                 char buf[256];
-                snprintf(buf, sizeof(buf), "%.17Lg", sv.score);
+                snprintf(buf, sizeof(buf), "%.17Lg", sv.Score());
                 std::string& ss = vals.Get();
                 ss = buf;
             }
@@ -1131,21 +1090,17 @@ namespace mmkv
     int MMKVImpl::ZRevRank(DBID db, const Data& key, const Data& member)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (0 != err)
         {
             return err;
         }
-        Object member_obj(member, true);
-        StringDoubleTable::iterator found = zset->scores.find(member_obj);
-        if (found == zset->scores.end())
+        ScoreValue sv;
+        if (!zset_find(*zset, member, sv))
         {
             return ERR_ENTRY_NOT_EXIST;
         }
-        ScoreValue sv;
-        sv.value = member_obj;
-        sv.score = found->second;
         SortedSet::iterator fit = zset->set.find(sv);
         if (fit == zset->set.end())
         {
@@ -1154,28 +1109,32 @@ namespace mmkv
         return zset->set.size() - btree_rank(zset->set, fit) - 1;
     }
     int MMKVImpl::ZScore(DBID db, const Data& key, const Data& member, long double& score)
+    {
+        OPTIMISTIC_READ(db, GenericZScore(db, key, member, score));
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
+        return GenericZScore(db, key, member, score);
+    }
+    int MMKVImpl::GenericZScore(DBID db, const Data& key, const Data& member, long double& score)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
-        EnsureWritableValueSpace();
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (0 != err)
         {
             return err;
         }
-        StringDoubleTable::iterator found = zset->scores.find(Object(member, true));
-        if (found == zset->scores.end())
+        ScoreValue sv;
+        if (!zset_find(*zset, member, sv))
         {
             return ERR_ENTRY_NOT_EXIST;
         }
-        score = found->second;
+        score = sv.Score();
         return 0;
     }
     int64_t MMKVImpl::ZScan(DBID db, const Data& key, int64_t cursor, const std::string& pattern, int32_t limit_count,
             const StringArrayResult& vals)
     {
         int err = 0;
-        RWLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, READ_LOCK> keylock_guard(m_segment, db);
         ZSet* zset = GetObject<ZSet>(db, key, V_TYPE_ZSET, false, err)();
         if (0 != err)
         {
@@ -1198,7 +1157,7 @@ namespace mmkv
                 std::string& ss1 = vals.Get();
                 ss1 = key_str;
                 char score_str[256];
-                snprintf(score_str, sizeof(score_str), "%.17Lg", it->score);
+                snprintf(score_str, sizeof(score_str), "%.17Lg", it->Score());
                 std::string& score_string = vals.Get();
                 score_string = score_str;
                 match_count++;
@@ -1213,21 +1172,6 @@ namespace mmkv
         return it != zset->set.end() ? cursor : 0;
     }
 
-    static inline size_t SetLen(Object* set)
-    {
-        if (NULL == set)
-        {
-            return 0;
-        }
-        if (set->type == V_TYPE_ZSET)
-        {
-            SortedSet* ss = (SortedSet*) set->RawValue();
-            return ss->size();
-        }
-        StringSet* ss = (StringSet*) set->RawValue();
-        return ss->size();
-    }
-
     static void aggregate_score(int aggregate_type, long double current_score, double& score)
     {
         switch (aggregate_type)
@@ -1275,7 +1219,7 @@ namespace mmkv
         std::vector<Object*> sets;
         sets.resize(keys.size());
         int err;
-        RWLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment);
+        DBLockGuard<MemorySegmentManager, WRITE_LOCK> keylock_guard(m_segment, db);
         EnsureWritableValueSpace();
         Allocator<char> allocator = m_segment.MSpaceAllocator<char>();
         ZSet* destset = GetObject<ZSet>(db, destination, V_TYPE_ZSET, true, err)(allocator);
@@ -1297,7 +1241,8 @@ namespace mmkv
             }
             sets[i] = const_cast<Object*>(o);
         }
-        StdObjectScoreTable cache_result;
+        typedef std::map<std::string, double> MemberScoreTable;
+        MemberScoreTable cache_result;
         bool fill_cache_result = false;
         int aggregate_type = AGGREGATE_SUM;
         if (!aggregate.empty())
@@ -1322,52 +1267,70 @@ namespace mmkv
 
         for (size_t i = 0; i < keys.size(); i++)
         {
-            if (SetLen(sets[i]) == 0 && op == OP_INTER)
+            size_t len = 0;
+            if (NULL != sets[i])
+            {
+                len = sets[i]->type == V_TYPE_ZSET ? ((ZSet*) sets[i]->RawValue())->set.size() : SetSize(*sets[i]);
+            }
+            if (len == 0)
             {
                 if (op == OP_INTER)
                 {
-                    GenericDelValue(V_TYPE_ZSET, destset);
+                    GenericDel(kv, db, Object(destination, false));
                     return 0;
                 }
-                else
-                {
-                    continue;
-                }
+                continue;
             }
 
             if (sets[i]->type == V_TYPE_SET)
             {
-                StringSet* ss = (StringSet*) sets[i]->RawValue();
+                long double current_score = weights.empty() ? 1 : weights[i] * 1;
                 if (!fill_cache_result || op == OP_UNION)
                 {
-                    StringSet::iterator it = ss->begin();
-                    while (it != ss->end())
+                    std::string member;
+                    if (sets[i]->IsPacked())
                     {
-                        long double current_score = weights.empty() ? 1 : weights[i] * 1;
-                        std::pair<StdObjectScoreTable::iterator, bool> ret = cache_result.insert(
-                                StdObjectScoreTable::value_type(*it, current_score));
-                        if (!ret.second)
+                        PackedSetReader reader(*sets[i]);
+                        for (; reader.Valid(); reader.Next())
                         {
-                            aggregate_score(aggregate_type, current_score, ret.first->second);
+                            reader.Member().ToString(member);
+                            std::pair<MemberScoreTable::iterator, bool> ret = cache_result.insert(
+                                    MemberScoreTable::value_type(member, current_score));
+                            if (!ret.second)
+                            {
+                                aggregate_score(aggregate_type, current_score, ret.first->second);
+                            }
+                        }
+                    }
+                    else
+                    {
+                        StringSet* ss = (StringSet*) sets[i]->RawValue();
+                        StringSet::iterator it = ss->begin();
+                        while (it != ss->end())
+                        {
+                            it->ToString(member);
+                            std::pair<MemberScoreTable::iterator, bool> ret = cache_result.insert(
+                                    MemberScoreTable::value_type(member, current_score));
+                            if (!ret.second)
+                            {
+                                aggregate_score(aggregate_type, current_score, ret.first->second);
+                            }
+                            it++;
                         }
-
-                        it++;
                     }
                     fill_cache_result = true;
                 }
                 else
                 {
-                    StdObjectScoreTable::iterator sit = cache_result.begin();
+                    MemberScoreTable::iterator sit = cache_result.begin();
                     while (sit != cache_result.end())
                     {
-                        StringSet::iterator ssit = ss->find(sit->first);
-                        if (ssit == ss->end())
+                        if (!SetIsMember(*sets[i], sit->first))
                         {
                             cache_result.erase(sit++);
                         }
                         else
                         {
-                            long double current_score = weights.empty() ? 1 : weights[i] * 1;
                             aggregate_score(aggregate_type, current_score, sit->second);
                             sit++;
                         }
@@ -1379,12 +1342,14 @@ namespace mmkv
                 ZSet* ss = (ZSet*) sets[i]->RawValue();
                 if (!fill_cache_result || op == OP_UNION)
                 {
+                    std::string member;
                     SortedSet::iterator it = ss->set.begin();
                     while (it != ss->set.end())
                     {
-                        long double current_score = weights.empty() ? it->score : weights[i] * it->score;
-                        std::pair<StdObjectScoreTable::iterator, bool> ret = cache_result.insert(
-                                StdObjectScoreTable::value_type(it->value, current_score));
+                        long double current_score = weights.empty() ? it->Score() : weights[i] * it->Score();
+                        it->value.ToString(member);
+                        std::pair<MemberScoreTable::iterator, bool> ret = cache_result.insert(
+                                MemberScoreTable::value_type(member, current_score));
                         if (!ret.second)
                         {
                             aggregate_score(aggregate_type, current_score, ret.first->second);
@@ -1395,20 +1360,17 @@ namespace mmkv
                 }
                 else
                 {
-                    StdObjectScoreTable::iterator sit = cache_result.begin();
+                    MemberScoreTable::iterator sit = cache_result.begin();
                     while (sit != cache_result.end())
                     {
                         ScoreValue sv;
-                        sv.score = sit->second;
-                        sv.value = sit->first;
-                        StringDoubleTable::iterator ssit = ss->scores.find(sit->first);
-                        if (ssit == ss->scores.end())
+                        if (!zset_find(*ss, sit->first, sv))
                         {
                             cache_result.erase(sit++);
                         }
                         else
                         {
-                            long double current_score = weights.empty() ? ssit->second : weights[i] * ssit->second;
+                            long double current_score = weights.empty() ? sv.Score() : weights[i] * sv.Score();
                             aggregate_score(aggregate_type, current_score, sit->second);
                             sit++;
                         }
@@ -1416,39 +1378,26 @@ namespace mmkv
                 }
             }
         }
-        //remove elements not in dest set
-        StringDoubleTable::iterator it = destset->scores.begin();
-        while (it != destset->scores.end())
+        //results are copied out of the source sets, so the destination may be one of them
+        SortedSet::iterator it = destset->set.begin();
+        while (it != destset->set.end())
         {
-            Object element = it->first;
-            StdObjectScoreTable::iterator cit = cache_result.find(element);
-            if (cit == cache_result.end()) //remove elements from results which already in dest set
-            {
-                ScoreValue sv;
-                sv.value = element;
-                sv.score = it->second;
-                destset->scores.erase(it);
-                destset->set.erase(sv);
-                DestroyObjectContent(element);
-            }
+            DestroyScoreValue(*it);
             it++;
         }
         destset->set.clear();
-
-        //insert rest elements
-        StdObjectScoreTable::iterator cit = cache_result.begin();
+        destset->members.clear();
+        if (cache_result.empty())
+        {
+            GenericDel(kv, db, Object(destination, false));
+            return 0;
+        }
+        MemberScoreTable::iterator cit = cache_result.begin();
         while (cit != cache_result.end())
         {
-            std::pair<StringDoubleTable::iterator, bool> ret = destset->scores.insert(
-                    StringDoubleTable::value_type(cit->first, cit->second));
-            if (!ret.second)
-            {
-                ret.first->second = cit->second;
-            }
             ScoreValue sv;
-            sv.value = CloneStrObject(cit->first);
-            sv.score = cit->second;
-            const_cast<Object&>(ret.first->first) = sv.value;
+            CreateScoreValue(sv, cit->second, cit->first);
+            destset->members.insert(sv.value);
             destset->set.insert(sv);
             cit++;
         }
@@ -37,11 +37,13 @@
 #include "utils.hpp"
 #include "mmkv.hpp"
 #include <string.h>
+#include <float.h>
 #include <new>
 #include <string>
 #include <vector>
 #include <utility>
 #include <alloca.h>
+#include <time.h>
 
 #define ABORT(msg) \
     do {                                \
@@ -55,6 +57,8 @@
 #define OBJ_ENCODING_PTR 1
 #define OBJ_ENCODING_OFFSET_PTR 2
 #define OBJ_ENCODING_INT 3
+#define OBJ_ENCODING_COMPACT 4  //offset ptr to a small hash/set packed as 'ListPack'
+#define OBJ_ENCODING_INTSET 5   //offset ptr to a set of integers packed as 'IntSet'
 #define OBJ_ENCODING_PADDING
 
 namespace mmkv
@@ -163,7 +167,7 @@ namespace mmkv
             inline Object(const Object& other) :
                     type(other.type), encoding(other.encoding), hasttl(other.hasttl), len(other.len)
             {
-                if (encoding == OBJ_ENCODING_OFFSET_PTR)
+                if (IsOffsetPtr())
                 {
                     *((boost::interprocess::offset_ptr<void>*) data) =
                             *((boost::interprocess::offset_ptr<void>*) other.data);
@@ -198,7 +202,7 @@ namespace mmkv
                 encoding = other.encoding;
                 hasttl = other.hasttl;
                 len = other.len;
-                if (encoding == OBJ_ENCODING_OFFSET_PTR)
+                if (IsOffsetPtr())
                 {
                     *((boost::interprocess::offset_ptr<void>*) data) =
                             *((boost::interprocess::offset_ptr<void>*) other.data);
@@ -229,6 +233,8 @@ namespace mmkv
                         return *(char**) data;
                     }
                     case OBJ_ENCODING_OFFSET_PTR:
+                    case OBJ_ENCODING_COMPACT:
+                    case OBJ_ENCODING_INTSET:
                     {
                         boost::interprocess::offset_ptr<char>* ptr = (boost::interprocess::offset_ptr<char>*) data;
                         return ptr->get();
@@ -253,11 +259,24 @@ namespace mmkv
             }
             inline bool IsPtr() const
             {
-                return encoding == OBJ_ENCODING_PTR || encoding == OBJ_ENCODING_OFFSET_PTR;
+                return encoding == OBJ_ENCODING_PTR || IsOffsetPtr();
             }
             inline bool IsOffsetPtr() const
             {
-                return encoding == OBJ_ENCODING_OFFSET_PTR;
+                return encoding == OBJ_ENCODING_OFFSET_PTR || encoding == OBJ_ENCODING_COMPACT
+                        || encoding == OBJ_ENCODING_INTSET;
+            }
+            inline bool IsCompact() const
+            {
+                return encoding == OBJ_ENCODING_COMPACT;
+            }
+            inline bool IsIntSet() const
+            {
+                return encoding == OBJ_ENCODING_INTSET;
+            }
+            inline bool IsPacked() const
+            {
+                return IsCompact() || IsIntSet();
             }
             inline int64_t IntegerValue() const
             {
@@ -332,7 +351,9 @@ namespace mmkv
                 {
                     if (IsInteger() && right.IsInteger())
                     {
-                        return IntegerValue() - right.IntegerValue();
+                        //64 bits difference may overflow the int result
+                        int64_t v1 = IntegerValue(), v2 = right.IntegerValue();
+                        return v1 < v2 ? -1 : (v1 > v2 ? 1 : 0);
                     }
                     //integer is always less than text value in non alpha comparator
                     if (IsInteger())
@@ -389,15 +410,92 @@ namespace mmkv
 
     typedef boost::interprocess::offset_ptr<Object> ObjectOffsetPtr;
 
+    static const uint32_t kLFUInitCounter = 5;
+    inline uint32_t access_clock_now()
+    {
+        return (uint32_t) time(NULL) << 8;
+    }
+
+    /*
+     * value of a top level key with the access clock read by eviction: seconds of the last access in the
+     * high 24 bits, logarithmic access counter of LFU policies in the low 8 bits.
+     */
+    struct MMValue: public Object
+    {
+            uint32_t lru;
+            inline MMValue() :
+                    lru(access_clock_now() | kLFUInitCounter)
+            {
+            }
+            inline MMValue(const Object& other) :
+                    Object(other), lru(access_clock_now() | kLFUInitCounter)
+            {
+            }
+            //the clock stays with the key when its value is replaced
+            inline MMValue& operator=(const Object& other)
+            {
+                Object::operator=(other);
+                return *this;
+            }
+    };
+
+    /*
+     * murmur3 finalizer, so that sequential/strided integers spread over all bits
+     * before tables mask the hash code with bucket count.
+     */
+    inline uint64_t mix_integer_hash(uint64_t k)
+    {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    /*
+     * Hash policies of ObjectHash/TTLKeyHash, selected at compile time by defining MMKV_HASH_POLICY.
+     * The policy id is recorded in the data file, since hash tables can only be read back with the
+     * same hash function.
+     */
+    struct XXH64HashPolicy
+    {
+            static const uint32_t kID = 1;
+            static size_t HashBytes(const char* data, size_t len)
+            {
+                return XXH64(data, len, 0);
+            }
+            static size_t HashInteger(int64_t v)
+            {
+                return mix_integer_hash(v);
+            }
+    };
+    struct XXH32HashPolicy
+    {
+            static const uint32_t kID = 2;
+            static size_t HashBytes(const char* data, size_t len)
+            {
+                return XXH32(data, len, 0);
+            }
+            static size_t HashInteger(int64_t v)
+            {
+                return mix_integer_hash(v);
+            }
+    };
+#ifndef MMKV_HASH_POLICY
+#define MMKV_HASH_POLICY XXH64HashPolicy
+#endif
+    typedef MMKV_HASH_POLICY HashPolicy;
+
     struct ObjectHash
     {
             size_t operator()(const Object& t) const
             {
                 if (t.encoding == OBJ_ENCODING_INT)
                 {
-                    return t.IntegerValue();
+                    return HashPolicy::HashInteger(t.IntegerValue());
                 }
-                return XXH64(t.RawValue(), t.len, 0);
+                return HashPolicy::HashBytes(t.RawValue(), t.len);
             }
     };
     struct ObjectEqual
@@ -464,16 +562,8 @@ namespace mmkv
     {
             size_t operator()(const TTLKey& t) const
             {
-                size_t hash = 0;
-                if (t.key.encoding == OBJ_ENCODING_INT)
-                {
-                    hash = t.key.IntegerValue();
-                }
-                else
-                {
-                    hash = XXH64(t.key.RawValue(), t.key.len, 0);
-                }
-                return t.db ^ hash;
+                ObjectHash hash;
+                return t.db ^ hash(t.key);
             }
     };
     struct TTLKeyEqual
@@ -484,21 +574,67 @@ namespace mmkv
             }
     };
 
+    /*
+     * A zset element is allocated once as [score][member bytes]. 'value' refers to the member bytes so
+     * the element compares & hashes like a string object, the score is read from the bytes before it.
+     * Both the sorted btree and the member hash index of a zset hold such references.
+     * Stores created with DOUBLE_SCORE keep 8-byte double scores instead, such elements are marked by the
+     * 'hasttl' bit of 'value' which is otherwise unused for members.
+     */
     struct ScoreValue
     {
-            long double score;
+            //x87 extended precision only uses 10 bytes of its storage
+#if LDBL_MANT_DIG == 64
+            static const size_t kScoreBytes = 10;
+#else
+            static const size_t kScoreBytes = sizeof(long double);
+#endif
             Object value;
-            ScoreValue() :
-                    score(0)
+            ScoreValue()
+            {
+            }
+            explicit ScoreValue(const Object& v) :
+                    value(v)
+            {
+            }
+            bool IsDoubleScore() const
+            {
+                return value.hasttl;
+            }
+            size_t ScoreBytes() const
+            {
+                return IsDoubleScore() ? sizeof(double) : kScoreBytes;
+            }
+            long double Score() const
             {
+                if (IsDoubleScore())
+                {
+                    double score;
+                    memcpy(&score, value.RawValue() - sizeof(double), sizeof(double));
+                    return score;
+                }
+                long double score = 0;
+                memcpy(&score, value.RawValue() - kScoreBytes, kScoreBytes);
+                return score;
+            }
+            void SetScore(long double score)
+            {
+                if (IsDoubleScore())
+                {
+                    double dscore = (double) score;
+                    memcpy(value.WritableData() - sizeof(double), &dscore, sizeof(double));
+                    return;
+                }
+                memcpy(value.WritableData() - kScoreBytes, &score, kScoreBytes);
             }
             int Compare(const ScoreValue& v2) const
             {
-                if (score < v2.score)
+                long double score = Score(), score2 = v2.Score();
+                if (score < score2)
                 {
                     return -1;
                 }
-                else if (score > v2.score)
+                else if (score > score2)
                 {
                     return 1;
                 }
@@ -510,6 +646,52 @@ namespace mmkv
             }
     };
 
+    /*
+     * A zset element built on the stack, used as lookup key of the sorted btree.
+     */
+    class ScoreValueKey
+    {
+        private:
+            char m_space[ScoreValue::kScoreBytes + 64];
+            std::string m_buffer;
+            ScoreValue m_key;
+            ScoreValueKey(const ScoreValueKey&);
+            ScoreValueKey& operator=(const ScoreValueKey&);
+            void Init(long double score, const char* member, size_t len)
+            {
+                char* buf = m_space;
+                if (len > sizeof(m_space) - ScoreValue::kScoreBytes)
+                {
+                    m_buffer.resize(ScoreValue::kScoreBytes + len);
+                    buf = &m_buffer[0];
+                }
+                memcpy(buf + ScoreValue::kScoreBytes, member, len);
+                m_key.value.SetData(Data(buf + ScoreValue::kScoreBytes, len), false);
+                m_key.SetScore(score);
+            }
+        public:
+            explicit ScoreValueKey(long double score)
+            {
+                Init(score, "", 0);
+            }
+            ScoreValueKey(long double score, const Object& member)
+            {
+                char tmp[32];
+                if (member.IsInteger())
+                {
+                    Init(score, tmp, ll2string(tmp, sizeof(tmp), member.IntegerValue()));
+                }
+                else
+                {
+                    Init(score, member.RawValue(), member.len);
+                }
+            }
+            const ScoreValue& Get() const
+            {
+                return m_key;
+            }
+    };
+
     struct PODHeader
     {
             uint32_t type;
@@ -32,6 +32,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
 #include <vector>
 
 TEST(Save, Backup)
@@ -59,3 +60,38 @@ TEST(Save, Backup)
 }
 
 
+
+TEST(SaveIncrement, Backup)
+{
+    mmkv::make_dir("./backup");
+    CHECK_EQ(int, g_test_kv->Backup("./backup/base"), 0, "");
+    g_test_kv->Set(0, "incr_backup_key", "v1");
+    CHECK_EQ(int, g_test_kv->BackupIncrement("./backup/base", "./backup/incr1"), 0, "");
+    g_test_kv->Set(0, "incr_backup_key", "v2");
+    g_test_kv->Set(0, "incr_backup_key2", "v2");
+    CHECK_EQ(int, g_test_kv->BackupIncrement("./backup/incr1", "./backup/incr2"), 0, "");
+
+    //only changed pages are saved
+    struct stat base_st, incr_st;
+    stat("./backup/base", &base_st);
+    stat("./backup/incr2", &incr_st);
+    CHECK_EQ(bool, incr_st.st_size < base_st.st_size / 10, true, "");
+
+    int size = g_test_kv->DBSize(0);
+    g_test_kv->Del(0, "incr_backup_key");
+    g_test_kv->Set(0, "incr_backup_key3", "v3");
+
+    //increments must be applied in the order they were taken
+    mmkv::StringArray increments;
+    increments.push_back("./backup/incr2");
+    CHECK_EQ(int, g_test_kv->Restore("./backup/base", increments), -1, "");
+    increments.insert(increments.begin(), "./backup/incr1");
+    CHECK_EQ(int, g_test_kv->Restore("./backup/base", increments), 0, "");
+    std::string v;
+    g_test_kv->Get(0, "incr_backup_key", v);
+    CHECK_EQ(std::string, v, "v2", "");
+    CHECK_EQ(int, g_test_kv->Exists(0, "incr_backup_key3"), 0, "");
+    CHECK_EQ(int, g_test_kv->DBSize(0), size, "");
+    g_test_kv->Del(0, "incr_backup_key");
+    g_test_kv->Del(0, "incr_backup_key2");
+}
@@ -32,6 +32,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <pthread.h>
 #include <vector>
 
 TEST(MultiWrite, Concurrent)
@@ -99,6 +100,38 @@ TEST(MultiRead, Concurrent)
     printf("###Cost %lldus to concurrent read %u keys\n", end - start, read_count * proc_num);
 }
 
+static void* thread_read_keys(void* data)
+{
+    int i = *(int*) data;
+    mmkv::DBID testdb = 5;
+    for (int j = 0; j < 200000; j++)
+    {
+        char key[100];
+        sprintf(key, "key%d_%d", i, j);
+        CHECK_EQ(int, g_test_kv->Exists(testdb, key), 1, "");
+    }
+    return NULL;
+}
+
+TEST(MultiThreadRead, Concurrent)
+{
+    int thread_num = 8;
+    pthread_t threads[thread_num];
+    int ids[thread_num];
+    int64_t start = mmkv::get_current_micros();
+    for (int i = 0; i < thread_num; i++)
+    {
+        ids[i] = i;
+        pthread_create(&threads[i], NULL, thread_read_keys, &ids[i]);
+    }
+    for (int i = 0; i < thread_num; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    int64_t end = mmkv::get_current_micros();
+    printf("###Cost %lldus to concurrent read %u keys in %d threads\n", end - start, 200000 * thread_num, thread_num);
+}
+
 TEST(MultiReadWrite, Concurrent)
 {
     int proc_num = 10;
@@ -146,3 +179,301 @@ TEST(MultiReadWrite, Concurrent)
     printf("###Cost %lldus to concurrent read write %u keys\n", end - start, count * proc_num);
 }
 
+
+static mmkv::MMKV* g_dblock_kv = NULL;
+static mmkv::MMKV* get_dblock_kv()
+{
+    if (NULL == g_dblock_kv)
+    {
+        mmkv::OpenOptions open_options;
+        open_options.dir = "./mmkv_dblock";
+        open_options.use_lock = true;
+        open_options.per_db_lock = true;
+        open_options.optimistic_read = true;
+        open_options.create_if_notexist = true;
+        open_options.create_options.size = 1024 * 1024 * 1024LL;
+        mmkv::MMKV::Open(open_options, g_dblock_kv);
+    }
+    return g_dblock_kv;
+}
+
+TEST(MultiDBWrite, Concurrent)
+{
+    mmkv::MMKV* kv = get_dblock_kv();
+    CHECK_EQ(bool, kv != NULL, true, "");
+    int proc_num = 4;
+    int write_count = 200000;
+    std::vector<pid_t> childs;
+    for (int i = 0; i < proc_num; i++)
+    {
+        kv->FlushDB(i);
+    }
+    int64_t start = mmkv::get_current_micros();
+    for (int i = 0; i < proc_num; i++)
+    {
+        pid_t id = fork();
+        if (id == 0)
+        {
+            for (int j = 0; j < write_count; j++)
+            {
+                char key[100], value[100];
+                sprintf(key, "key%d_%d", i, j);
+                sprintf(value, "value%d_%d", i, j);
+                kv->Set(i, key, value);
+            }
+            exit(0);
+        }
+        childs.push_back(id);
+    }
+    for (size_t i = 0; i < childs.size(); i++)
+    {
+        int status;
+        waitpid(childs[i], &status, 0);
+    }
+    int64_t end = mmkv::get_current_micros();
+    printf("###Cost %lldus to concurrent write %u keys into %d dbs\n", end - start, write_count * proc_num, proc_num);
+    for (int i = 0; i < proc_num; i++)
+    {
+        CHECK_EQ(int, kv->DBSize(i), write_count, "");
+    }
+}
+
+TEST(MultiDBReadWrite, Concurrent)
+{
+    mmkv::MMKV* kv = get_dblock_kv();
+    CHECK_EQ(bool, kv != NULL, true, "");
+    int proc_num = 4;
+    int count = 200000;
+    std::vector<pid_t> childs;
+    int64_t start = mmkv::get_current_micros();
+    for (int i = 0; i < proc_num; i++)
+    {
+        pid_t id = fork();
+        if (id == 0)
+        {
+            //readers check keys written by MultiDBWrite while writers fill other dbs
+            for (int j = 0; j < count; j++)
+            {
+                char key[100];
+                sprintf(key, "key%d_%d", i, j);
+                CHECK_EQ(int, kv->Exists(i, key), 1, "");
+            }
+            exit(0);
+        }
+        childs.push_back(id);
+        id = fork();
+        if (id == 0)
+        {
+            for (int j = 0; j < count; j++)
+            {
+                char key[100], value[100];
+                sprintf(key, "key%d_%d", i, j);
+                sprintf(value, "value%d_%d", i, j);
+                kv->Set(proc_num + i, key, value);
+            }
+            exit(0);
+        }
+        childs.push_back(id);
+    }
+    for (size_t i = 0; i < childs.size(); i++)
+    {
+        int status;
+        waitpid(childs[i], &status, 0);
+    }
+    int64_t end = mmkv::get_current_micros();
+    printf("###Cost %lldus to concurrent read write %u keys in %d dbs\n", end - start, count * proc_num * 2, proc_num * 2);
+    for (int i = 0; i < proc_num; i++)
+    {
+        CHECK_EQ(int, kv->DBSize(proc_num + i), count, "");
+        kv->FlushDB(proc_num + i);
+    }
+}
+
+TEST(OptimisticRead, Concurrent)
+{
+    mmkv::MMKV* kv = get_dblock_kv();
+    CHECK_EQ(bool, kv != NULL, true, "");
+    int key_count = 10000;
+    int round = 20;
+    mmkv::DBID testdb = 10;
+    kv->FlushDB(testdb);
+    for (int j = 0; j < key_count; j++)
+    {
+        char key[100], value[100];
+        sprintf(key, "okey%d", j);
+        sprintf(value, "ovalue%d_%d", j, 0);
+        kv->Set(testdb, key, value);
+    }
+    std::vector<pid_t> childs;
+    int64_t start = mmkv::get_current_micros();
+    pid_t id = fork();
+    if (id == 0)
+    {
+        //rewrite same keys with longer values so readers race with reallocation
+        for (int r = 1; r < round; r++)
+        {
+            for (int j = 0; j < key_count; j++)
+            {
+                char key[100], value[200];
+                sprintf(key, "okey%d", j);
+                sprintf(value, "ovalue%d_%d_%0*d", j, r, r * 5, r);
+                kv->Set(testdb, key, value);
+            }
+        }
+        exit(0);
+    }
+    childs.push_back(id);
+    for (int i = 0; i < 2; i++)
+    {
+        id = fork();
+        if (id == 0)
+        {
+            for (int r = 0; r < round; r++)
+            {
+                for (int j = 0; j < key_count; j++)
+                {
+                    char key[100], prefix[100];
+                    sprintf(key, "okey%d", j);
+                    sprintf(prefix, "ovalue%d_", j);
+                    std::string value;
+                    CHECK_EQ(int, kv->Get(testdb, key, value), 0, "");
+                    CHECK_EQ(bool, value.compare(0, strlen(prefix), prefix) == 0, true, "");
+                }
+            }
+            exit(0);
+        }
+        childs.push_back(id);
+    }
+    for (size_t i = 0; i < childs.size(); i++)
+    {
+        int status;
+        waitpid(childs[i], &status, 0);
+        CHECK_EQ(int, WEXITSTATUS(status), 0, "");
+    }
+    int64_t end = mmkv::get_current_micros();
+    printf("###Cost %lldus to optimistic read %u keys while writing\n", end - start, key_count * round * 2);
+    kv->FlushDB(testdb);
+}
+
+static int64_t multi_db_alloc_free(uint32_t alloc_cache_blocks, int proc_num, int pair_count)
+{
+    char dir[100];
+    sprintf(dir, "./mmkv_alloccache%u", alloc_cache_blocks);
+    mmkv::OpenOptions open_options;
+    open_options.dir = dir;
+    open_options.use_lock = true;
+    open_options.per_db_lock = true;
+    open_options.create_if_notexist = true;
+    open_options.alloc_cache_blocks = alloc_cache_blocks;
+    open_options.create_options.size = 256 * 1024 * 1024LL;
+    mmkv::MMKV* kv = NULL;
+    CHECK_EQ(int, mmkv::MMKV::Open(open_options, kv), 0, "");
+    std::vector<pid_t> childs;
+    int64_t start = mmkv::get_current_micros();
+    for (int i = 0; i < proc_num; i++)
+    {
+        pid_t id = fork();
+        if (id == 0)
+        {
+            //every Set/Del pair allocates & frees a small key and value
+            bool same = true;
+            for (int j = 0; j < pair_count; j++)
+            {
+                char key[100], value[100];
+                sprintf(key, "key%d", j % 512);
+                sprintf(value, "value%d_%d", i, j);
+                kv->Set(i, key, value);
+                std::string v;
+                kv->Get(i, key, v);
+                same = same && v == value;
+                kv->Del(i, key);
+            }
+            delete kv;
+            exit(same ? 0 : 1);
+        }
+        childs.push_back(id);
+    }
+    for (size_t i = 0; i < childs.size(); i++)
+    {
+        int status;
+        waitpid(childs[i], &status, 0);
+        CHECK_EQ(int, WEXITSTATUS(status), 0, "");
+    }
+    int64_t cost = mmkv::get_current_micros() - start;
+    for (int i = 0; i < proc_num; i++)
+    {
+        CHECK_EQ(int, kv->DBSize(i), 0, "");
+    }
+    delete kv;
+    return cost;
+}
+
+TEST(MultiDBAllocFree, Concurrent)
+{
+    int proc_num = 4;
+    int pair_count = 200000;
+    int64_t locked_cost = multi_db_alloc_free(0, proc_num, pair_count);
+    int64_t cached_cost = multi_db_alloc_free(64, proc_num, pair_count);
+    printf("###Cost %lldus/%lldus without/with alloc cache for %d set/del pairs in %d processes\n", locked_cost,
+            cached_cost, pair_count * proc_num, proc_num);
+}
+
+TEST(GrowInPlace, Concurrent)
+{
+    //writers of child processes grow the store, the parent mapping sees the new space without reopen
+    mmkv::OpenOptions open_options;
+    open_options.dir = "./mmkv_grow";
+    open_options.use_lock = true;
+    open_options.per_db_lock = true;
+    open_options.create_if_notexist = true;
+    open_options.create_options.size = 16 * 1024 * 1024LL;
+    open_options.create_options.autoexpand = true;
+    open_options.create_options.map_size = 1024 * 1024 * 1024LL;
+    mmkv::MMKV* kv = NULL;
+    CHECK_EQ(int, mmkv::MMKV::Open(open_options, kv), 0, "");
+    kv->FlushAll();
+    int proc_num = 4;
+    int write_count = 50000;
+    std::vector<pid_t> childs;
+    int64_t start = mmkv::get_current_micros();
+    for (int i = 0; i < proc_num; i++)
+    {
+        pid_t id = fork();
+        if (id == 0)
+        {
+            for (int j = 0; j < write_count; j++)
+            {
+                char key[100], value[200];
+                sprintf(key, "grow%d_%d", i, j);
+                sprintf(value, "%0150d", j);
+                kv->Set(i, key, value);
+            }
+            exit(0);
+        }
+        childs.push_back(id);
+    }
+    for (size_t i = 0; i < childs.size(); i++)
+    {
+        int status;
+        waitpid(childs[i], &status, 0);
+    }
+    int64_t cost = mmkv::get_current_micros() - start;
+    CHECK_EQ(bool, kv->MSpaceUsed() > 16 * 1024 * 1024LL, true, "");
+    bool same = true;
+    for (int i = 0; i < proc_num; i++)
+    {
+        CHECK_EQ(int, kv->DBSize(i), write_count, "");
+        for (int j = 0; j < write_count; j += 7)
+        {
+            char key[100], value[200];
+            std::string v;
+            sprintf(key, "grow%d_%d", i, j);
+            sprintf(value, "%0150d", j);
+            same = same && 0 == kv->Get(i, key, v) && v == value;
+        }
+    }
+    CHECK_EQ(bool, same, true, "");
+    printf("###Cost %lldus to write %d keys growing store to %lluMB in %d processes\n", cost, write_count * proc_num,
+            (unsigned long long) kv->MSpaceUsed() / (1024 * 1024), proc_num);
+    delete kv;
+}
@@ -123,3 +123,55 @@ TEST(HMGetSet, Hash)
     CHECK_EQ(std::string, vs[1], "world", "");
     CHECK_EQ(std::string, vs[2], "", "");
 }
+
+TEST(CompactConvert, Hash)
+{
+    g_test_kv->Del(0, "myhash");
+    char field[64], value[64];
+    for (int i = 0; i < 128; i++)
+    {
+        sprintf(field, "field%d", i);
+        sprintf(value, "value%d", i);
+        CHECK_EQ(int, g_test_kv->HSet(0, "myhash", field, value), 1, "");
+    }
+    std::string v;
+    CHECK_EQ(int, g_test_kv->HLen(0, "myhash"), 128, "");
+    CHECK_EQ(int, g_test_kv->HGet(0, "myhash", "field7", v), 0, "");
+    CHECK_EQ(std::string, v, "value7", "");
+    //beyond 'hash_max_compact_entries', converted to btree
+    CHECK_EQ(int, g_test_kv->HSet(0, "myhash", "field128", "value128"), 1, "");
+    CHECK_EQ(int, g_test_kv->HLen(0, "myhash"), 129, "");
+    for (int i = 0; i < 129; i++)
+    {
+        sprintf(field, "field%d", i);
+        sprintf(value, "value%d", i);
+        CHECK_EQ(int, g_test_kv->HGet(0, "myhash", field, v), 0, "");
+        CHECK_EQ(std::string, v, value, "");
+    }
+
+    g_test_kv->Del(0, "myhash");
+    int64_t n;
+    CHECK_EQ(int, g_test_kv->HIncrBy(0, "myhash", "n", 10, n), 0, "");
+    CHECK_EQ(int, g_test_kv->HIncrBy(0, "myhash", "n", 10, n), 0, "");
+    CHECK_EQ(int, n, 20, "");
+    CHECK_EQ(int, g_test_kv->HSet(0, "myhash", "f", "hello"), 1, "");
+    CHECK_EQ(int, g_test_kv->HSet(0, "myhash", "f", "hello world"), 0, "");
+    CHECK_EQ(int, g_test_kv->HGet(0, "myhash", "f", v), 0, "");
+    CHECK_EQ(std::string, v, "hello world", "");
+    //value longer than 'hash_max_compact_value'
+    std::string long_value(100, 'x');
+    CHECK_EQ(int, g_test_kv->HSet(0, "myhash", "long", long_value), 1, "");
+    CHECK_EQ(int, g_test_kv->HGet(0, "myhash", "long", v), 0, "");
+    CHECK_EQ(std::string, v, long_value, "");
+    CHECK_EQ(int, g_test_kv->HGet(0, "myhash", "n", v), 0, "");
+    CHECK_EQ(std::string, v, "20", "");
+
+    g_test_kv->Del(0, "myhash");
+    CHECK_EQ(int, g_test_kv->HSet(0, "myhash", "f1", "v1"), 1, "");
+    CHECK_EQ(int, g_test_kv->HSet(0, "myhash", "f2", "v2"), 1, "");
+    mmkv::DataArray fs;
+    fs.push_back("f1");
+    fs.push_back("f2");
+    CHECK_EQ(int, g_test_kv->HDel(0, "myhash", fs), 2, "");
+    CHECK_EQ(int, g_test_kv->Exists(0, "myhash"), 0, "");
+}
@@ -28,6 +28,7 @@
  */
 
 #include "ut.hpp"
+#include <deque>
 
 TEST(PushPop, List)
 {
@@ -166,3 +167,67 @@ TEST(LTrim, List)
     CHECK_EQ(std::string, vs[0], "two", "");
     CHECK_EQ(std::string, vs[1], "three", "");
 }
+
+TEST(QuickList, List)
+{
+    //small nodes with interior nodes compressed, checked against a std::deque
+    mmkv::OpenOptions open_options;
+    open_options.dir = "./mmkv_quicklist";
+    open_options.create_if_notexist = true;
+    open_options.create_options.size = 64 * 1024 * 1024;
+    open_options.list_max_node_bytes = 256;
+    open_options.list_compress_depth = 1;
+    mmkv::MMKV* kv = NULL;
+    CHECK_EQ(int, mmkv::MMKV::Open(open_options, kv), 0, "");
+    kv->Del(0, "qlist");
+    std::deque<std::string> expected;
+    char buf[64];
+    for (int i = 0; i < 2000; i++)
+    {
+        sprintf(buf, "event-%d-payload-payload-payload", i);
+        if (i % 3 == 0)
+        {
+            kv->LPush(0, "qlist", buf);
+            expected.push_front(buf);
+        }
+        else
+        {
+            kv->RPush(0, "qlist", buf);
+            expected.push_back(buf);
+        }
+    }
+    CHECK_EQ(int, kv->LLen(0, "qlist"), 2000, "");
+    std::string v;
+    CHECK_EQ(int, kv->LIndex(0, "qlist", 1000, v), 0, "");
+    CHECK_EQ(std::string, v, expected[1000], "");
+    CHECK_EQ(int, kv->LSet(0, "qlist", 1001, "replaced"), 0, "");
+    expected[1001] = "replaced";
+    CHECK_EQ(int, kv->LInsert(0, "qlist", true, "replaced", "inserted"), 2001, "");
+    expected.insert(expected.begin() + 1001, "inserted");
+    CHECK_EQ(int, kv->RPush(0, "qlist", "inserted"), 2002, "");
+    expected.push_back("inserted");
+    CHECK_EQ(int, kv->LRem(0, "qlist", -1, "inserted"), 1, "");
+    expected.pop_back();
+
+    mmkv::StringArray vs;
+    CHECK_EQ(int, kv->LRange(0, "qlist", 0, -1, vs), 0, "");
+    CHECK_EQ(int, vs.size(), expected.size(), "");
+    bool same = true;
+    for (size_t i = 0; i < vs.size(); i++)
+    {
+        same = same && vs[i] == expected[i];
+    }
+    CHECK_EQ(bool, same, true, "");
+
+    CHECK_EQ(int, kv->LTrim(0, "qlist", 300, -301), 0, "");
+    expected.erase(expected.begin(), expected.begin() + 300);
+    expected.erase(expected.end() - 300, expected.end());
+    while (!expected.empty())
+    {
+        CHECK_EQ(int, kv->RPop(0, "qlist", v), 0, "");
+        CHECK_EQ(std::string, v, expected.back(), "");
+        expected.pop_back();
+    }
+    CHECK_EQ(int, kv->Exists(0, "qlist"), 0, "");
+    delete kv;
+}
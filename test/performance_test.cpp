@@ -29,6 +29,8 @@
 
 #include "ut.hpp"
 #include "utils.hpp"
+#include "types.hpp"
+#include <set>
 
 TEST(GetSet, Performance)
 {
@@ -74,3 +76,313 @@ TEST(GetSet, Performance)
     printf("###Cost %lldus to del %d times\n", end - start, loop);
 }
 
+static void large_table_performance(mmkv::MMKV* kv, mmkv::DBID testdb, const char* layout)
+{
+    int loop = 10000000;
+    kv->FlushDB(testdb);
+    size_t used = kv->MSpaceUsed();
+    int64_t start = mmkv::get_current_micros();
+    for (int i = 0; i < loop; i++)
+    {
+        char key[100];
+        sprintf(key, "t%010d", i);
+        kv->Set(testdb, key, "v");
+    }
+    int64_t end = mmkv::get_current_micros();
+    printf("###Cost %lldus to set %d keys in %s table, %llu bytes per key\n", end - start, loop, layout,
+            (unsigned long long) (kv->MSpaceUsed() - used) / loop);
+    start = mmkv::get_current_micros();
+    for (int i = 0; i < loop; i++)
+    {
+        //visit keys in a scattered order instead of insertion order
+        char key[100];
+        sprintf(key, "t%010d", (int) ((i * 1000003LL) % loop));
+        kv->Exists(testdb, key);
+    }
+    end = mmkv::get_current_micros();
+    printf("###Cost %lldus to hit %d keys in %d keys %s table\n", end - start, loop, loop, layout);
+    start = mmkv::get_current_micros();
+    for (int i = 0; i < loop; i++)
+    {
+        char key[100];
+        sprintf(key, "m%010d", i);
+        kv->Exists(testdb, key);
+    }
+    end = mmkv::get_current_micros();
+    printf("###Cost %lldus to miss %d keys in %d keys %s table\n", end - start, loop, loop, layout);
+
+    int lookups = 2000000, batch = 200;
+    std::vector<std::string> keys(lookups);
+    for (int i = 0; i < lookups; i++)
+    {
+        char key[100];
+        sprintf(key, "t%010d", (int) ((i * 1000003LL) % loop));
+        keys[i] = key;
+    }
+    start = mmkv::get_current_micros();
+    for (int i = 0; i < lookups; i++)
+    {
+        std::string v;
+        kv->Get(testdb, keys[i], v);
+    }
+    end = mmkv::get_current_micros();
+    printf("###Cost %lldus to get %d keys one by one in %s table\n", end - start, lookups, layout);
+    start = mmkv::get_current_micros();
+    for (int i = 0; i < lookups; i += batch)
+    {
+        mmkv::DataArray mkeys;
+        for (int j = i; j < i + batch; j++)
+        {
+            mkeys.push_back(keys[j]);
+        }
+        mmkv::StringArray vals;
+        kv->MGet(testdb, mkeys, vals);
+    }
+    end = mmkv::get_current_micros();
+    printf("###Cost %lldus to mget %d keys by %d in %s table\n", end - start, lookups, batch, layout);
+    CHECK_EQ(int, kv->DBSize(testdb), loop, "");
+    kv->FlushDB(testdb);
+}
+
+static void layout_table_operations(mmkv::MMKV* kv)
+{
+    kv->FlushDB(0);
+    int loop = 100000;
+    for (int i = 0; i < loop; i++)
+    {
+        char key[100], value[100];
+        sprintf(key, "k%d", i);
+        sprintf(value, "v%d", i);
+        kv->Set(0, key, value);
+    }
+    CHECK_EQ(int, kv->DBSize(0), loop, "");
+    std::string v;
+    kv->Get(0, "k100", v);
+    CHECK_EQ(std::string, v, "v100", "");
+    //rename while the table is rehashing
+    for (int i = 0; i < loop; i += 2)
+    {
+        char key[100], new_key[100];
+        sprintf(key, "k%d", i);
+        sprintf(new_key, "r%d", i);
+        kv->Rename(0, key, new_key);
+    }
+    for (int i = 1; i < loop; i += 2)
+    {
+        char key[100];
+        sprintf(key, "k%d", i);
+        kv->Del(0, key);
+    }
+    CHECK_EQ(int, kv->DBSize(0), loop / 2, "");
+    CHECK_EQ(int, kv->Exists(0, "k100"), 0, "");
+    kv->Get(0, "r100", v);
+    CHECK_EQ(std::string, v, "v100", "");
+    kv->FlushDB(0);
+    CHECK_EQ(int, kv->DBSize(0), 0, "");
+}
+
+static mmkv::MMKV* open_layout_kv(const char* dir, mmkv::TableLayout layout)
+{
+    mmkv::OpenOptions open_options;
+    open_options.dir = dir;
+    open_options.use_lock = true;
+    open_options.create_if_notexist = true;
+    open_options.create_options.size = 4 * 1024 * 1024 * 1024LL;
+    open_options.create_options.table_layout = layout;
+    mmkv::MMKV* kv = NULL;
+    mmkv::MMKV::Open(open_options, kv);
+    return kv;
+}
+
+TEST(IntegerHash, Table)
+{
+    //sequential & strided integer keys should spread over all buckets of a 4096 buckets table
+    mmkv::ObjectHash hash;
+    std::set<size_t> sequential, strided;
+    for (int64_t i = 0; i < 4096; i++)
+    {
+        mmkv::Object seq, str;
+        seq.SetInteger(i);
+        str.SetInteger(i * 4096);
+        sequential.insert(hash(seq) & 4095);
+        strided.insert(hash(str) & 4095);
+    }
+    CHECK_EQ(bool, sequential.size() > 2500, true, "");
+    CHECK_EQ(bool, strided.size() > 2500, true, "");
+}
+
+TEST(ProbeHistogram, Table)
+{
+    mmkv::DBID testdb = 8;
+    int count = 100000;
+    g_test_kv->FlushDB(testdb);
+    for (int i = 0; i < count; i++)
+    {
+        char key[100];
+        sprintf(key, "h%d", i);
+        g_test_kv->Set(testdb, key, "v");
+    }
+    mmkv::ProbeHistogram histogram;
+    CHECK_EQ(int, g_test_kv->GetProbeHistogram(testdb, histogram), 0, "");
+    uint64_t total = 0;
+    for (size_t i = 0; i < histogram.size(); i++)
+    {
+        total += histogram[i];
+    }
+    CHECK_EQ(uint64_t, total, count, "");
+    CHECK_EQ(bool, histogram[0] > total / 2, true, "");
+    g_test_kv->FlushDB(testdb);
+}
+
+TEST(LargeTable, Performance)
+{
+    large_table_performance(g_test_kv, 9, "probing");
+}
+
+static mmkv::MMKV* g_grouped_kv = NULL;
+static mmkv::MMKV* get_grouped_kv()
+{
+    if (NULL == g_grouped_kv)
+    {
+        g_grouped_kv = open_layout_kv("./mmkv_grouped", mmkv::GROUPED_TABLE_LAYOUT);
+    }
+    return g_grouped_kv;
+}
+
+TEST(GroupedTable, Operations)
+{
+    mmkv::MMKV* kv = get_grouped_kv();
+    CHECK_EQ(bool, kv != NULL, true, "");
+    layout_table_operations(kv);
+}
+
+TEST(GroupedTable, Performance)
+{
+    mmkv::MMKV* kv = get_grouped_kv();
+    CHECK_EQ(bool, kv != NULL, true, "");
+    large_table_performance(kv, 9, "grouped");
+}
+
+static mmkv::MMKV* g_inline_kv = NULL;
+static mmkv::MMKV* get_inline_kv()
+{
+    if (NULL == g_inline_kv)
+    {
+        g_inline_kv = open_layout_kv("./mmkv_inline", mmkv::INLINE_TABLE_LAYOUT);
+    }
+    return g_inline_kv;
+}
+
+TEST(InlineTable, Operations)
+{
+    mmkv::MMKV* kv = get_inline_kv();
+    CHECK_EQ(bool, kv != NULL, true, "");
+    layout_table_operations(kv);
+}
+
+TEST(InlineTable, Performance)
+{
+    mmkv::MMKV* kv = get_inline_kv();
+    CHECK_EQ(bool, kv != NULL, true, "");
+    large_table_performance(kv, 9, "inline");
+}
+
+TEST(SmallBlocks, Slab)
+{
+    //small keys & values are carved from size class slabs, emptied slabs go back to the mspace
+    mmkv::OpenOptions open_options;
+    open_options.dir = "./mmkv_slab";
+    open_options.create_if_notexist = true;
+    open_options.create_options.size = 256 * 1024 * 1024;
+    mmkv::MMKV* kv = NULL;
+    CHECK_EQ(int, mmkv::MMKV::Open(open_options, kv), 0, "");
+    int count = 200000;
+    char key[64], value[128];
+    size_t filled_used = 0;
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            sprintf(key, "slab:%d", i);
+            sprintf(value, "%0*d", i % 120 + 1, i);
+            value[0] = 'v';
+            kv->Set(0, key, value);
+        }
+        bool same = true;
+        for (int i = 0; i < count; i += 7)
+        {
+            std::string v;
+            sprintf(key, "slab:%d", i);
+            sprintf(value, "%0*d", i % 120 + 1, i);
+            value[0] = 'v';
+            kv->Get(0, key, v);
+            same = same && v == value;
+        }
+        CHECK_EQ(bool, same, true, "");
+        size_t used = kv->MSpaceUsed();
+        if (0 == round)
+        {
+            filled_used = used;
+        }
+        else
+        {
+            CHECK_EQ(bool, used <= filled_used + 1024 * 1024, true, "");
+        }
+        for (int i = 0; i < count; i++)
+        {
+            sprintf(key, "slab:%d", i);
+            kv->Del(0, key);
+        }
+        CHECK_EQ(int, kv->DBSize(0), 0, "");
+        CHECK_EQ(bool, kv->MSpaceUsed() + 10 * 1024 * 1024 < filled_used, true, "");
+    }
+    delete kv;
+}
+
+static int64_t random_get_cost(const char* dir, bool huge_pages, int count, int loop)
+{
+    mmkv::OpenOptions open_options;
+    open_options.dir = dir;
+    open_options.create_if_notexist = true;
+    open_options.create_options.size = 256 * 1024 * 1024;
+    open_options.huge_pages = huge_pages;
+    mmkv::MMKV* kv = NULL;
+    if (0 != mmkv::MMKV::Open(open_options, kv))
+    {
+        return -1;
+    }
+    char key[64], value[64];
+    for (int i = 0; i < count; i++)
+    {
+        sprintf(key, "huge:%d", i);
+        sprintf(value, "value:%d", i);
+        kv->Set(0, key, value);
+    }
+    //random keys spread the lookups over the whole mapping, so each one is likely a TLB miss
+    srandom(1);
+    bool same = true;
+    int64_t start = mmkv::get_current_micros();
+    for (int i = 0; i < loop; i++)
+    {
+        int k = random() % count;
+        std::string v;
+        sprintf(key, "huge:%d", k);
+        kv->Get(0, key, v);
+        sprintf(value, "value:%d", k);
+        same = same && v == value;
+    }
+    int64_t cost = mmkv::get_current_micros() - start;
+    delete kv;
+    return same ? cost : -1;
+}
+
+TEST(HugePages, Performance)
+{
+    int count = 1000000, loop = 1000000;
+    int64_t small_cost = random_get_cost("./mmkv_nohuge", false, count, loop);
+    int64_t huge_cost = random_get_cost("./mmkv_huge", true, count, loop);
+    CHECK_EQ(bool, small_cost > 0, true, "");
+    CHECK_EQ(bool, huge_cost > 0, true, "");
+    printf("###Cost %lldus to get %d random keys with 4KB pages, %lldus with huge pages\n", small_cost, loop,
+            huge_cost);
+}
@@ -0,0 +1,424 @@
+/*
+ *Copyright (c) 2015-2015, yinqiwen <yinqiwen@gmail.com>
+ *All rights reserved.
+ *
+ *Redistribution and use in source and binary forms, with or without
+ *modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of Redis nor the names of its contributors may be used
+ *    to endorse or promote products derived from this software without
+ *    specific prior written permission.
+ *
+ *THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ *BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ *THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ut.hpp"
+#include "utils.hpp"
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+TEST(ExpireSlices, Routine)
+{
+    mmkv::DBID testdb = 7;
+    int key_count = 200000;
+    g_test_kv->FlushDB(testdb);
+    for (int i = 0; i < key_count; i++)
+    {
+        char key[100];
+        sprintf(key, "ttlkey%d", i);
+        g_test_kv->Set(testdb, key, "value", -1, 1);
+    }
+    usleep(10 * 1000);
+    mmkv::RoutineStats stats;
+    g_test_kv->GetRoutineStats(stats);
+    int64_t slices_before = stats.lock_slices;
+    int calls = 0;
+    int ret = 0;
+    while ((ret = g_test_kv->Routine(2000)) > 0)
+    {
+        calls++;
+    }
+    CHECK_EQ(int, ret, 0, "");
+    CHECK_EQ(int, g_test_kv->DBSize(testdb), 0, "");
+    g_test_kv->GetRoutineStats(stats);
+    CHECK_EQ(bool, stats.lock_slices - slices_before > 1, true, "");
+    printf("###Routine removed %d expired keys in %d calls, max lock hold %lldus\n", key_count, calls + 1,
+            stats.max_lock_micros);
+}
+
+static bool is_db_rehashing(mmkv::DBID db)
+{
+    mmkv::DBInfoArray dbs;
+    g_test_kv->GetAllDBInfo(dbs);
+    for (size_t i = 0; i < dbs.size(); i++)
+    {
+        if (dbs[i].id == db)
+        {
+            return dbs[i].rehashing;
+        }
+    }
+    return false;
+}
+
+TEST(RehashOnWrite, Routine)
+{
+    mmkv::DBID testdb = 7;
+    g_test_kv->FlushDB(testdb);
+    int rehash_count = 0;
+    int max_rehash_writes = 0;
+    int rehash_writes = 0;
+    //no Routine() call, rehash should be finished by writes only
+    for (int i = 0; i < 100000; i++)
+    {
+        char key[100];
+        sprintf(key, "rkey%d", i);
+        g_test_kv->Set(testdb, key, "value");
+        if (is_db_rehashing(testdb))
+        {
+            if (0 == rehash_writes)
+            {
+                rehash_count++;
+            }
+            rehash_writes++;
+        }
+        else
+        {
+            if (rehash_writes > max_rehash_writes)
+            {
+                max_rehash_writes = rehash_writes;
+            }
+            rehash_writes = 0;
+        }
+    }
+    CHECK_EQ(bool, rehash_count > 0, true, "");
+    //a rehash of N entries should finish within N/4 writes
+    CHECK_EQ(bool, max_rehash_writes < 100000 / 4, true, "");
+    printf("###%d rehashes finished by writes, longest took %d writes\n", rehash_count, max_rehash_writes);
+    g_test_kv->FlushDB(testdb);
+}
+
+TEST(Defrag, Routine)
+{
+    //churned small blocks leave sparse slabs behind, Routine moves the survivors together
+    mmkv::OpenOptions open_options;
+    open_options.dir = "./mmkv_defrag";
+    open_options.create_if_notexist = true;
+    open_options.create_options.size = 256 * 1024 * 1024;
+    open_options.defrag_ratio = 1.1;
+    mmkv::MMKV* kv = NULL;
+    CHECK_EQ(int, mmkv::MMKV::Open(open_options, kv), 0, "");
+    kv->FlushAll();
+    int count = 200000;
+    int members = 20000;
+    char key[64], value[128];
+    for (int i = 0; i < count; i++)
+    {
+        sprintf(key, "defrag:%d", i);
+        sprintf(value, "value:%0*d", i % 100 + 1, i);
+        kv->Set(0, key, value, i % 10 == 0 ? 3600 : -1);
+    }
+    for (int i = 0; i < members; i++)
+    {
+        sprintf(key, "field:%d:0123456789", i);
+        kv->HSet(0, "defrag_hash", key, key);
+        kv->SAdd(0, "defrag_set", key);
+        kv->ZAdd(0, "defrag_zset", i, key);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (i % 4 != 0)
+        {
+            sprintf(key, "defrag:%d", i);
+            kv->Del(0, key);
+        }
+    }
+    for (int i = 0; i < members; i++)
+    {
+        if (i % 4 != 0)
+        {
+            sprintf(key, "field:%d:0123456789", i);
+            kv->HDel(0, "defrag_hash", key);
+            kv->SRem(0, "defrag_set", key);
+            kv->ZRem(0, "defrag_zset", key);
+        }
+    }
+    double ratio = kv->FragmentationRatio();
+    size_t used = kv->MSpaceUsed();
+    int calls = 0;
+    while (kv->Routine(2000) > 0)
+    {
+        calls++;
+    }
+    double defrag_ratio = kv->FragmentationRatio();
+    size_t defrag_used = kv->MSpaceUsed();
+    printf("###Defrag in %d calls, fragmentation ratio %.2f -> %.2f, mspace used %lluMB -> %lluMB\n", calls + 1,
+            ratio, defrag_ratio, (unsigned long long) used / (1024 * 1024),
+            (unsigned long long) defrag_used / (1024 * 1024));
+    CHECK_EQ(bool, ratio > 1.5, true, "");
+    CHECK_EQ(bool, defrag_ratio < 1.2, true, "");
+    CHECK_EQ(bool, defrag_used + 4 * 1024 * 1024 < used, true, "");
+
+    bool same = true;
+    for (int i = 0; i < count; i += 4)
+    {
+        std::string v;
+        sprintf(key, "defrag:%d", i);
+        sprintf(value, "value:%0*d", i % 100 + 1, i);
+        same = same && 0 == kv->Get(0, key, v) && v == value;
+    }
+    for (int i = 0; i < members; i++)
+    {
+        std::string v;
+        long double score = -1;
+        sprintf(key, "field:%d:0123456789", i);
+        bool exist = i % 4 == 0;
+        same = same && (0 == kv->HGet(0, "defrag_hash", key, v)) == exist && (!exist || v == key);
+        same = same && (kv->SIsMember(0, "defrag_set", key) == 1) == exist;
+        same = same && (0 == kv->ZScore(0, "defrag_zset", key, score)) == exist && (!exist || score == i);
+    }
+    CHECK_EQ(bool, same, true, "");
+    CHECK_EQ(int, kv->ZRank(0, "defrag_zset", "field:4:0123456789"), 1, "");
+    CHECK_EQ(bool, kv->TTL(0, "defrag:40") > 0, true, "");
+    delete kv;
+}
+
+static int64_t data_file_blocks_bytes(const char* path)
+{
+    struct stat st;
+    return 0 == stat(path, &st) ? (int64_t) st.st_blocks * 512 : -1;
+}
+
+TEST(Trim, Routine)
+{
+    //freed space of large values goes back to the filesystem, the tail is cut when the store can expand
+    mmkv::OpenOptions open_options;
+    open_options.dir = "./mmkv_trim";
+    open_options.create_if_notexist = true;
+    open_options.create_options.size = 64 * 1024 * 1024;
+    open_options.create_options.autoexpand = true;
+    mmkv::MMKV* kv = NULL;
+    CHECK_EQ(int, mmkv::MMKV::Open(open_options, kv), 0, "");
+    kv->FlushAll();
+    int count = 2000;
+    std::string large(256 * 1024, 'x');
+    char key[64];
+    for (int i = 0; i < count; i++)
+    {
+        sprintf(key, "trim:%d", i);
+        large[0] = 'a' + i % 26;
+        kv->Set(0, key, large);
+    }
+    //keep every 8th value, the freed neighbours merge into large free chunks
+    for (int i = 0; i < count; i++)
+    {
+        if (i % 8 != 0)
+        {
+            sprintf(key, "trim:%d", i);
+            kv->Del(0, key);
+        }
+    }
+    int64_t disk = data_file_blocks_bytes("./mmkv_trim/data");
+    int64_t released = kv->Trim();
+    int64_t trimmed_disk = data_file_blocks_bytes("./mmkv_trim/data");
+    printf("###Trim released %lldMB, data file on disk %lldMB -> %lldMB\n", released / (1024 * 1024),
+            disk / (1024 * 1024), trimmed_disk / (1024 * 1024));
+    CHECK_EQ(bool, released > 256 * 1024 * 1024, true, "");
+    CHECK_EQ(bool, trimmed_disk + 256 * 1024 * 1024 < disk, true, "");
+
+    bool same = true;
+    for (int i = 0; i < count; i++)
+    {
+        std::string v;
+        sprintf(key, "trim:%d", i);
+        large[0] = 'a' + i % 26;
+        bool exist = i % 8 == 0;
+        same = same && (0 == kv->Get(0, key, v)) == exist && (!exist || v == large);
+    }
+    CHECK_EQ(bool, same, true, "");
+    //punched & cut space is usable again
+    for (int i = 0; i < count; i++)
+    {
+        sprintf(key, "trim:%d", i);
+        large[0] = 'a' + i % 26;
+        kv->Set(0, key, large);
+    }
+    std::string v;
+    CHECK_EQ(int, kv->Get(0, "trim:1999", v), 0, "");
+    CHECK_EQ(bool, v == large, true, "");
+    CHECK_EQ(int, kv->DBSize(0), count, "");
+    delete kv;
+}
+
+static void set_cold_keys(mmkv::MMKV* kv, int from, int to, bool volatile_odd)
+{
+    char key[64], value[128];
+    for (int i = from; i < to; i++)
+    {
+        sprintf(key, "cold:%d", i);
+        sprintf(value, "value:%0100d", i);
+        kv->Set(0, key, value, volatile_odd && i % 2 ? 3600 : -1);
+    }
+}
+
+TEST(MaxMemory, Routine)
+{
+    //writes beyond max_memory evict sampled keys by the configured policy
+    int hot = 1000, count = 200000;
+    int64_t max_memory = 32 * 1024 * 1024;
+    mmkv::MaxMemoryPolicy policies[] = { mmkv::ALLKEYS_LRU, mmkv::ALLKEYS_LFU, mmkv::VOLATILE_TTL };
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++)
+    {
+        mmkv::OpenOptions open_options;
+        open_options.dir = "./mmkv_maxmemory";
+        open_options.create_if_notexist = true;
+        open_options.create_options.size = 256 * 1024 * 1024;
+        open_options.max_memory = max_memory;
+        open_options.max_memory_policy = policies[p];
+        mmkv::MMKV* kv = NULL;
+        CHECK_EQ(int, mmkv::MMKV::Open(open_options, kv), 0, "");
+        kv->FlushAll();
+        bool volatile_ttl = policies[p] == mmkv::VOLATILE_TTL;
+        char key[64];
+        for (int i = 0; i < hot; i++)
+        {
+            sprintf(key, "hot:%d", i);
+            kv->Set(0, key, "hotvalue");
+        }
+        //the first half fits in max_memory, the access clock ticks in seconds
+        set_cold_keys(kv, 0, count / 2, volatile_ttl);
+        sleep(2);
+        for (int n = 0; n < 10; n++)
+        {
+            for (int i = 0; i < hot; i++)
+            {
+                std::string v;
+                sprintf(key, "hot:%d", i);
+                kv->Get(0, key, v);
+            }
+        }
+        set_cold_keys(kv, count / 2, count, volatile_ttl);
+        int hot_left = 0, even_left = 0, odd_left = 0;
+        for (int i = 0; i < hot; i++)
+        {
+            sprintf(key, "hot:%d", i);
+            hot_left += kv->Exists(0, key);
+        }
+        for (int i = 0; i < count; i++)
+        {
+            sprintf(key, "cold:%d", i);
+            (i % 2 ? odd_left : even_left) += kv->Exists(0, key);
+        }
+        printf("###Policy %d kept %d/%d hot keys, %d/%d cold keys\n", policies[p], hot_left, hot,
+                even_left + odd_left, count);
+        CHECK_EQ(bool, kv->DBSize(0) < hot + count, true, "");
+        if (volatile_ttl)
+        {
+            //only keys with a ttl are evicted
+            CHECK_EQ(int, even_left, count / 2, "");
+            CHECK_EQ(int, hot_left, hot, "");
+        }
+        else
+        {
+            CHECK_EQ(bool, kv->MSpaceUsed() < (size_t) max_memory * 3 / 2, true, "");
+            CHECK_EQ(bool, hot_left > hot * 9 / 10, true, "");
+        }
+        delete kv;
+    }
+}
+
+static int64_t db_type_bytes(mmkv::MMKV* kv, mmkv::DBID db, int type)
+{
+    mmkv::DBInfoArray dbs;
+    kv->GetAllDBInfo(dbs);
+    for (size_t i = 0; i < dbs.size(); i++)
+    {
+        if (dbs[i].id == db)
+        {
+            return type < 0 ? dbs[i].keyspace_bytes : dbs[i].type_bytes[type];
+        }
+    }
+    return 0;
+}
+
+TEST(MemoryStats, Routine)
+{
+    //per db & type counters follow writes, MemoryUsage walks the value of a key
+    mmkv::OpenOptions open_options;
+    open_options.dir = "./mmkv_memstats";
+    open_options.create_if_notexist = true;
+    open_options.create_options.size = 64 * 1024 * 1024;
+    mmkv::MMKV* kv = NULL;
+    CHECK_EQ(int, mmkv::MMKV::Open(open_options, kv), 0, "");
+    kv->FlushAll();
+    char field[64], value[128];
+    for (int i = 0; i < 2000; i++)
+    {
+        sprintf(field, "field:%d", i);
+        sprintf(value, "value:%050d", i);
+        kv->HSet(0, "hash", field, value);
+        kv->RPush(0, "list", mmkv::DataArray(1, mmkv::Data(value, strlen(value))));
+        kv->SAdd(0, "set", mmkv::DataArray(1, mmkv::Data(value, strlen(value))));
+        mmkv::ScoreDataArray members(1);
+        members[0].score = i;
+        members[0].value = mmkv::Data(value, strlen(value));
+        kv->ZAdd(0, "zset", members);
+        sprintf(field, "string:%d", i);
+        kv->Set(0, field, value, i % 2 ? 1000 : -1);
+    }
+    int types[] = { mmkv::V_TYPE_STRING, mmkv::V_TYPE_HASH, mmkv::V_TYPE_SET, mmkv::V_TYPE_ZSET, mmkv::V_TYPE_LIST };
+    const char* keys[] = { "string:0", "hash", "set", "zset", "list" };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        int64_t counted = db_type_bytes(kv, 0, types[i]);
+        int64_t usage = kv->MemoryUsage(0, keys[i]);
+        printf("###Type %d: %lld bytes counted in db, %lld bytes used by '%s'\n", types[i], counted, usage, keys[i]);
+        CHECK_EQ(bool, usage > 0 && counted >= usage * 3 / 4, true, "");
+        if (types[i] != mmkv::V_TYPE_STRING)
+        {
+            //a single key holds the type, the estimate of containers stays close to what was allocated
+            CHECK_EQ(bool, usage > counted * 3 / 4 && usage < counted * 5 / 4, true, "");
+        }
+    }
+    CHECK_EQ(bool, db_type_bytes(kv, 0, -1) > 0, true, "");
+    CHECK_EQ(int64_t, kv->MemoryUsage(0, "nokey"), mmkv::ERR_ENTRY_NOT_EXIST, "");
+
+    //a moved key takes its charge, as estimated for its containers, to the other db
+    kv->Set(1, "string:1", "other db");
+    int64_t usage = kv->MemoryUsage(0, "hash");
+    CHECK_EQ(int, kv->Move(0, "hash", 1), 1, "");
+    CHECK_EQ(bool, llabs(db_type_bytes(kv, 0, mmkv::V_TYPE_HASH)) < usage / 10, true, "");
+    CHECK_EQ(bool, db_type_bytes(kv, 1, mmkv::V_TYPE_HASH) > usage * 9 / 10, true, "");
+
+    //counters of all types drop to zero with the keys
+    for (int i = 0; i < 2000; i++)
+    {
+        sprintf(field, "string:%d", i);
+        kv->Del(0, field);
+    }
+    kv->Del(0, "list");
+    kv->Del(0, "set");
+    kv->Del(0, "zset");
+    kv->Del(1, "hash");
+    kv->Del(1, "string:1");
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        CHECK_EQ(int64_t, db_type_bytes(kv, 0, types[i]) + db_type_bytes(kv, 1, types[i]), 0, "");
+    }
+    delete kv;
+}
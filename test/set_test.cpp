@@ -194,3 +194,114 @@ TEST(SInter, Set)
     CHECK_EQ(int, vs.size(), 1, "");
     CHECK_EQ(std::string, vs[0], "c", "");
 }
+
+TEST(CompactConvert, Set)
+{
+    g_test_kv->Del(0, "set1");
+    g_test_kv->Del(0, "set2");
+    g_test_kv->Del(0, "destset");
+    CHECK_EQ(int, g_test_kv->SAdd(0, "set2", "m"), 1, "");
+    CHECK_EQ(int, g_test_kv->SAdd(0, "set2", "a"), 1, "");
+    CHECK_EQ(int, g_test_kv->SAdd(0, "set2", "5"), 1, "");
+    CHECK_EQ(int, g_test_kv->SAdd(0, "set2", "a"), 0, "");
+    mmkv::StringArray vs;
+    //packed set keeps the same order as btree set
+    CHECK_EQ(int, g_test_kv->SMembers(0, "set2", vs), 0, "");
+    CHECK_EQ(int, vs.size(), 3, "");
+    CHECK_EQ(std::string, vs[0], "5", "");
+    CHECK_EQ(std::string, vs[1], "a", "");
+    CHECK_EQ(std::string, vs[2], "m", "");
+
+    char member[64];
+    for (int i = 0; i < 200; i++)
+    {
+        sprintf(member, "%d", i);
+        CHECK_EQ(int, g_test_kv->SAdd(0, "set1", member), 1, "");
+    }
+    CHECK_EQ(int, g_test_kv->SCard(0, "set1"), 200, "");
+    CHECK_EQ(int, g_test_kv->SIsMember(0, "set1", "199"), 1, "");
+
+    mmkv::DataArray keys;
+    keys.push_back("set1");
+    keys.push_back("set2");
+    CHECK_EQ(int, g_test_kv->SInter(0, keys, vs), 0, "");
+    CHECK_EQ(int, vs.size(), 1, "");
+    CHECK_EQ(std::string, vs[0], "5", "");
+    CHECK_EQ(int, g_test_kv->SInterStore(0, "destset", keys), 1, "");
+    CHECK_EQ(int, g_test_kv->SUnionStore(0, "destset", keys), 202, "");
+    CHECK_EQ(int, g_test_kv->SCard(0, "destset"), 202, "");
+
+    CHECK_EQ(int, g_test_kv->SMove(0, "set2", "set1", "a"), 1, "");
+    CHECK_EQ(int, g_test_kv->SCard(0, "set2"), 2, "");
+    CHECK_EQ(int, g_test_kv->SIsMember(0, "set1", "a"), 1, "");
+    mmkv::DataArray members;
+    members.push_back("5");
+    members.push_back("m");
+    CHECK_EQ(int, g_test_kv->SRem(0, "set2", members), 2, "");
+    CHECK_EQ(int, g_test_kv->Exists(0, "set2"), 0, "");
+}
+
+TEST(IntSet, Set)
+{
+    g_test_kv->Del(0, "intset1");
+    g_test_kv->Del(0, "intset2");
+    g_test_kv->Del(0, "destset");
+    //values widened from 16 to 32 and 64 bits
+    CHECK_EQ(int, g_test_kv->SAdd(0, "intset1", "100"), 1, "");
+    CHECK_EQ(int, g_test_kv->SAdd(0, "intset1", "-7"), 1, "");
+    CHECK_EQ(int, g_test_kv->SAdd(0, "intset1", "70000"), 1, "");
+    CHECK_EQ(int, g_test_kv->SAdd(0, "intset1", "-5000000000"), 1, "");
+    CHECK_EQ(int, g_test_kv->SAdd(0, "intset1", "100"), 0, "");
+    mmkv::StringArray vs;
+    CHECK_EQ(int, g_test_kv->SMembers(0, "intset1", vs), 0, "");
+    CHECK_EQ(int, vs.size(), 4, "");
+    CHECK_EQ(std::string, vs[0], "-5000000000", "");
+    CHECK_EQ(std::string, vs[1], "-7", "");
+    CHECK_EQ(std::string, vs[2], "100", "");
+    CHECK_EQ(std::string, vs[3], "70000", "");
+    CHECK_EQ(int, g_test_kv->SIsMember(0, "intset1", "70000"), 1, "");
+    CHECK_EQ(int, g_test_kv->SIsMember(0, "intset1", "070000"), 0, "");
+    CHECK_EQ(int, g_test_kv->SIsMember(0, "intset1", "8"), 0, "");
+
+    char member[64];
+    for (int i = 0; i < 100; i++)
+    {
+        sprintf(member, "%d", i);
+        CHECK_EQ(int, g_test_kv->SAdd(0, "intset2", member), 1, "");
+    }
+    mmkv::DataArray keys;
+    keys.push_back("intset1");
+    keys.push_back("intset2");
+    CHECK_EQ(int, g_test_kv->SInter(0, keys, vs), 0, "");
+    CHECK_EQ(int, vs.size(), 0, "");
+    CHECK_EQ(int, g_test_kv->SAdd(0, "intset2", "70000"), 1, "");
+    CHECK_EQ(int, g_test_kv->SInter(0, keys, vs), 0, "");
+    CHECK_EQ(int, vs.size(), 1, "");
+    CHECK_EQ(std::string, vs[0], "70000", "");
+    CHECK_EQ(int, g_test_kv->SUnion(0, keys, vs), 0, "");
+    CHECK_EQ(int, vs.size(), 104, "");
+    CHECK_EQ(std::string, vs[0], "-5000000000", "");
+    CHECK_EQ(int, g_test_kv->SInterStore(0, "destset", keys), 1, "");
+    CHECK_EQ(int, g_test_kv->SIsMember(0, "destset", "70000"), 1, "");
+
+    //non integer member converts to list pack, too many members to btree
+    CHECK_EQ(int, g_test_kv->SAdd(0, "intset1", "a"), 1, "");
+    CHECK_EQ(int, g_test_kv->SMembers(0, "intset1", vs), 0, "");
+    CHECK_EQ(int, vs.size(), 5, "");
+    CHECK_EQ(std::string, vs[0], "-5000000000", "");
+    CHECK_EQ(std::string, vs[4], "a", "");
+    for (int i = 100; i < 600; i++)
+    {
+        sprintf(member, "%d", i);
+        CHECK_EQ(int, g_test_kv->SAdd(0, "intset2", member), 1, "");
+    }
+    CHECK_EQ(int, g_test_kv->SCard(0, "intset2"), 601, "");
+    CHECK_EQ(int, g_test_kv->SIsMember(0, "intset2", "599"), 1, "");
+
+    mmkv::DataArray members;
+    members.push_back("-7");
+    members.push_back("100");
+    members.push_back("70000");
+    CHECK_EQ(int, g_test_kv->SRem(0, "destset", members), 1, "");
+    CHECK_EQ(int, g_test_kv->Exists(0, "destset"), 0, "");
+}
@@ -106,6 +106,34 @@ TEST(MGetSet, String)
     CHECK_EQ(int,g_test_kv->Del(0, keys) , batch, "mdel failed");
 }
 
+TEST(MGetBatch, String)
+{
+    //more keys than one lookup batch, with missing keys & non string values
+    int count = 100;
+    char keybuf[count][100];
+    mmkv::DataArray keys;
+    for (int i = 0; i < count; i++)
+    {
+        sprintf(keybuf[i], "mgetkey%d", i);
+        keys.push_back(keybuf[i]);
+        if (i % 3 == 0)
+        {
+            g_test_kv->Set(0, keybuf[i], keybuf[i]);
+        }
+    }
+    g_test_kv->SAdd(0, "mgetkey1", "member");
+    mmkv::StringArray vals;
+    mmkv::BooleanArray flags;
+    CHECK_EQ(int, g_test_kv->MGet(0, keys, vals, &flags), 0, "mget failed");
+    CHECK_EQ(int, vals.size(), count, "mget failed");
+    for (int i = 0; i < count; i++)
+    {
+        CHECK_EQ(bool, flags[i], (i % 3 == 0), "mget failed");
+        CHECK_EQ(std::string, vals[i], std::string(i % 3 == 0 ? keybuf[i] : ""), "mget failed");
+    }
+    g_test_kv->Del(0, keys);
+}
+
 TEST(GetSetRange, String)
 {
     CHECK_EQ(int,g_test_kv->Set(0, "mykey", "This is a string"), 0, "set testkey failed");
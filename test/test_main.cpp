@@ -38,6 +38,7 @@
 #include "geo_test.cpp"
 #include "performance_test.cpp"
 #include "concurrent_test.cpp"
+#include "routine_test.cpp"
 #include "backup_test.cpp"
 
 
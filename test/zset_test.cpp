@@ -187,6 +187,45 @@ TEST(ZRankRevRank, ZSet)
     CHECK_EQ(int, g_test_kv->ZRevRank(0, "myzset", "three"), 0, "");
 }
 
+TEST(ZRankLarge, ZSet)
+{
+    g_test_kv->Del(0, "myzset");
+    char member[32];
+    for (int i = 0; i < 20000; i++)
+    {
+        sprintf(member, "m%d", i);
+        g_test_kv->ZAdd(0, "myzset", i, member);
+    }
+    /* remove every third member to force merges & rebalances */
+    for (int i = 0; i < 20000; i += 3)
+    {
+        sprintf(member, "m%d", i);
+        g_test_kv->ZRem(0, "myzset", member);
+    }
+    int size = g_test_kv->ZCard(0, "myzset");
+    CHECK_EQ(int, size, 13333, "");
+    for (int i = 1; i < 20000; i += 97)
+    {
+        if (i % 3 == 0)
+            continue;
+        int rank = i - (i / 3 + 1);
+        sprintf(member, "m%d", i);
+        CHECK_EQ(int, g_test_kv->ZRank(0, "myzset", member), rank, "");
+        CHECK_EQ(int, g_test_kv->ZRevRank(0, "myzset", member), (size - 1 - rank), "");
+        mmkv::StringArray vs;
+        g_test_kv->ZRange(0, "myzset", rank, rank + 1, false, vs);
+        CHECK_EQ(int, vs.size(), 2, "");
+        CHECK_EQ(std::string, vs[0], member, "");
+    }
+    mmkv::StringArray vs;
+    g_test_kv->ZRange(0, "myzset", -1, -1, false, vs);
+    CHECK_EQ(int, vs.size(), 1, "");
+    CHECK_EQ(std::string, vs[0], "m19999", "");
+    CHECK_EQ(int, g_test_kv->ZRemRangeByRank(0, "myzset", 0, 9999), 10000, "");
+    CHECK_EQ(int, g_test_kv->ZRank(0, "myzset", "m19999"), 3332, "");
+    g_test_kv->Del(0, "myzset");
+}
+
 TEST(ZRem, ZSet)
 {
     g_test_kv->Del(0, "myzset");
@@ -325,9 +364,90 @@ TEST(ZRevRangeByLex, ZSet)
 TEST(ZInterStore, ZSet)
 {
     g_test_kv->Del(0, "myzset");
+    g_test_kv->Del(0, "myzset1");
+    g_test_kv->Del(0, "myset");
+    g_test_kv->ZAdd(0, "myzset", 1, "one");
+    g_test_kv->ZAdd(0, "myzset", 2, "two");
+    g_test_kv->ZAdd(0, "myzset", 3, 100);
+    g_test_kv->ZAdd(0, "myzset1", 1, "one");
+    g_test_kv->ZAdd(0, "myzset1", 2, 100);
+    g_test_kv->SAdd(0, "myset", "one");
+    g_test_kv->SAdd(0, "myset", "100");
+    mmkv::DataArray keys;
+    keys.push_back("myzset");
+    keys.push_back("myzset1");
+    keys.push_back("myset");
+    mmkv::WeightArray weights;
+    CHECK_EQ(int, g_test_kv->ZInterStore(0, "myzset", keys, weights, ""), 2, "");
+    long double score = 0;
+    CHECK_EQ(int, g_test_kv->ZScore(0, "myzset", "100", score), 0, "");
+    CHECK_EQ(int, (int )score, 6, "");
+    CHECK_EQ(int, g_test_kv->ZScore(0, "myzset", "one", score), 0, "");
+    CHECK_EQ(int, (int )score, 3, "");
+    keys.push_back("nokey");
+    CHECK_EQ(int, g_test_kv->ZInterStore(0, "myzset", keys, weights, ""), 0, "");
+    CHECK_EQ(int, g_test_kv->Exists(0, "myzset"), 0, "");
 }
 
 TEST(ZUnionStore, ZSet)
 {
     g_test_kv->Del(0, "myzset");
+    g_test_kv->Del(0, "myzset1");
+    g_test_kv->Del(0, "myset");
+    g_test_kv->ZAdd(0, "myzset", 1, "one");
+    g_test_kv->ZAdd(0, "myzset", 2, "two");
+    g_test_kv->ZAdd(0, "myzset1", 3, "two");
+    g_test_kv->SAdd(0, "myset", "three");
+    mmkv::DataArray keys;
+    keys.push_back("nokey");
+    keys.push_back("myzset");
+    keys.push_back("myzset1");
+    keys.push_back("myset");
+    mmkv::WeightArray weights;
+    CHECK_EQ(int, g_test_kv->ZUnionStore(0, "myzset", keys, weights, "max"), 3, "");
+    mmkv::StringArray vs;
+    CHECK_EQ(int, g_test_kv->ZRange(0, "myzset", 0, -1, false, vs), 0, "");
+    CHECK_EQ(int, vs.size(), 3, "");
+    CHECK_EQ(std::string, vs[0], "one", "");
+    CHECK_EQ(std::string, vs[1], "three", "");
+    CHECK_EQ(std::string, vs[2], "two", "");
+    long double score = 0;
+    CHECK_EQ(int, g_test_kv->ZScore(0, "myzset", "two", score), 0, "");
+    CHECK_EQ(int, (int )score, 3, "");
+}
+
+TEST(DoubleScore, ZSet)
+{
+    mmkv::OpenOptions open_options;
+    open_options.dir = "./mmkv_doublescore";
+    open_options.create_if_notexist = true;
+    open_options.create_options.size = 64 * 1024 * 1024;
+    open_options.create_options.score_precision = mmkv::DOUBLE_SCORE;
+    mmkv::MMKV* kv = NULL;
+    CHECK_EQ(int, mmkv::MMKV::Open(open_options, kv), 0, "");
+    kv->Del(0, "myzset");
+    CHECK_EQ(int, kv->ZAdd(0, "myzset", 1.1L, "one"), 1, "");
+    CHECK_EQ(int, kv->ZAdd(0, "myzset", 2, "two"), 1, "");
+    CHECK_EQ(int, kv->ZAdd(0, "myzset", (double) 1.1L, "one"), 0, "");
+    long double score = 0;
+    CHECK_EQ(int, kv->ZScore(0, "myzset", "one", score), 0, "");
+    CHECK_EQ(bool, (score == 1.1), true, "");
+    mmkv::StringArray vs;
+    CHECK_EQ(int, kv->ZRangeByScore(0, "myzset", "1.1", "1.1", false, 0, -1, vs), 0, "");
+    CHECK_EQ(int, vs.size(), 1, "");
+    CHECK_EQ(std::string, vs[0], "one", "");
+    CHECK_EQ(int, kv->ZAdd(0, "myzset", 1, "one", false, false, false, true), 0, "");
+    CHECK_EQ(int, kv->ZRank(0, "myzset", "one"), 1, "");
+    CHECK_EQ(int, kv->ZRem(0, "myzset", "one"), 1, "");
+    CHECK_EQ(int, kv->ZCard(0, "myzset"), 1, "");
+
+    kv->Del(0, "myhash");
+    long double new_val = 0;
+    CHECK_EQ(int, kv->HIncrByFloat(0, "myhash", "field", 10.5, new_val), 0, "");
+    CHECK_EQ(int, kv->HIncrByFloat(0, "myhash", "field", 0.1L, new_val), 0, "");
+    CHECK_EQ(bool, (new_val == 10.6), true, "");
+    std::string v;
+    CHECK_EQ(int, kv->HGet(0, "myhash", "field", v), 0, "");
+    CHECK_EQ(std::string, v, "10.6", "");
+    delete kv;
 }